@@ -3124,6 +3124,29 @@ namespace dxvk {
   template<DxbcProgramType ShaderStage>
   void D3D11DeviceContext::BindShader(
     const D3D11CommonShader*    pShaderModule) {
+    // Deferred shaders are translated on first use, so kick off
+    // translation now and only resolve the shader on the CS thread
+    if (pShaderModule != nullptr && pShaderModule->IsDeferred()) {
+      pShaderModule->Prefetch();
+
+      EmitCs([
+        cModule = *pShaderModule
+      ] (DxvkContext* ctx) {
+        VkShaderStageFlagBits stage = GetShaderStage(ShaderStage);
+
+        uint32_t slotId = computeConstantBufferBinding(ShaderStage,
+          D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT);
+
+        Rc<DxvkBuffer> icb = cModule.GetIcb();
+
+        ctx->bindShader        (stage,  cModule.GetShader());
+        ctx->bindResourceBuffer(slotId, icb != nullptr
+          ? DxvkBufferSlice(icb)
+          : DxvkBufferSlice());
+      });
+      return;
+    }
+
     // Bind the shader and the ICB at once
     EmitCs([
       cSlice  = pShaderModule           != nullptr
@@ -4530,7 +4553,7 @@ namespace dxvk {
   
 
   DxvkCsChunkRef D3D11DeviceContext::AllocCsChunk() {
-    return m_parent->AllocCsChunk(m_csFlags);
+    return m_parent->AllocCsChunk(m_csFlags, m_csChunkSize);
   }
   
 
@@ -704,6 +704,8 @@ namespace dxvk {
     D3D11UserDefinedAnnotation  m_annotation;
 
     DxvkCsChunkFlags            m_csFlags;
+    DxvkCsChunkSize             m_csChunkSize     = DxvkCsChunkSize::Medium;
+    DxvkCsChunkSize             m_csChunkSizeMax  = DxvkCsChunkSize::Medium;
     DxvkCsChunkRef              m_csChunk;
     
     D3D11ContextState           m_state;
@@ -1040,6 +1042,7 @@ namespace dxvk {
       m_cmdData = nullptr;
 
       if (unlikely(!m_csChunk->push(command))) {
+        m_csChunkSize = m_csChunk->getNextSize(m_csChunkSizeMax);
         EmitCsChunk(std::move(m_csChunk));
         
         m_csChunk = AllocCsChunk();
@@ -1053,6 +1056,7 @@ namespace dxvk {
         command, std::forward<Args>(args)...);
 
       if (unlikely(!data)) {
+        m_csChunkSize = m_csChunk->getNextSize(m_csChunkSizeMax);
         EmitCsChunk(std::move(m_csChunk));
         
         m_csChunk = AllocCsChunk();
@@ -1066,6 +1070,7 @@ namespace dxvk {
     
     void FlushCsChunk() {
       if (likely(!m_csChunk->empty())) {
+        m_csChunkSize = m_csChunk->getNextSize(m_csChunkSizeMax);
         EmitCsChunk(std::move(m_csChunk));
         m_csChunk = AllocCsChunk();
         m_cmdData = nullptr;
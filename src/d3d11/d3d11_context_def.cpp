@@ -10,6 +10,10 @@ namespace dxvk {
   : D3D11DeviceContext(pParent, Device, GetCsChunkFlags(pParent)),
     m_contextFlags(ContextFlags),
     m_commandList (CreateCommandList()) {
+    // Command lists are usually recorded in one go and
+    // are not latency-sensitive, so allow larger chunks
+    m_csChunkSizeMax = DxvkCsChunkSize::Large;
+
     ClearState();
   }
   
@@ -2036,15 +2036,26 @@ namespace dxvk {
     if (pClassLinkage != nullptr)
       Logger::warn("D3D11Device::CreateShaderModule: Class linkage not supported");
 
+    // Shaders that use features which may not be supported need
+    // to be compiled immediately so that we can reject them here
+    bool deferred = m_d3d11Options.deferShaderTranslation
+      && m_dxvkDevice->extensions().extShaderStencilExport
+      && m_dxvkDevice->extensions().extShaderViewportIndexLayer;
+
     D3D11CommonShader commonShader;
 
     HRESULT hr = m_shaderModules.GetShaderModule(this,
       &ShaderKey, pModuleInfo, pShaderBytecode, BytecodeLength,
-      &commonShader);
+      deferred, &commonShader);
 
     if (FAILED(hr))
       return hr;
 
+    if (commonShader.IsDeferred()) {
+      *pShaderModule = std::move(commonShader);
+      return S_OK;
+    }
+
     auto shader = commonShader.GetShader();
 
     if (shader->flags().test(DxvkShaderFlag::ExportsStencilRef)
@@ -408,8 +408,8 @@ namespace dxvk {
             DXGI_FORMAT           Format,
             DXGI_VK_FORMAT_MODE   Mode) const;
     
-    DxvkCsChunkRef AllocCsChunk(DxvkCsChunkFlags flags) {
-      DxvkCsChunk* chunk = m_csChunkPool.allocChunk(flags);
+    DxvkCsChunkRef AllocCsChunk(DxvkCsChunkFlags flags, DxvkCsChunkSize size) {
+      DxvkCsChunk* chunk = m_csChunkPool.allocChunk(flags, size);
       return DxvkCsChunkRef(chunk, &m_csChunkPool);
     }
     
@@ -18,6 +18,8 @@ namespace dxvk {
     this->invariantPosition     = config.getOption<bool>("d3d11.invariantPosition", true);
     this->floatControls         = config.getOption<bool>("d3d11.floatControls", true);
     this->disableMsaa           = config.getOption<bool>("d3d11.disableMsaa", false);
+    this->optimizeShaders       = config.getOption<bool>("d3d11.optimizeShaders", false);
+    this->deferShaderTranslation = config.getOption<bool>("d3d11.deferShaderTranslation", false);
     this->deferSurfaceCreation  = config.getOption<bool>("dxgi.deferSurfaceCreation", false);
     this->numBackBuffers        = config.getOption<int32_t>("dxgi.numBackBuffers", 0);
     this->maxFrameLatency       = config.getOption<int32_t>("dxgi.maxFrameLatency", 0);
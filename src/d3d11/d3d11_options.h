@@ -107,6 +107,17 @@ namespace dxvk {
     /// performs the required shader and resolve fixups.
     bool disableMsaa;
 
+    /// Runs a light-weight optimization pass over generated
+    /// SPIR-V, which may reduce driver-side compile times.
+    bool optimizeShaders;
+
+    /// Translates shaders when they are first used rather
+    /// than at creation time. Reduces load times and memory
+    /// usage for games that create many unused shaders. The
+    /// state cache cannot compile pipelines for shaders that
+    /// have not been translated yet.
+    bool deferShaderTranslation;
+
     /// Dynamic resources with the given bind flags will be allocated
     /// in cached system memory. Enabled automatically when recording
     /// an api trace.
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "d3d11_device.h"
 #include "d3d11_shader.h"
 
@@ -40,10 +42,31 @@ namespace dxvk {
     if (module.programInfo().shaderStage() != pShaderKey->type() && !passthroughShader)
       throw DxvkError("Mismatching shader type.");
 
-    m_shader = passthroughShader
-      ? module.compilePassthroughShader(*pDxbcModuleInfo, name)
-      : module.compile                 (*pDxbcModuleInfo, name);
-    m_shader->setShaderKey(*pShaderKey);
+    // Try the persistent shader cache before translating the
+    // shader. Tessellation info affects code generation, so
+    // it needs to be part of the options hash as well.
+    const Rc<DxvkDevice>& dxvkDevice = pDevice->GetDXVKDevice();
+
+    const float maxTessFactor = pDxbcModuleInfo->tess
+      ? pDxbcModuleInfo->tess->maxTessFactor : 0.0f;
+
+    Sha1Hash optionsHash = pDxbcModuleInfo->options.hash();
+    const std::array<Sha1Data, 2> hashData = {{
+      { &optionsHash,   sizeof(optionsHash)   },
+      { &maxTessFactor, sizeof(maxTessFactor) },
+    }};
+
+    optionsHash = Sha1Hash::compute(hashData.size(), hashData.data());
+    m_shader = dxvkDevice->lookupShader(*pShaderKey, optionsHash);
+
+    if (m_shader == nullptr) {
+      m_shader = passthroughShader
+        ? module.compilePassthroughShader(*pDxbcModuleInfo, name)
+        : module.compile                 (*pDxbcModuleInfo, name);
+      m_shader->setShaderKey(*pShaderKey);
+
+      dxvkDevice->cacheShader(m_shader, optionsHash);
+    }
     
     if (dumpPath.size() != 0) {
       std::ofstream dumpStream(
@@ -75,9 +98,140 @@ namespace dxvk {
     pDevice->GetDXVKDevice()->registerShader(m_shader);
   }
 
+
+  D3D11CommonShader::D3D11CommonShader(
+    const Rc<D3D11DeferredShader>& Deferred)
+  : m_deferred(Deferred) {
+
+  }
+
+
+  Rc<DxvkShader> D3D11CommonShader::GetShader() const {
+    return m_deferred != nullptr
+      ? m_deferred->GetShader().m_shader
+      : m_shader;
+  }
+
+
+  Rc<DxvkBuffer> D3D11CommonShader::GetIcb() const {
+    return m_deferred != nullptr
+      ? m_deferred->GetShader().m_buffer
+      : m_buffer;
+  }
+
+
+  void D3D11CommonShader::Prefetch() const {
+    if (m_deferred != nullptr && m_deferred->IsPending())
+      m_deferred->Prefetch();
+  }
+
+
+  D3D11DeferredShader::D3D11DeferredShader(
+          D3D11Device*          pDevice,
+          D3D11ShaderModuleSet* pModuleSet,
+    const DxvkShaderKey*        pShaderKey,
+    const DxbcModuleInfo*       pDxbcModuleInfo,
+    const void*                 pShaderBytecode,
+          size_t                BytecodeLength)
+  : m_device    (pDevice),
+    m_moduleSet (pModuleSet),
+    m_key       (*pShaderKey),
+    m_moduleInfo(*pDxbcModuleInfo),
+    m_bytecode  (reinterpret_cast<const char*>(pShaderBytecode),
+                 reinterpret_cast<const char*>(pShaderBytecode) + BytecodeLength) {
+    // The module info may point to data owned by the
+    // caller, so we need to store our own copies.
+    if (pDxbcModuleInfo->tess) {
+      m_tess = *pDxbcModuleInfo->tess;
+      m_moduleInfo.tess = &m_tess;
+    }
+
+    if (pDxbcModuleInfo->xfb) {
+      m_xfb = *pDxbcModuleInfo->xfb;
+      m_xfbNames.resize(m_xfb.entryCount);
+
+      for (uint32_t i = 0; i < m_xfb.entryCount; i++) {
+        if (m_xfb.entries[i].semanticName) {
+          m_xfbNames[i] = m_xfb.entries[i].semanticName;
+          m_xfb.entries[i].semanticName = m_xfbNames[i].c_str();
+        }
+      }
+
+      m_moduleInfo.xfb = &m_xfb;
+    }
+  }
+
+
+  D3D11DeferredShader::~D3D11DeferredShader() {
+
+  }
+
+
+  const D3D11CommonShader& D3D11DeferredShader::GetShader() {
+    if (m_state.load(std::memory_order_acquire) == State::Ready)
+      return m_shader;
+
+    std::unique_lock<dxvk::mutex> lock(m_mutex);
+
+    if (m_state.load() == State::Compiling) {
+      m_cond.wait(lock, [this] {
+        return m_state.load() == State::Ready;
+      });
+    }
+
+    if (m_state.load() != State::Ready) {
+      m_state.store(State::Compiling);
+      lock.unlock();
+
+      D3D11CommonShader shader;
+
+      try {
+        shader = D3D11CommonShader(m_device, &m_key,
+          &m_moduleInfo, m_bytecode.data(), m_bytecode.size());
+      } catch (const DxvkError& e) {
+        // The bytecode was validated on creation, so this is most
+        // likely an unsupported instruction. We cannot report this
+        // to the application anymore, so the stage gets unbound.
+        // Draws without a vertex shader are skipped, but e.g. a
+        // missing pixel shader will result in depth-only rendering.
+        Logger::err(str::format("D3D11: Deferred translation of ", m_key.toString(), " failed: ", e.message()));
+      }
+
+      lock.lock();
+
+      m_shader = std::move(shader);
+      m_bytecode = std::vector<char>();
+
+      m_state.store(State::Ready, std::memory_order_release);
+      m_cond.notify_all();
+    }
+
+    return m_shader;
+  }
+
+
+  void D3D11DeferredShader::Prefetch() {
+    State expected = State::Pending;
+
+    if (m_state.compare_exchange_strong(expected, State::Queued))
+      m_moduleSet->QueueShader(this);
+  }
+
   
-  D3D11ShaderModuleSet:: D3D11ShaderModuleSet() { }
-  D3D11ShaderModuleSet::~D3D11ShaderModuleSet() { }
+  D3D11ShaderModuleSet::D3D11ShaderModuleSet() {
+
+  }
+
+
+  D3D11ShaderModuleSet::~D3D11ShaderModuleSet() {
+    { std::unique_lock<dxvk::mutex> lock(m_workerLock);
+      m_stopWorkers = true;
+      m_workerCond.notify_all();
+    }
+
+    for (auto& thread : m_workerThreads)
+      thread.join();
+  }
   
   
   HRESULT D3D11ShaderModuleSet::GetShaderModule(
@@ -86,6 +240,7 @@ namespace dxvk {
     const DxbcModuleInfo*     pDxbcModuleInfo,
     const void*               pShaderBytecode,
           size_t              BytecodeLength,
+          bool                Deferred,
           D3D11CommonShader*  pShader) {
     // Use the shader's unique key for the lookup
     { std::unique_lock<dxvk::mutex> lock(m_mutex);
@@ -99,11 +254,31 @@ namespace dxvk {
     
     // This shader has not been compiled yet, so we have to create a
     // new module. This takes a while, so we won't lock the structure.
+    // If translation is deferred, only validate the bytecode here.
     D3D11CommonShader module;
     
     try {
-      module = D3D11CommonShader(pDevice, pShaderKey,
-        pDxbcModuleInfo, pShaderBytecode, BytecodeLength);
+      if (Deferred) {
+        DxbcReader reader(
+          reinterpret_cast<const char*>(pShaderBytecode),
+          BytecodeLength);
+
+        DxbcModule dxbc(reader);
+        dxbc.validate();
+
+        bool passthroughShader = pDxbcModuleInfo->xfb != nullptr
+          && (dxbc.programInfo().type() == DxbcProgramType::VertexShader
+           || dxbc.programInfo().type() == DxbcProgramType::DomainShader);
+
+        if (dxbc.programInfo().shaderStage() != pShaderKey->type() && !passthroughShader)
+          throw DxvkError("Mismatching shader type.");
+
+        module = D3D11CommonShader(new D3D11DeferredShader(pDevice, this,
+          pShaderKey, pDxbcModuleInfo, pShaderBytecode, BytecodeLength));
+      } else {
+        module = D3D11CommonShader(pDevice, pShaderKey,
+          pDxbcModuleInfo, pShaderBytecode, BytecodeLength);
+      }
     } catch (const DxvkError& e) {
       Logger::err(e.message());
       return E_INVALIDARG;
@@ -125,4 +300,49 @@ namespace dxvk {
     return S_OK;
   }
   
+
+
+  void D3D11ShaderModuleSet::QueueShader(
+          D3D11DeferredShader* pShader) {
+    std::unique_lock<dxvk::mutex> lock(m_workerLock);
+
+    if (m_workerThreads.empty()) {
+      // Translation is fairly cheap compared to pipeline compilation,
+      // so a small number of threads is enough to keep up with the
+      // shaders that an application binds for the first time.
+      uint32_t numCpuCores = dxvk::thread::hardware_concurrency();
+      uint32_t numWorkers  = std::clamp(numCpuCores / 4, 1u, 4u);
+
+      for (uint32_t i = 0; i < numWorkers; i++)
+        m_workerThreads.emplace_back([this] () { runWorker(); });
+    }
+
+    m_workerQueue.push(pShader);
+    m_workerCond.notify_one();
+  }
+
+
+  void D3D11ShaderModuleSet::runWorker() {
+    env::setThreadName("dxvk-dxbc");
+
+    while (true) {
+      Rc<D3D11DeferredShader> shader;
+
+      { std::unique_lock<dxvk::mutex> lock(m_workerLock);
+
+        m_workerCond.wait(lock, [this] {
+          return m_stopWorkers || !m_workerQueue.empty();
+        });
+
+        if (m_stopWorkers)
+          break;
+
+        shader = std::move(m_workerQueue.front());
+        m_workerQueue.pop();
+      }
+
+      shader->GetShader();
+    }
+  }
+  
 }
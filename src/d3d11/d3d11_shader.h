@@ -1,6 +1,8 @@
 #pragma once
 
+#include <atomic>
 #include <mutex>
+#include <queue>
 #include <unordered_map>
 
 #include "../dxbc/dxbc_module.h"
@@ -10,6 +12,7 @@
 
 #include "../util/sha1/sha1_util.h"
 
+#include "../util/thread.h"
 #include "../util/util_env.h"
 
 #include "d3d11_device_child.h"
@@ -19,12 +22,18 @@ namespace dxvk {
   
   class D3D11Device;
   
+  class D3D11DeferredShader;
+  class D3D11ShaderModuleSet;
+
   /**
    * \brief Common shader object
    * 
    * Stores the compiled SPIR-V shader and the SHA-1
    * hash of the original DXBC shader, which can be
-   * used to identify the shader.
+   * used to identify the shader. If translation is
+   * deferred, the shader will be compiled on first
+   * use, and the methods retrieving the shader or
+   * the ICB may block until translation completes.
    */
   class D3D11CommonShader {
     
@@ -37,26 +46,117 @@ namespace dxvk {
       const DxbcModuleInfo* pDxbcModuleInfo,
       const void*           pShaderBytecode,
             size_t          BytecodeLength);
+    D3D11CommonShader(
+      const Rc<D3D11DeferredShader>& Deferred);
     ~D3D11CommonShader();
 
-    Rc<DxvkShader> GetShader() const {
-      return m_shader;
-    }
+    Rc<DxvkShader> GetShader() const;
 
-    Rc<DxvkBuffer> GetIcb() const {
-      return m_buffer;
-    }
+    Rc<DxvkBuffer> GetIcb() const;
     
     std::string GetName() const {
-      return m_shader->debugName();
+      return GetShader()->debugName();
     }
+
+    bool IsDeferred() const {
+      return m_deferred != nullptr;
+    }
+
+    /**
+     * \brief Requests shader translation
+     *
+     * For deferred shaders, queues translation on a
+     * worker thread so that the shader is likely to
+     * be ready by the time it is actually needed.
+     * Does nothing if the shader is already compiled.
+     */
+    void Prefetch() const;
     
   private:
     
     Rc<DxvkShader> m_shader;
     Rc<DxvkBuffer> m_buffer;
+
+    Rc<D3D11DeferredShader> m_deferred;
     
   };
+
+
+  /**
+   * \brief Deferred shader
+   *
+   * Stores everything needed to translate a DXBC
+   * shader at a later point in time. Translation
+   * is performed exactly once, either by a worker
+   * thread or by whichever thread needs the shader
+   * first, while other threads wait for it.
+   */
+  class D3D11DeferredShader : public RcObject {
+
+  public:
+
+    D3D11DeferredShader(
+            D3D11Device*          pDevice,
+            D3D11ShaderModuleSet* pModuleSet,
+      const DxvkShaderKey*        pShaderKey,
+      const DxbcModuleInfo*       pDxbcModuleInfo,
+      const void*                 pShaderBytecode,
+            size_t                BytecodeLength);
+
+    ~D3D11DeferredShader();
+
+    /**
+     * \brief Retrieves compiled shader
+     *
+     * Translates the shader if necessary, or waits
+     * for a worker thread to finish translating it.
+     * \returns Compiled shader, or \c nullptr if
+     *    the shader could not be translated.
+     */
+    const D3D11CommonShader& GetShader();
+
+    /**
+     * \brief Queues shader for translation
+     *
+     * Hands the shader off to a worker thread
+     * if translation has not started yet.
+     */
+    void Prefetch();
+
+    /**
+     * \brief Checks whether translation is pending
+     * \returns \c true if translation has not started
+     */
+    bool IsPending() const {
+      return m_state.load() == State::Pending;
+    }
+
+  private:
+
+    enum class State : uint32_t {
+      Pending,
+      Queued,
+      Compiling,
+      Ready,
+    };
+
+    D3D11Device*              m_device;
+    D3D11ShaderModuleSet*     m_moduleSet;
+
+    DxvkShaderKey             m_key;
+    DxbcModuleInfo            m_moduleInfo;
+    DxbcTessInfo              m_tess = { };
+    DxbcXfbInfo               m_xfb  = { };
+    std::vector<std::string>  m_xfbNames;
+    std::vector<char>         m_bytecode;
+
+    dxvk::mutex               m_mutex;
+    dxvk::condition_variable  m_cond;
+    std::atomic<State>        m_state = { State::Pending };
+
+    D3D11CommonShader         m_shader;
+
+  };
   
   
   /**
@@ -128,6 +228,10 @@ namespace dxvk {
    * times, so we should cache the resulting shader modules
    * and reuse them rather than creating new ones. This
    * class is thread-safe.
+   *
+   * If shader translation is deferred, this also manages
+   * the worker threads that translate shaders that are
+   * about to be used in the background.
    */
   class D3D11ShaderModuleSet {
     
@@ -142,7 +246,15 @@ namespace dxvk {
       const DxbcModuleInfo*     pDxbcModuleInfo,
       const void*               pShaderBytecode,
             size_t              BytecodeLength,
+            bool                Deferred,
             D3D11CommonShader*  pShader);
+
+    /**
+     * \brief Queues a deferred shader for translation
+     * \param [in] pShader The shader to translate
+     */
+    void QueueShader(
+            D3D11DeferredShader* pShader);
     
   private:
     
@@ -152,6 +264,14 @@ namespace dxvk {
       DxvkShaderKey,
       D3D11CommonShader,
       DxvkHash, DxvkEq> m_modules;
+
+    dxvk::mutex                           m_workerLock;
+    dxvk::condition_variable              m_workerCond;
+    std::queue<Rc<D3D11DeferredShader>>   m_workerQueue;
+    std::vector<dxvk::thread>             m_workerThreads;
+    bool                                  m_stopWorkers = false;
+
+    void runWorker();
     
   };
   
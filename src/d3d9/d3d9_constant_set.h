@@ -44,9 +44,20 @@ namespace dxvk {
     Rc<DxvkBuffer>        boolBuffer;
   };
 
+  /**
+   * \brief Constant buffer ring size
+   *
+   * Hardware constant sets are sub-allocated from a
+   * buffer of this size, which is only invalidated
+   * once all of its memory has been used up.
+   */
+  constexpr VkDeviceSize D3D9ConstantRingSize = 256ull << 10;
+
   struct D3D9ConstantSets {
     D3D9SwvpConstantBuffers   swvpBuffers;
     Rc<DxvkBuffer>            buffer;
+    DxvkBufferSliceHandle     bufferSlice  = {};
+    VkDeviceSize              bufferOffset = 0;
     DxsoShaderMetaInfo        meta  = {};
     bool                      dirty = true;
   };
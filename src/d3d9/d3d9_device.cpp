@@ -5055,11 +5055,12 @@ namespace dxvk {
           bool                SSBO,
           VkDeviceSize        Size,
           DxsoProgramType     ShaderStage,
-          DxsoConstantBuffers BufferType) {
+          DxsoConstantBuffers BufferType,
+          VkDeviceSize        Capacity) {
     DxvkBufferCreateInfo info = { };
     info.usage  = SSBO ? VK_BUFFER_USAGE_STORAGE_BUFFER_BIT : VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
     info.access = SSBO ? VK_ACCESS_SHADER_READ_BIT          : VK_ACCESS_UNIFORM_READ_BIT;
-    info.size   = Size;
+    info.size   = std::max(Size, Capacity);
     info.stages = ShaderStage == DxsoProgramType::VertexShader
       ? VK_PIPELINE_STAGE_VERTEX_SHADER_BIT
       : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
@@ -5078,17 +5079,13 @@ namespace dxvk {
 
     EmitCs([
       cSlotId = slotId,
-      cBuffer = buffer
+      cBuffer = buffer,
+      cSize   = Size
     ] (DxvkContext* ctx) {
       ctx->bindResourceBuffer(cSlotId,
-        DxvkBufferSlice(cBuffer, 0, cBuffer->info().size));
+        DxvkBufferSlice(cBuffer, 0, cSize));
     });
 
-    if (ShaderStage == DxsoProgramType::PixelShader)
-      m_boundPSConstantsBufferSize = buffer->info().size;
-    else
-      m_boundVSConstantsBufferSize = buffer->info().size;
-
     return buffer;
   }
 
@@ -5099,14 +5096,20 @@ namespace dxvk {
         CreateConstantBuffer(false,
                              m_vsLayout.totalSize(),
                              DxsoProgramType::VertexShader,
-                             DxsoConstantBuffers::VSConstantBuffer);
+                             DxsoConstantBuffers::VSConstantBuffer,
+                             D3D9ConstantRingSize);
+      m_consts[DxsoProgramTypes::VertexShader].bufferSlice =
+        m_consts[DxsoProgramTypes::VertexShader].buffer->getSliceHandle();
     }
     // SWVP constant buffers are created late based on the amount of constants set by the application
     m_consts[DxsoProgramTypes::PixelShader].buffer =
       CreateConstantBuffer(false,
                           m_psLayout.totalSize(),
                           DxsoProgramType::PixelShader,
-                          DxsoConstantBuffers::PSConstantBuffer);
+                          DxsoConstantBuffers::PSConstantBuffer,
+                          D3D9ConstantRingSize);
+    m_consts[DxsoProgramTypes::PixelShader].bufferSlice =
+      m_consts[DxsoProgramTypes::PixelShader].buffer->getSliceHandle();
 
     m_vsClipPlanes =
       CreateConstantBuffer(false,
@@ -5252,30 +5255,40 @@ namespace dxvk {
     const uint32_t bufferSize = align(std::max(floatDataSize + intRange, alignment), alignment);
     floatDataSize = bufferSize - intRange; // Read additional floats for padding so we don't end up with garbage data
 
-    VkDeviceSize& boundConstantBufferSize = ShaderStage == DxsoProgramType::VertexShader ? m_boundVSConstantsBufferSize : m_boundPSConstantsBufferSize;
-    if (boundConstantBufferSize < bufferSize) {
-      constexpr uint32_t slotId = computeResourceSlotId(ShaderStage, DxsoBindingType::ConstantBuffer, 0);
+    // Sub-allocate the constant data from the current buffer slice and
+    // only invalidate the buffer once the slice is used up. Since the
+    // bound buffer stays the same, changing the offset only requires
+    // updating dynamic offsets rather than writing new descriptors.
+    const VkDeviceSize offsetAlignment = m_dxvkDevice->properties().core.properties.limits.minUniformBufferOffsetAlignment;
+    VkDeviceSize offset = align(constSet.bufferOffset, offsetAlignment);
+
+    if (offset + bufferSize > constSet.buffer->info().size) {
+      constSet.bufferSlice = constSet.buffer->allocSlice();
+      offset = 0;
+
       EmitCs([
         cBuffer = constSet.buffer,
-        cSlotId = slotId,
-        cSize   = bufferSize
+        cSlice  = constSet.bufferSlice
       ] (DxvkContext* ctx) {
-        ctx->bindResourceBuffer(cSlotId,
-          DxvkBufferSlice(cBuffer, 0, cSize));
+        ctx->invalidateBuffer(cBuffer, cSlice);
       });
-      boundConstantBufferSize = bufferSize;
     }
 
-    DxvkBufferSliceHandle slice = constSet.buffer->allocSlice();
+    constSet.bufferOffset = offset + bufferSize;
 
+    constexpr uint32_t slotId = computeResourceSlotId(ShaderStage, DxsoBindingType::ConstantBuffer, 0);
     EmitCs([
       cBuffer = constSet.buffer,
-      cSlice  = slice
+      cSlotId = slotId,
+      cOffset = offset,
+      cSize   = VkDeviceSize(bufferSize)
     ] (DxvkContext* ctx) {
-      ctx->invalidateBuffer(cBuffer, cSlice);
+      ctx->bindResourceBuffer(cSlotId,
+        DxvkBufferSlice(cBuffer, cOffset, cSize));
     });
 
-    auto* dst = reinterpret_cast<HardwareLayoutType*>(slice.mapPtr);
+    auto* dst = reinterpret_cast<HardwareLayoutType*>(
+      reinterpret_cast<char*>(constSet.bufferSlice.mapPtr) + offset);
 
     if (constSet.meta.maxConstIndexI != 0)
       std::memcpy(dst->iConsts, Src.iConsts, intDataSize);
@@ -742,7 +742,8 @@ namespace dxvk {
             bool                SSBO,
             VkDeviceSize        Size,
             DxsoProgramType     ShaderStage,
-            DxsoConstantBuffers BufferType);
+            DxsoConstantBuffers BufferType,
+            VkDeviceSize        Capacity = 0);
 
     void CreateConstantBuffers();
 
@@ -938,13 +939,14 @@ namespace dxvk {
   private:
 
     DxvkCsChunkRef AllocCsChunk() {
-      DxvkCsChunk* chunk = m_csChunkPool.allocChunk(DxvkCsChunkFlag::SingleUse);
+      DxvkCsChunk* chunk = m_csChunkPool.allocChunk(DxvkCsChunkFlag::SingleUse, m_csChunkSize);
       return DxvkCsChunkRef(chunk, &m_csChunkPool);
     }
 
     template<typename Cmd>
     void EmitCs(Cmd&& command) {
       if (unlikely(!m_csChunk->push(command))) {
+        m_csChunkSize = m_csChunk->getNextSize(DxvkCsChunkSize::Medium);
         EmitCsChunk(std::move(m_csChunk));
 
         m_csChunk = AllocCsChunk();
@@ -956,6 +958,7 @@ namespace dxvk {
 
     void FlushCsChunk() {
       if (likely(!m_csChunk->empty())) {
+        m_csChunkSize = m_csChunk->getNextSize(DxvkCsChunkSize::Medium);
         EmitCsChunk(std::move(m_csChunk));
         m_csChunk = AllocCsChunk();
       }
@@ -1268,8 +1271,6 @@ namespace dxvk {
     uint32_t                        m_vsIntConstsCount   = 0;
     uint32_t                        m_vsBoolConstsCount  = 0;
     uint32_t                        m_psFloatConstsCount = 0;
-    VkDeviceSize                    m_boundVSConstantsBufferSize = 0;
-    VkDeviceSize                    m_boundPSConstantsBufferSize = 0;
 
     D3D9ConstantLayout              m_vsLayout;
     D3D9ConstantLayout              m_psLayout;
@@ -1283,6 +1284,7 @@ namespace dxvk {
     dxvk::high_resolution_clock::time_point m_lastFlush
       = dxvk::high_resolution_clock::now();
     DxvkCsThread                    m_csThread;
+    DxvkCsChunkSize                 m_csChunkSize = DxvkCsChunkSize::Medium;
     DxvkCsChunkRef                  m_csChunk;
     uint64_t                        m_csSeqNum = 0ull;
     bool                            m_csIsBusy = false;
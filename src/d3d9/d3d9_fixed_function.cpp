@@ -17,413 +17,6 @@ namespace dxvk {
     invariantPosition = options->invariantPosition;
   }
 
-  uint32_t DoFixedFunctionFog(SpirvModule& spvModule, const D3D9FogContext& fogCtx) {
-    uint32_t floatType  = spvModule.defFloatType(32);
-    uint32_t uint32Type = spvModule.defIntType(32, 0);
-    uint32_t vec3Type   = spvModule.defVectorType(floatType, 3);
-    uint32_t vec4Type   = spvModule.defVectorType(floatType, 4);
-    uint32_t floatPtr   = spvModule.defPointerType(floatType, spv::StorageClassPushConstant);
-    uint32_t vec3Ptr    = spvModule.defPointerType(vec3Type,  spv::StorageClassPushConstant);
-
-    uint32_t fogColorMember = spvModule.constu32(uint32_t(D3D9RenderStateItem::FogColor));
-    uint32_t fogColor = spvModule.opLoad(vec3Type,
-      spvModule.opAccessChain(vec3Ptr, fogCtx.RenderState, 1, &fogColorMember));
-
-    uint32_t fogScaleMember = spvModule.constu32(uint32_t(D3D9RenderStateItem::FogScale));
-    uint32_t fogScale = spvModule.opLoad(floatType,
-      spvModule.opAccessChain(floatPtr, fogCtx.RenderState, 1, &fogScaleMember));
-
-    uint32_t fogEndMember = spvModule.constu32(uint32_t(D3D9RenderStateItem::FogEnd));
-    uint32_t fogEnd = spvModule.opLoad(floatType,
-      spvModule.opAccessChain(floatPtr, fogCtx.RenderState, 1, &fogEndMember));
-
-    uint32_t fogDensityMember = spvModule.constu32(uint32_t(D3D9RenderStateItem::FogDensity));
-    uint32_t fogDensity = spvModule.opLoad(floatType,
-      spvModule.opAccessChain(floatPtr, fogCtx.RenderState, 1, &fogDensityMember));
-
-    uint32_t fogMode = spvModule.specConst32(uint32Type, 0);
-
-    if (!fogCtx.IsPixel) {
-      spvModule.setDebugName(fogMode, "vertex_fog_mode");
-      spvModule.decorateSpecId(fogMode, getSpecId(D3D9SpecConstantId::VertexFogMode));
-    }
-    else {
-      spvModule.setDebugName(fogMode, "pixel_fog_mode");
-      spvModule.decorateSpecId(fogMode, getSpecId(D3D9SpecConstantId::PixelFogMode));
-    }
-
-    uint32_t fogEnabled = spvModule.specConstBool(false);
-    spvModule.setDebugName(fogEnabled, "fog_enabled");
-    spvModule.decorateSpecId(fogEnabled, getSpecId(D3D9SpecConstantId::FogEnabled));
-
-    uint32_t doFog   = spvModule.allocateId();
-    uint32_t skipFog = spvModule.allocateId();
-
-    uint32_t returnType     = fogCtx.IsPixel ? vec4Type : floatType;
-    uint32_t returnTypePtr  = spvModule.defPointerType(returnType, spv::StorageClassPrivate);
-    uint32_t returnValuePtr = spvModule.newVar(returnTypePtr, spv::StorageClassPrivate);
-    spvModule.opStore(returnValuePtr, fogCtx.IsPixel ? fogCtx.oColor : spvModule.constf32(0.0f));
-
-    // Actually do the fog now we have all the vars in-place.
-
-    spvModule.opSelectionMerge(skipFog, spv::SelectionControlMaskNone);
-    spvModule.opBranchConditional(fogEnabled, doFog, skipFog);
-
-    spvModule.opLabel(doFog);
-
-    uint32_t wIndex = 3;
-    uint32_t zIndex = 2;
-
-    uint32_t w = spvModule.opCompositeExtract(floatType, fogCtx.vPos, 1, &wIndex);
-    uint32_t z = spvModule.opCompositeExtract(floatType, fogCtx.vPos, 1, &zIndex);
-
-    uint32_t depth = 0;
-    if (fogCtx.IsPixel)
-      depth = spvModule.opFMul(floatType, z, spvModule.opFDiv(floatType, spvModule.constf32(1.0f), w));
-    else {
-      if (fogCtx.RangeFog) {
-        std::array<uint32_t, 3> indices = { 0, 1, 2 };
-        uint32_t pos3 = spvModule.opVectorShuffle(vec3Type, fogCtx.vPos, fogCtx.vPos, indices.size(), indices.data());
-        depth = spvModule.opLength(floatType, pos3);
-      }
-      else
-        depth = fogCtx.HasFogInput
-          ? fogCtx.vFog
-          : spvModule.opFAbs(floatType, z);
-    }
-    uint32_t fogFactor;
-    if (!fogCtx.IsPixel && fogCtx.IsFixedFunction && fogCtx.IsPositionT) {
-      fogFactor = fogCtx.HasSpecular
-        ? spvModule.opCompositeExtract(floatType, fogCtx.Specular, 1, &wIndex)
-        : spvModule.constf32(1.0f);
-    } else {
-      uint32_t applyFogFactor = spvModule.allocateId();
-
-      std::array<SpirvPhiLabel, 4> fogVariables;
-
-      std::array<SpirvSwitchCaseLabel, 4> fogCaseLabels = { {
-        { uint32_t(D3DFOG_NONE),      spvModule.allocateId() },
-        { uint32_t(D3DFOG_EXP),       spvModule.allocateId() },
-        { uint32_t(D3DFOG_EXP2),      spvModule.allocateId() },
-        { uint32_t(D3DFOG_LINEAR),    spvModule.allocateId() },
-      } };
-
-      spvModule.opSelectionMerge(applyFogFactor, spv::SelectionControlMaskNone);
-      spvModule.opSwitch(fogMode,
-        fogCaseLabels[D3DFOG_NONE].labelId,
-        fogCaseLabels.size(),
-        fogCaseLabels.data());
-
-      for (uint32_t i = 0; i < fogCaseLabels.size(); i++) {
-        spvModule.opLabel(fogCaseLabels[i].labelId);
-        
-        fogVariables[i].labelId = fogCaseLabels[i].labelId;
-        fogVariables[i].varId   = [&] {
-          auto mode = D3DFOGMODE(fogCaseLabels[i].literal);
-          switch (mode) {
-            default:
-            // vFog
-            case D3DFOG_NONE: {
-              if (fogCtx.IsPixel)
-                return fogCtx.vFog;
-
-              if (fogCtx.IsFixedFunction && fogCtx.HasSpecular)
-                return spvModule.opCompositeExtract(floatType, fogCtx.Specular, 1, &wIndex);
-
-              return spvModule.constf32(1.0f);
-            }
-
-            // (end - d) / (end - start)
-            case D3DFOG_LINEAR: {
-              uint32_t fogFactor = spvModule.opFSub(floatType, fogEnd, depth);
-              fogFactor = spvModule.opFMul(floatType, fogFactor, fogScale);
-              fogFactor = spvModule.opNClamp(floatType, fogFactor, spvModule.constf32(0.0f), spvModule.constf32(1.0f));
-              return fogFactor;
-            }
-
-            // 1 / (e^[d * density])^2
-            case D3DFOG_EXP2:
-            // 1 / (e^[d * density])
-            case D3DFOG_EXP: {
-              uint32_t fogFactor = spvModule.opFMul(floatType, depth, fogDensity);
-
-              if (mode == D3DFOG_EXP2)
-                fogFactor = spvModule.opFMul(floatType, fogFactor, fogFactor);
-
-              // Provides the rcp.
-              fogFactor = spvModule.opFNegate(floatType, fogFactor);
-              fogFactor = spvModule.opExp(floatType, fogFactor);
-              return fogFactor;
-            }
-          }
-        }();
-        
-        spvModule.opBranch(applyFogFactor);
-      }
-
-      spvModule.opLabel(applyFogFactor);
-
-      fogFactor = spvModule.opPhi(floatType,
-        fogVariables.size(),
-        fogVariables.data());
-    }
-
-    uint32_t fogRetValue = 0;
-
-    // Return the new color if we are doing this in PS
-    // or just the fog factor for oFog in VS
-    if (fogCtx.IsPixel) {
-      std::array<uint32_t, 4> indices = { 0, 1, 2, 6 };
-
-      uint32_t color = fogCtx.oColor;
-
-      uint32_t color3 = spvModule.opVectorShuffle(vec3Type, color, color, 3, indices.data());
-
-      std::array<uint32_t, 3> fogFacIndices = { fogFactor, fogFactor, fogFactor };
-      uint32_t fogFact3 = spvModule.opCompositeConstruct(vec3Type, fogFacIndices.size(), fogFacIndices.data());
-
-      uint32_t lerpedFrog = spvModule.opFMix(vec3Type, fogColor, color3, fogFact3);
-
-      fogRetValue = spvModule.opVectorShuffle(vec4Type, lerpedFrog, color, indices.size(), indices.data());
-    }
-    else
-      fogRetValue = fogFactor;
-
-    spvModule.opStore(returnValuePtr, fogRetValue);
-
-    spvModule.opBranch(skipFog);
-
-    spvModule.opLabel(skipFog);
-
-    return spvModule.opLoad(returnType, returnValuePtr);
-  }
-
-
-  uint32_t SetupRenderStateBlock(SpirvModule& spvModule, uint32_t count) {
-    uint32_t floatType = spvModule.defFloatType(32);
-    uint32_t vec3Type  = spvModule.defVectorType(floatType, 3);
-
-    std::array<uint32_t, 11> rsMembers = {{
-      vec3Type,
-      floatType,
-      floatType,
-      floatType,
-      floatType,
-
-      floatType,
-      floatType,
-      floatType,
-      floatType,
-      floatType,
-      floatType,
-    }};
-
-    uint32_t rsStruct = spvModule.defStructTypeUnique(count, rsMembers.data());
-    uint32_t rsBlock = spvModule.newVar(
-      spvModule.defPointerType(rsStruct, spv::StorageClassPushConstant),
-      spv::StorageClassPushConstant);
-    
-    spvModule.setDebugName         (rsBlock, "render_state");
-
-    spvModule.setDebugName         (rsStruct, "render_state_t");
-    spvModule.decorate             (rsStruct, spv::DecorationBlock);
-
-    uint32_t memberIdx = 0;
-    auto SetMemberName = [&](const char* name, uint32_t offset) {
-      if (memberIdx >= count)
-        return;
-
-      spvModule.setDebugMemberName   (rsStruct, memberIdx, name);
-      spvModule.memberDecorateOffset (rsStruct, memberIdx, offset);
-      memberIdx++;
-    };
-
-    SetMemberName("fog_color",      offsetof(D3D9RenderStateInfo, fogColor));
-    SetMemberName("fog_scale",      offsetof(D3D9RenderStateInfo, fogScale));
-    SetMemberName("fog_end",        offsetof(D3D9RenderStateInfo, fogEnd));
-    SetMemberName("fog_density",    offsetof(D3D9RenderStateInfo, fogDensity));
-    SetMemberName("alpha_ref",      offsetof(D3D9RenderStateInfo, alphaRef));
-    SetMemberName("point_size",     offsetof(D3D9RenderStateInfo, pointSize));
-    SetMemberName("point_size_min", offsetof(D3D9RenderStateInfo, pointSizeMin));
-    SetMemberName("point_size_max", offsetof(D3D9RenderStateInfo, pointSizeMax));
-    SetMemberName("point_scale_a",  offsetof(D3D9RenderStateInfo, pointScaleA));
-    SetMemberName("point_scale_b",  offsetof(D3D9RenderStateInfo, pointScaleB));
-    SetMemberName("point_scale_c",  offsetof(D3D9RenderStateInfo, pointScaleC));
-
-    return rsBlock;
-  }
-
-
-  D3D9PointSizeInfoVS GetPointSizeInfoVS(SpirvModule& spvModule, uint32_t vPos, uint32_t vtx, uint32_t perVertPointSize, uint32_t rsBlock, bool isFixedFunction) {
-    uint32_t floatType  = spvModule.defFloatType(32);
-    uint32_t floatPtr   = spvModule.defPointerType(floatType, spv::StorageClassPushConstant);
-    uint32_t vec3Type   = spvModule.defVectorType(floatType, 3);
-    uint32_t vec4Type   = spvModule.defVectorType(floatType, 4);
-    uint32_t uint32Type = spvModule.defIntType(32, 0);
-    uint32_t boolType   = spvModule.defBoolType();
-
-    auto LoadFloat = [&](D3D9RenderStateItem item) {
-      uint32_t index = spvModule.constu32(uint32_t(item));
-      return spvModule.opLoad(floatType, spvModule.opAccessChain(floatPtr, rsBlock, 1, &index));
-    };
-
-    uint32_t value = perVertPointSize != 0 ? perVertPointSize : LoadFloat(D3D9RenderStateItem::PointSize);
-
-    if (isFixedFunction) {
-      uint32_t pointMode = spvModule.specConst32(uint32Type, 0);
-      spvModule.setDebugName(pointMode, "point_mode");
-      spvModule.decorateSpecId(pointMode, getSpecId(D3D9SpecConstantId::PointMode));
-
-      uint32_t scaleBit  = spvModule.opBitFieldUExtract(uint32Type, pointMode, spvModule.consti32(0), spvModule.consti32(1));
-      uint32_t isScale   = spvModule.opIEqual(boolType, scaleBit, spvModule.constu32(1));
-
-      uint32_t scaleC = LoadFloat(D3D9RenderStateItem::PointScaleC);
-      uint32_t scaleB = LoadFloat(D3D9RenderStateItem::PointScaleB);
-      uint32_t scaleA = LoadFloat(D3D9RenderStateItem::PointScaleA);
-
-      std::array<uint32_t, 4> indices = { 0, 1, 2, 3 };
-
-      uint32_t vtx3;
-      if (vPos != 0) {
-        vPos = spvModule.opLoad(vec4Type, vPos);
-
-        uint32_t rhw  = spvModule.opCompositeExtract(floatType, vPos, 1, &indices[3]);
-                 rhw  = spvModule.opFDiv(floatType, spvModule.constf32(1.0f), rhw);
-        uint32_t pos3 = spvModule.opVectorShuffle(vec3Type, vPos, vPos, 3, indices.data());
-                 vtx3 = spvModule.opVectorTimesScalar(vec3Type, pos3, rhw);
-      } else {
-                 vtx3 = spvModule.opVectorShuffle(vec3Type, vtx, vtx, 3, indices.data());
-      }
-
-      uint32_t DeSqr      = spvModule.opDot (floatType, vtx3, vtx3);
-      uint32_t De         = spvModule.opSqrt(floatType, DeSqr);
-      uint32_t scaleValue = spvModule.opFMul(floatType, scaleC, DeSqr);
-               scaleValue = spvModule.opFFma(floatType, scaleB, De, scaleValue);
-               scaleValue = spvModule.opFAdd(floatType, scaleA, scaleValue);
-               scaleValue = spvModule.opSqrt(floatType, scaleValue);
-               scaleValue = spvModule.opFDiv(floatType, value, scaleValue);
-
-      value = spvModule.opSelect(floatType, isScale, scaleValue, value);
-    }
-
-    uint32_t min   = LoadFloat(D3D9RenderStateItem::PointSizeMin);
-    uint32_t max   = LoadFloat(D3D9RenderStateItem::PointSizeMax);
-
-    D3D9PointSizeInfoVS info;
-    info.defaultValue = value;
-    info.min          = min;
-    info.max          = max;
-
-    return info;
-  }
-
-
-  D3D9PointSizeInfoPS GetPointSizeInfoPS(SpirvModule& spvModule, uint32_t rsBlock) {
-    uint32_t uint32Type = spvModule.defIntType(32, 0);
-    uint32_t boolType   = spvModule.defBoolType();
-    uint32_t boolVec4   = spvModule.defVectorType(boolType, 4);
-
-    uint32_t pointMode = spvModule.specConst32(uint32Type, 0);
-    spvModule.setDebugName(pointMode, "point_mode");
-    spvModule.decorateSpecId(pointMode, getSpecId(D3D9SpecConstantId::PointMode));
-
-    uint32_t spriteBit  = spvModule.opBitFieldUExtract(uint32Type, pointMode, spvModule.consti32(1), spvModule.consti32(1));
-    uint32_t isSprite   = spvModule.opIEqual(boolType, spriteBit, spvModule.constu32(1));
-
-    std::array<uint32_t, 4> isSpriteIndices;
-    for (uint32_t i = 0; i < isSpriteIndices.size(); i++)
-      isSpriteIndices[i] = isSprite;
-
-    isSprite = spvModule.opCompositeConstruct(boolVec4, isSpriteIndices.size(), isSpriteIndices.data());
-
-    D3D9PointSizeInfoPS info;
-    info.isSprite = isSprite;
-
-    return info;
-  }
-
-
-  uint32_t GetPointCoord(SpirvModule& spvModule, std::vector<uint32_t>& entryPointInterfaces) {
-    uint32_t floatType  = spvModule.defFloatType(32);
-    uint32_t vec2Type   = spvModule.defVectorType(floatType, 2);
-    uint32_t vec4Type   = spvModule.defVectorType(floatType, 4);
-    uint32_t vec2Ptr    = spvModule.defPointerType(vec2Type, spv::StorageClassInput);
-
-    uint32_t pointCoordPtr = spvModule.newVar(vec2Ptr, spv::StorageClassInput);
-
-    spvModule.decorateBuiltIn(pointCoordPtr, spv::BuiltInPointCoord);
-    entryPointInterfaces.push_back(pointCoordPtr);
-
-    uint32_t pointCoord    = spvModule.opLoad(vec2Type, pointCoordPtr);
-
-    std::array<uint32_t, 4> indices = { 0, 1, 2, 3 };
-
-    std::array<uint32_t, 4> pointCoordIndices = {
-      spvModule.opCompositeExtract(floatType, pointCoord, 1, &indices[0]),
-      spvModule.opCompositeExtract(floatType, pointCoord, 1, &indices[1]),
-      spvModule.constf32(0.0f),
-      spvModule.constf32(0.0f)
-    };
-
-    return spvModule.opCompositeConstruct(vec4Type, pointCoordIndices.size(), pointCoordIndices.data());
-  }
-
-
-  uint32_t GetSharedConstants(SpirvModule& spvModule) {
-    uint32_t float_t = spvModule.defFloatType(32);
-    uint32_t vec2_t  = spvModule.defVectorType(float_t, 2);
-    uint32_t vec4_t  = spvModule.defVectorType(float_t, 4);
-
-    std::array<uint32_t, D3D9SharedPSStages_Count> stageMembers = {
-      vec4_t,
-
-      vec2_t,
-      vec2_t,
-
-      float_t,
-      float_t,
-    };
-
-    std::array<decltype(stageMembers), caps::TextureStageCount> members;
-
-    for (auto& member : members)
-      member = stageMembers;
-
-    const uint32_t structType =
-      spvModule.defStructType(members.size() * stageMembers.size(), members[0].data());
-
-    spvModule.decorateBlock(structType);
-
-    uint32_t offset = 0;
-    for (uint32_t stage = 0; stage < caps::TextureStageCount; stage++) {
-      spvModule.memberDecorateOffset(structType, stage * D3D9SharedPSStages_Count + D3D9SharedPSStages_Constant, offset);
-      offset += sizeof(float) * 4;
-
-      spvModule.memberDecorateOffset(structType, stage * D3D9SharedPSStages_Count + D3D9SharedPSStages_BumpEnvMat0, offset);
-      offset += sizeof(float) * 2;
-
-      spvModule.memberDecorateOffset(structType, stage * D3D9SharedPSStages_Count + D3D9SharedPSStages_BumpEnvMat1, offset);
-      offset += sizeof(float) * 2;
-
-      spvModule.memberDecorateOffset(structType, stage * D3D9SharedPSStages_Count + D3D9SharedPSStages_BumpEnvLScale, offset);
-      offset += sizeof(float);
-
-      spvModule.memberDecorateOffset(structType, stage * D3D9SharedPSStages_Count + D3D9SharedPSStages_BumpEnvLOffset, offset);
-      offset += sizeof(float);
-
-      // Padding...
-      offset += sizeof(float) * 2;
-    }
-
-    uint32_t sharedState = spvModule.newVar(
-      spvModule.defPointerType(structType, spv::StorageClassUniform),
-      spv::StorageClassUniform);
-
-    spvModule.setDebugName(sharedState, "D3D9SharedPS");
-
-    return sharedState;
-  }
-
 
   enum class D3D9FFVSMembers {
     WorldViewMatrix,
@@ -265,7 +265,15 @@ namespace dxvk {
         info.xfbStrides[i] = m_moduleInfo.xfb->strides[i];
     }
 
-    return new DxvkShader(info, m_module.compile());
+    SpirvCodeBuffer code = m_module.compile();
+
+    if (m_moduleInfo.options.optimizeSpirv) {
+      SpirvOptimizer optimizer(code);
+      optimizer.run();
+      code = optimizer.getCode();
+    }
+
+    return new DxvkShader(info, std::move(code));
   }
   
   
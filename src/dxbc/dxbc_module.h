@@ -48,6 +48,16 @@ namespace dxvk {
     Rc<DxbcIsgn> isgn() const { return m_isgnChunk; }
     Rc<DxbcIsgn> osgn() const { return m_osgnChunk; }
     
+    /**
+     * \brief Validates the shader code
+     * 
+     * Decodes the entire instruction stream without
+     * translating it, so that malformed bytecode can
+     * be rejected before compilation is deferred.
+     * Throws an exception if validation fails.
+     */
+    void validate() const;
+    
     /**
      * \brief Compiles DXBC shader to SPIR-V module
      * 
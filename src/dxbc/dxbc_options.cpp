@@ -42,6 +42,7 @@ namespace dxvk {
     zeroInitWorkgroupMemory  = options.zeroInitWorkgroupMemory;
     forceTgsmBarriers        = options.forceTgsmBarriers;
     disableMsaa              = options.disableMsaa;
+    optimizeSpirv            = options.optimizeShaders;
     dynamicIndexedConstantBufferAsSsbo = options.constantBufferRangeCheck;
 
     // Disable subgroup early discard on Nvidia because it may hurt performance
@@ -67,5 +68,30 @@ namespace dxvk {
      || adapter->matchesDriver(DxvkGpuVendor::Amd, VK_DRIVER_ID_MESA_RADV_KHR, 0, VK_MAKE_VERSION(20, 3, 0)))
       enableRtOutputNanFixup = true;
   }
+
+
+  Sha1Hash DxbcOptions::hash() const {
+    // Hash individual members rather than the struct
+    // itself so that padding bytes are not included
+    const std::array<uint64_t, 15> data = {{
+      uint64_t(useDepthClipWorkaround),
+      uint64_t(useStorageImageReadWithoutFormat),
+      uint64_t(useSubgroupOpsForAtomicCounters),
+      uint64_t(useDemoteToHelperInvocation),
+      uint64_t(useSubgroupOpsForEarlyDiscard),
+      uint64_t(useSdivForBufferIndex),
+      uint64_t(enableRtOutputNanFixup),
+      uint64_t(dynamicIndexedConstantBufferAsSsbo),
+      uint64_t(zeroInitWorkgroupMemory),
+      uint64_t(invariantPosition),
+      uint64_t(forceTgsmBarriers),
+      uint64_t(disableMsaa),
+      uint64_t(optimizeSpirv),
+      uint64_t(floatControl.raw()),
+      uint64_t(minSsboAlignment),
+    }};
+
+    return Sha1Hash::compute(data.data(), sizeof(data));
+  }
   
-}
\ No newline at end of file
+}
@@ -19,6 +19,15 @@ namespace dxvk {
     DxbcOptions();
     DxbcOptions(const Rc<DxvkDevice>& device, const D3D11Options& options);
 
+    /**
+     * \brief Computes hash of all options
+     *
+     * Used to identify shaders that were compiled
+     * with the same set of options in caches.
+     * \returns Options hash
+     */
+    Sha1Hash hash() const;
+
     // Clamp oDepth in fragment shaders if the depth
     // clip device feature is not supported
     bool useDepthClipWorkaround = false;
@@ -60,6 +69,9 @@ namespace dxvk {
     /// Replace ld_ms with ld
     bool disableMsaa = false;
 
+    /// Run the SPIR-V optimizer on generated code
+    bool optimizeSpirv = false;
+
     /// Float control flags
     DxbcFloatControlFlags floatControl;
 
@@ -6,7 +6,7 @@
 #include "../d3d9/d3d9_constant_set.h"
 #include "../d3d9/d3d9_state.h"
 #include "../d3d9/d3d9_spec_constants.h"
-#include "../d3d9/d3d9_fixed_function.h"
+#include "dxso_spirv_helpers.h"
 #include "dxso_util.h"
 
 #include "../dxvk/dxvk_spec_const.h"
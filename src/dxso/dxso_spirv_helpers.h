@@ -0,0 +1,51 @@
+#pragma once
+
+#include "../spirv/spirv_module.h"
+
+namespace dxvk {
+
+  struct D3D9FogContext {
+    // General inputs...
+    bool     IsPixel;
+    bool     RangeFog;
+    uint32_t RenderState;
+    uint32_t vPos;
+    uint32_t vFog;
+
+    uint32_t oColor;
+
+    bool     HasFogInput;
+
+    bool     IsFixedFunction;
+    bool     IsPositionT;
+    bool     HasSpecular;
+    uint32_t Specular;
+  };
+
+  // Returns new oFog if VS
+  // Returns new oColor if PS
+  uint32_t DoFixedFunctionFog(SpirvModule& spvModule, const D3D9FogContext& fogCtx);
+
+  // Returns a render state block
+  uint32_t SetupRenderStateBlock(SpirvModule& spvModule, uint32_t count);
+
+  struct D3D9PointSizeInfoVS {
+    uint32_t defaultValue;
+    uint32_t min;
+    uint32_t max;
+  };
+
+  // Default point size and point scale magic!
+  D3D9PointSizeInfoVS GetPointSizeInfoVS(SpirvModule& spvModule, uint32_t vPos, uint32_t vtx, uint32_t perVertPointSize, uint32_t rsBlock, bool isFixedFunction);
+
+  struct D3D9PointSizeInfoPS {
+    uint32_t isSprite;
+  };
+
+  D3D9PointSizeInfoPS GetPointSizeInfoPS(SpirvModule& spvModule, uint32_t rsBlock);
+
+  uint32_t GetPointCoord(SpirvModule& spvModule, std::vector<uint32_t>& entryPointInterfaces);
+
+  uint32_t GetSharedConstants(SpirvModule& spvModule);
+
+}
@@ -42,6 +42,9 @@ namespace dxvk {
 
     m_physSlice = slice;
     m_lazyAlloc = m_physSliceCount > 1;
+
+    m_physSliceTotal = m_physSliceCount;
+    m_trimTime = dxvk::high_resolution_clock::now();
   }
 
 
@@ -49,9 +52,148 @@ namespace dxvk {
     auto vkd = m_device->vkd();
 
     for (const auto& buffer : m_buffers)
+      vkd->vkDestroyBuffer(vkd->device(), buffer.handle.buffer, nullptr);
+    for (const auto& buffer : m_retiredBuffers)
       vkd->vkDestroyBuffer(vkd->device(), buffer.buffer, nullptr);
     vkd->vkDestroyBuffer(vkd->device(), m_buffer.buffer, nullptr);
   }
+
+
+  DxvkBufferSliceHandle DxvkBuffer::relocate() {
+    std::unique_lock<sync::Spinlock> freeLock(m_freeMutex);
+
+    DxvkBufferSliceHandle slice;
+    slice.handle = VK_NULL_HANDLE;
+    slice.offset = 0;
+    slice.length = m_physSliceLength;
+    slice.mapPtr = nullptr;
+
+    // Buffers that have been renamed before may have
+    // any number of slices in use by the GPU
+    if (!m_buffers.empty() || m_physSliceCount != 1
+     || m_physSlice.handle != m_buffer.buffer)
+      return slice;
+
+    DxvkBufferHandle handle;
+
+    try {
+      handle = allocBuffer(1, false);
+    } catch (const DxvkError& e) {
+      return slice;
+    }
+
+    slice.handle = handle.buffer;
+    slice.mapPtr = handle.memory.mapPtr(0);
+
+    { std::unique_lock<sync::Spinlock> swapLock(m_swapMutex);
+      m_retiredBuffers.push_back(std::exchange(m_buffer, std::move(handle)));
+    }
+
+    return std::exchange(m_physSlice, slice);
+  }
+
+
+  bool DxvkBuffer::freeRetiredBuffer(
+    const DxvkBufferSliceHandle& slice) {
+    DxvkBufferHandle handle;
+
+    { std::unique_lock<sync::Spinlock> swapLock(m_swapMutex);
+
+      auto entry = std::find_if(m_retiredBuffers.begin(), m_retiredBuffers.end(),
+        [&slice] (const DxvkBufferHandle& buffer) { return buffer.buffer == slice.handle; });
+
+      if (entry == m_retiredBuffers.end())
+        return false;
+
+      handle = std::move(*entry);
+      m_retiredBuffers.erase(entry);
+    }
+
+    // Memory gets freed when the handle goes out of scope
+    auto vkd = m_device->vkd();
+    vkd->vkDestroyBuffer(vkd->device(), handle.buffer, nullptr);
+    return true;
+  }
+
+
+  void DxvkBuffer::trimSlices(
+          std::vector<SliceBuffer>& released) {
+    // Any slice that is not in the free list is
+    // either in use by the GPU or the current slice
+    VkDeviceSize usedCount = m_physSliceTotal - m_freeSlices.size();
+    m_physSlicePeak = std::max(m_physSlicePeak, usedCount);
+
+    auto now = dxvk::high_resolution_clock::now();
+
+    if (now - m_trimTime < std::chrono::seconds(1))
+      return;
+
+    // Keep enough slices to cover peak usage during the
+    // last interval, with some headroom so that we don't
+    // immediately need to allocate another buffer. This
+    // needs at least one slice on top of the peak, since
+    // the caller is about to take a slice off the list.
+    VkDeviceSize keepCount = m_physSlicePeak + std::max<VkDeviceSize>(m_physSlicePeak / 2, 1);
+
+    m_physSlicePeak = usedCount;
+    m_trimTime = now;
+
+    // Buffer views cache view handles for each buffer
+    // handle, so we cannot destroy texel buffers here
+    VkBufferUsageFlags texelUsage = VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT
+                                  | VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT;
+
+    if (keepCount >= m_physSliceTotal || (m_info.usage & texelUsage))
+      return;
+
+    std::unordered_map<VkBuffer, VkDeviceSize> freeCounts;
+
+    for (const auto& slice : m_freeSlices)
+      freeCounts[slice.handle] += 1;
+
+    // Release the most recently allocated buffers first, since
+    // those are the largest. A buffer can only be released if
+    // none of its slices are in use, and we never release the
+    // last free slices since that would force an allocation.
+    VkDeviceSize freeCount = m_freeSlices.size();
+
+    for (size_t i = m_buffers.size(); i && m_physSliceTotal > keepCount; i--) {
+      SliceBuffer& buffer = m_buffers[i - 1];
+
+      if (freeCounts[buffer.handle.buffer] != buffer.sliceCount
+       || m_physSliceTotal - buffer.sliceCount < keepCount
+       || freeCount <= buffer.sliceCount)
+        continue;
+
+      freeCount -= buffer.sliceCount;
+      m_physSliceTotal -= buffer.sliceCount;
+      released.push_back(std::move(buffer));
+      m_buffers.erase(m_buffers.begin() + (i - 1));
+    }
+
+    if (released.empty())
+      return;
+
+    m_freeSlices.erase(std::remove_if(m_freeSlices.begin(), m_freeSlices.end(),
+      [&released] (const DxvkBufferSliceHandle& slice) {
+        return std::any_of(released.begin(), released.end(),
+          [&slice] (const SliceBuffer& buffer) { return buffer.handle.buffer == slice.handle; });
+      }), m_freeSlices.end());
+
+    // Size the next allocation relative to the remaining
+    // slices, as if the released buffers never existed
+    m_physSliceCount = std::min(m_physSliceTotal, m_physSliceMaxCount);
+  }
+
+
+  void DxvkBuffer::destroyBuffers(
+    const std::vector<SliceBuffer>& buffers) const {
+    // Memory gets freed when the handles go out of scope
+    auto vkd = m_device->vkd();
+
+    for (const auto& buffer : buffers)
+      vkd->vkDestroyBuffer(vkd->device(), buffer.handle.buffer, nullptr);
+  }
   
   
   DxvkBufferHandle DxvkBuffer::allocBuffer(VkDeviceSize sliceCount, bool clear) const {
@@ -9,6 +9,8 @@
 #include "dxvk_memory.h"
 #include "dxvk_resource.h"
 
+#include "../util/util_time.h"
+
 namespace dxvk {
 
   /**
@@ -233,12 +235,19 @@ namespace dxvk {
      * \returns The new buffer slice
      */
     DxvkBufferSliceHandle allocSlice() {
+      std::vector<SliceBuffer> released;
       std::unique_lock<sync::Spinlock> freeLock(m_freeMutex);
       
       // If no slices are available, swap the two free lists.
       if (unlikely(m_freeSlices.empty())) {
-        std::unique_lock<sync::Spinlock> swapLock(m_swapMutex);
-        std::swap(m_freeSlices, m_nextSlices);
+        { std::unique_lock<sync::Spinlock> swapLock(m_swapMutex);
+          std::swap(m_freeSlices, m_nextSlices);
+        }
+
+        // All free slices are now in the free list, which
+        // makes this a good point to release unused ones
+        if (unlikely(!m_buffers.empty()))
+          trimSlices(released);
       }
 
       // If there are still no slices available, create a new
@@ -250,7 +259,8 @@ namespace dxvk {
           for (uint32_t i = 0; i < m_physSliceCount; i++)
             pushSlice(handle, i);
 
-          m_buffers.push_back(std::move(handle));
+          m_buffers.push_back({ std::move(handle), m_physSliceCount });
+          m_physSliceTotal += m_physSliceCount;
           m_physSliceCount = std::min(m_physSliceCount * 2, m_physSliceMaxCount);
         } else {
           for (uint32_t i = 1; i < m_physSliceCount; i++)
@@ -263,6 +273,13 @@ namespace dxvk {
       // Take the first slice from the queue
       DxvkBufferSliceHandle result = m_freeSlices.back();
       m_freeSlices.pop_back();
+
+      // Destroying buffers may be slow, don't block other threads
+      if (unlikely(!released.empty())) {
+        freeLock.unlock();
+        destroyBuffers(released);
+      }
+
       return result;
     }
     
@@ -277,11 +294,62 @@ namespace dxvk {
     void freeSlice(const DxvkBufferSliceHandle& slice) {
       // Add slice to a separate free list to reduce lock contention.
       std::unique_lock<sync::Spinlock> swapLock(m_swapMutex);
+
+      // Slices of relocated storage are not reused
+      if (unlikely(!m_retiredBuffers.empty())) {
+        swapLock.unlock();
+
+        if (freeRetiredBuffer(slice))
+          return;
+
+        swapLock.lock();
+      }
+
       m_nextSlices.push_back(slice);
     }
+
+    /**
+     * \brief Checks whether the buffer should be relocated
+     *
+     * This is the case if the buffer memory was allocated
+     * from a chunk that is being evacuated. Host-visible
+     * buffers are never relocated since the application
+     * may hold a pointer to the mapped memory, and texel
+     * buffers are not relocated since buffer views cache
+     * view handles for each underlying buffer handle.
+     * \returns \c true if the buffer should be moved
+     */
+    bool needsRelocation() const {
+      VkBufferUsageFlags texelUsage = VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT
+                                    | VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT;
+
+      return !(m_memFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+          && !(m_info.usage & texelUsage)
+          && m_buffer.memory.isEvacuating();
+    }
+
+    /**
+     * \brief Moves the buffer to new storage
+     *
+     * Allocates new backing storage and replaces the current
+     * slice with it. Only buffers that have never been renamed
+     * can be relocated, since other slices may still be in use.
+     * The old storage is destroyed once the returned slice is
+     * freed via \ref freeSlice. Do not call this directly as
+     * this is called implicitly by the context, which also
+     * copies the buffer contents.
+     * \returns Previous buffer slice, or a slice with a
+     *    null handle if the buffer cannot be relocated.
+     */
+    DxvkBufferSliceHandle relocate();
     
   private:
 
+    struct SliceBuffer {
+      DxvkBufferHandle      handle;
+      VkDeviceSize          sliceCount;
+    };
+
     DxvkDevice*             m_device;
     DxvkBufferCreateInfo    m_info;
     DxvkMemoryAllocator*    m_memAlloc;
@@ -299,13 +367,18 @@ namespace dxvk {
     VkDeviceSize            m_physSliceStride   = 0;
     VkDeviceSize            m_physSliceCount    = 1;
     VkDeviceSize            m_physSliceMaxCount = 1;
+    VkDeviceSize            m_physSliceTotal    = 1;
+    VkDeviceSize            m_physSlicePeak     = 0;
+
+    dxvk::high_resolution_clock::time_point m_trimTime;
 
-    std::vector<DxvkBufferHandle>       m_buffers;
+    std::vector<SliceBuffer>            m_buffers;
     std::vector<DxvkBufferSliceHandle>  m_freeSlices;
 
     alignas(CACHE_LINE_SIZE)
     sync::Spinlock                      m_swapMutex;
     std::vector<DxvkBufferSliceHandle>  m_nextSlices;
+    std::vector<DxvkBufferHandle>       m_retiredBuffers;
 
     void pushSlice(const DxvkBufferHandle& handle, uint32_t index) {
       DxvkBufferSliceHandle slice;
@@ -320,6 +393,15 @@ namespace dxvk {
             VkDeviceSize          sliceCount,
             bool                  clear) const;
 
+    bool freeRetiredBuffer(
+      const DxvkBufferSliceHandle& slice);
+
+    void trimSlices(
+            std::vector<SliceBuffer>& released);
+
+    void destroyBuffers(
+      const std::vector<SliceBuffer>& buffers) const;
+
     VkDeviceSize computeSliceAlignment() const;
     
   };
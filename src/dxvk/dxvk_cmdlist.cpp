@@ -12,13 +12,17 @@ namespace dxvk {
     const auto& graphicsQueue = m_device->queues().graphics;
     const auto& transferQueue = m_device->queues().transfer;
 
-    VkFenceCreateInfo fenceInfo;
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.pNext = nullptr;
-    fenceInfo.flags = 0;
-    
-    if (m_vkd->vkCreateFence(m_vkd->device(), &fenceInfo, nullptr, &m_fence) != VK_SUCCESS)
-      throw DxvkError("DxvkCommandList: Failed to create fence");
+    // With timeline semaphores, the submission queue tracks
+    // completion for all command lists, so no fence is needed
+    if (!m_device->features().khrTimelineSemaphore.timelineSemaphore) {
+      VkFenceCreateInfo fenceInfo;
+      fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+      fenceInfo.pNext = nullptr;
+      fenceInfo.flags = 0;
+      
+      if (m_vkd->vkCreateFence(m_vkd->device(), &fenceInfo, nullptr, &m_fence) != VK_SUCCESS)
+        throw DxvkError("DxvkCommandList: Failed to create fence");
+    }
     
     VkCommandPoolCreateInfo poolInfo;
     poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
@@ -81,7 +85,9 @@ namespace dxvk {
   
   VkResult DxvkCommandList::submit(
           VkSemaphore     waitSemaphore,
-          VkSemaphore     wakeSemaphore) {
+          VkSemaphore     wakeSemaphore,
+          VkSemaphore     timelineSemaphore,
+          uint64_t        timelineValue) {
     const auto& graphics = m_device->queues().graphics;
     const auto& transfer = m_device->queues().transfer;
 
@@ -121,6 +127,11 @@ namespace dxvk {
       m_submission.addWakeSemaphore(entry.fence->handle(), entry.value);
     }
 
+    if (timelineSemaphore) {
+      m_submission.addWakeSemaphore(timelineSemaphore, timelineValue);
+      return submitToQueue(graphics.queueHandle, VK_NULL_HANDLE, m_submission);
+    }
+
     return submitToQueue(graphics.queueHandle, m_fence, m_submission);
   }
   
@@ -154,7 +165,7 @@ namespace dxvk {
      || m_vkd->vkBeginCommandBuffer(m_sdmaBuffer, &info) != VK_SUCCESS)
       Logger::err("DxvkCommandList: Failed to begin command buffer");
     
-    if (m_vkd->vkResetFences(m_vkd->device(), 1, &m_fence) != VK_SUCCESS)
+    if (m_fence && m_vkd->vkResetFences(m_vkd->device(), 1, &m_fence) != VK_SUCCESS)
       Logger::err("DxvkCommandList: Failed to reset fence");
     
     // Unconditionally mark the exec buffer as used. There
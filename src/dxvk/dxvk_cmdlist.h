@@ -89,17 +89,24 @@ namespace dxvk {
      * \param [in] queue Device queue
      * \param [in] waitSemaphore Semaphore to wait on
      * \param [in] wakeSemaphore Semaphore to signal
+     * \param [in] timelineSemaphore Timeline semaphore to
+     *    signal instead of the command list's own fence
+     * \param [in] timelineValue Value to signal
      * \returns Submission status
      */
     VkResult submit(
             VkSemaphore     waitSemaphore,
-            VkSemaphore     wakeSemaphore);
+            VkSemaphore     wakeSemaphore,
+            VkSemaphore     timelineSemaphore,
+            uint64_t        timelineValue);
     
     /**
      * \brief Synchronizes command buffer execution
      * 
      * Waits for the fence associated with
      * this command buffer to get signaled.
+     * Only valid if the command list was not
+     * submitted with a timeline semaphore.
      * \returns Synchronization status
      */
     VkResult synchronize();
@@ -164,11 +171,12 @@ namespace dxvk {
      * Adds a resource to the internal resource tracker.
      * Resources will be kept alive and "in use" until
      * the device can guarantee that the submission has
-     * completed.
+     * completed. Each resource is only tracked once per
+     * access type, no matter how often it gets used.
      */
-    template<DxvkAccess Access>
-    void trackResource(Rc<DxvkResource> rc) {
-      m_resources.trackResource<Access>(std::move(rc));
+    template<DxvkAccess Access, typename T>
+    void trackResource(const Rc<T>& rc) {
+      m_resources.trackResource<Access>(rc);
     }
     
     /**
@@ -331,6 +339,20 @@ namespace dxvk {
     }
     
     
+    void cmdBindDescriptorSets(
+            VkPipelineBindPoint       pipeline,
+            VkPipelineLayout          pipelineLayout,
+            uint32_t                  firstSet,
+            uint32_t                  descriptorSetCount,
+      const VkDescriptorSet*          descriptorSets,
+            uint32_t                  dynamicOffsetCount,
+      const uint32_t*                 pDynamicOffsets) {
+      m_vkd->vkCmdBindDescriptorSets(m_execBuffer,
+        pipeline, pipelineLayout, firstSet, descriptorSetCount,
+        descriptorSets, dynamicOffsetCount, pDynamicOffsets);
+    }
+    
+    
     void cmdBindIndexBuffer(
             VkBuffer                buffer,
             VkDeviceSize            offset,
@@ -795,7 +817,7 @@ namespace dxvk {
     Rc<vk::DeviceFn>    m_vkd;
     Rc<vk::InstanceFn>  m_vki;
     
-    VkFence             m_fence;
+    VkFence             m_fence = VK_NULL_HANDLE;
     
     VkCommandPool       m_graphicsPool = VK_NULL_HANDLE;
     VkCommandPool       m_transferPool = VK_NULL_HANDLE;
@@ -41,7 +41,7 @@ namespace dxvk {
       instance = this->findInstance(state);
 
       if (!instance) {
-        instance = this->createInstance(state);
+        instance = this->createInstance(state, m_pipeMgr->m_cache->handle());
         this->writePipelineStateToCache(state);
       }
     }
@@ -51,36 +51,41 @@ namespace dxvk {
 
 
   void DxvkComputePipeline::compilePipeline(
-    const DxvkComputePipelineStateInfo& state) {
+    const DxvkComputePipelineStateInfo& state,
+          VkPipelineCache               cache) {
     std::lock_guard<dxvk::mutex> lock(m_mutex);
 
     if (!this->findInstance(state))
-      this->createInstance(state);
+      this->createInstance(state, cache);
   }
   
   
   DxvkComputePipelineInstance* DxvkComputePipeline::createInstance(
-    const DxvkComputePipelineStateInfo& state) {
-    VkPipeline newPipelineHandle = this->createPipeline(state);
+    const DxvkComputePipelineStateInfo& state,
+          VkPipelineCache               cache) {
+    VkPipeline newPipelineHandle = this->createPipeline(state, cache);
 
     m_pipeMgr->m_numComputePipelines += 1;
-    return &(*m_pipelines.emplace(state, newPipelineHandle));
+    m_pipeMgr->m_cache->update();
+
+    DxvkComputePipelineInstance* instance = &(*m_pipelines.emplace(state, newPipelineHandle));
+    m_pipelineIndex.insert(state.hash(), instance);
+    return instance;
   }
 
   
   DxvkComputePipelineInstance* DxvkComputePipeline::findInstance(
     const DxvkComputePipelineStateInfo& state) {
-    for (auto& instance : m_pipelines) {
-      if (instance.isCompatible(state))
-        return &instance;
-    }
-    
-    return nullptr;
+    return m_pipelineIndex.find(state.hash(),
+      [&state] (const DxvkComputePipelineInstance& instance) {
+        return instance.isCompatible(state);
+      });
   }
   
   
   VkPipeline DxvkComputePipeline::createPipeline(
-    const DxvkComputePipelineStateInfo& state) const {
+    const DxvkComputePipelineStateInfo& state,
+          VkPipelineCache               cache) const {
     std::vector<VkDescriptorSetLayoutBinding> bindings;
 
     if (Logger::logLevel() <= LogLevel::Debug) {
@@ -119,7 +124,7 @@ namespace dxvk {
     
     VkPipeline pipeline = VK_NULL_HANDLE;
     if (m_vkd->vkCreateComputePipelines(m_vkd->device(),
-          m_pipeMgr->m_cache->handle(), 1, &info, nullptr, &pipeline) != VK_SUCCESS) {
+          cache, 1, &info, nullptr, &pipeline) != VK_SUCCESS) {
       Logger::err("DxvkComputePipeline: Failed to compile pipeline");
       Logger::err(str::format("  cs  : ", m_shaders.cs->debugName()));
       return VK_NULL_HANDLE;
@@ -2,6 +2,7 @@
 
 #include <vector>
 
+#include "../util/sync/sync_index.h"
 #include "../util/sync/sync_list.h"
 
 #include "dxvk_bind_mask.h"
@@ -130,9 +131,11 @@ namespace dxvk {
      * Asynchronously compiles the given pipeline
      * and stores the result for future use.
      * \param [in] state Pipeline state
+     * \param [in] cache Pipeline cache to use
      */
     void compilePipeline(
-      const DxvkComputePipelineStateInfo& state);
+      const DxvkComputePipelineStateInfo& state,
+            VkPipelineCache               cache);
     
   private:
     
@@ -145,17 +148,20 @@ namespace dxvk {
     Rc<DxvkPipelineLayout>      m_layout;
     
     alignas(CACHE_LINE_SIZE)
-    dxvk::mutex                             m_mutex;
-    sync::List<DxvkComputePipelineInstance> m_pipelines;
+    dxvk::mutex                                   m_mutex;
+    sync::List<DxvkComputePipelineInstance>       m_pipelines;
+    sync::HashIndex<DxvkComputePipelineInstance>  m_pipelineIndex;
     
     DxvkComputePipelineInstance* createInstance(
-      const DxvkComputePipelineStateInfo& state);
+      const DxvkComputePipelineStateInfo& state,
+            VkPipelineCache               cache);
     
     DxvkComputePipelineInstance* findInstance(
       const DxvkComputePipelineStateInfo& state);
     
     VkPipeline createPipeline(
-      const DxvkComputePipelineStateInfo& state) const;
+      const DxvkComputePipelineStateInfo& state,
+            VkPipelineCache               cache) const;
     
     void destroyPipeline(
             VkPipeline                    pipeline);
@@ -23,6 +23,11 @@ namespace dxvk {
     if (m_device->features().extExtendedDynamicState.extendedDynamicState)
       m_features.set(DxvkContextFeature::ExtendedDynamicState);
 
+    if (m_device->config().enableMemoryDefrag) {
+      m_features.set(DxvkContextFeature::MemoryDefrag);
+      m_relocationBudget = VkDeviceSize(std::max(m_device->config().memoryDefragBudget, 1)) << 20;
+    }
+
     // Init framebuffer info with default render pass in case
     // the app does not explicitly bind any render targets
     m_state.om.framebufferInfo = makeFramebufferInfo(m_state.om.renderTargets);
@@ -41,6 +46,17 @@ namespace dxvk {
     // Mark all resources as untracked
     m_vbTracked.clear();
     m_rcTracked.clear();
+
+    // Cached descriptor sets may reference resources
+    // that are no longer kept alive by this command list
+    m_descCache.clear();
+
+    // Force all descriptor sets to be rebound
+    m_gpSets.fill(VK_NULL_HANDLE);
+    m_cpSets.fill(VK_NULL_HANDLE);
+
+    m_gpSetLayout = nullptr;
+    m_cpSetLayout = nullptr;
     
     // The current state of the internal command buffer is
     // undefined, so we have to bind and set up everything
@@ -72,6 +88,7 @@ namespace dxvk {
   Rc<DxvkCommandList> DxvkContext::endRecording() {
     this->spillRenderPass(true);
     this->flushSharedImages();
+    this->relocateBuffers();
 
     m_sdmaBarriers.recordCommands(m_cmd);
     m_initBarriers.recordCommands(m_cmd);
@@ -144,6 +161,9 @@ namespace dxvk {
     m_state.vi.indexType   = indexType;
 
     m_flags.set(DxvkContextFlag::GpDirtyIndexBuffer);
+
+    if (unlikely(m_features.test(DxvkContextFeature::MemoryDefrag) && buffer.defined()))
+      this->scheduleRelocation(buffer.buffer());
   }
   
   
@@ -168,6 +188,9 @@ namespace dxvk {
     }
 
     m_rc[slot].bufferSlice = buffer;
+
+    if (unlikely(m_features.test(DxvkContextFeature::MemoryDefrag) && buffer.defined()))
+      this->scheduleRelocation(buffer.buffer());
   }
   
   
@@ -240,6 +263,9 @@ namespace dxvk {
 
     m_state.vi.vertexBuffers[binding] = buffer;
     m_flags.set(DxvkContextFlag::GpDirtyVertexBuffers);
+
+    if (unlikely(m_features.test(DxvkContextFeature::MemoryDefrag) && buffer.defined()))
+      this->scheduleRelocation(buffer.buffer());
     
     if (unlikely(m_state.vi.vertexStrides[binding] != stride)) {
       m_state.vi.vertexStrides[binding] = stride;
@@ -1750,6 +1776,14 @@ namespace dxvk {
     DxvkBufferSliceHandle prevSlice = buffer->rename(slice);
     m_cmd->freeBufferSlice(buffer, prevSlice);
     
+    this->updateBufferBindings(buffer,
+      prevSlice.handle == slice.handle);
+  }
+
+
+  void DxvkContext::updateBufferBindings(
+    const Rc<DxvkBuffer>&           buffer,
+          bool                      sameHandle) {
     // We also need to update all bindings that the buffer
     // may be bound to either directly or through views.
     VkBufferUsageFlags usage = buffer->info().usage &
@@ -1757,7 +1791,7 @@ namespace dxvk {
         VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
 
     if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
-      m_flags.set(prevSlice.handle == slice.handle
+      m_flags.set(sameHandle
         ? DxvkContextFlags(DxvkContextFlag::GpDirtyDescriptorBinding,
                            DxvkContextFlag::CpDirtyDescriptorBinding)
         : DxvkContextFlags(DxvkContextFlag::GpDirtyResources,
@@ -2117,6 +2151,79 @@ namespace dxvk {
   }
 
 
+  void DxvkContext::scheduleRelocation(
+    const Rc<DxvkBuffer>&           buffer) {
+    if (likely(!buffer->needsRelocation()))
+      return;
+
+    // Limit the amount of memory moved per frame
+    // in order to keep the copy overhead low
+    uint32_t frameId = m_device->getCurrentFrameId();
+
+    if (m_relocationFrameId != frameId) {
+      m_relocationFrameId = frameId;
+      m_relocationBytes   = 0;
+    }
+
+    VkDeviceSize size = buffer->info().size;
+
+    if (m_relocationBytes + size > m_relocationBudget)
+      return;
+
+    for (const auto& b : m_relocations) {
+      if (b == buffer)
+        return;
+    }
+
+    m_relocations.push_back(buffer);
+    m_relocationBytes += size;
+  }
+
+
+  void DxvkContext::relocateBuffers() {
+    for (const auto& buffer : m_relocations) {
+      DxvkBufferSliceHandle srcSlice = buffer->relocate();
+
+      if (!srcSlice.handle)
+        continue;
+
+      DxvkBufferSliceHandle dstSlice = buffer->getSliceHandle();
+
+      if (m_execBarriers.isBufferDirty(srcSlice, DxvkAccess::Read))
+        m_execBarriers.recordCommands(m_cmd);
+
+      VkBufferCopy region;
+      region.srcOffset = srcSlice.offset;
+      region.dstOffset = dstSlice.offset;
+      region.size      = dstSlice.length;
+
+      m_cmd->cmdCopyBuffer(DxvkCmdBuffer::ExecBuffer,
+        srcSlice.handle, dstSlice.handle, 1, &region);
+
+      m_execBarriers.accessBuffer(srcSlice,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_ACCESS_TRANSFER_READ_BIT,
+        buffer->info().stages,
+        buffer->info().access);
+
+      m_execBarriers.accessBuffer(dstSlice,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_ACCESS_TRANSFER_WRITE_BIT,
+        buffer->info().stages,
+        buffer->info().access);
+
+      // The old storage gets destroyed once the
+      // GPU is done using the previous slice
+      m_cmd->freeBufferSlice(buffer, srcSlice);
+      m_cmd->trackResource<DxvkAccess::Write>(buffer);
+
+      this->updateBufferBindings(buffer, false);
+    }
+
+    m_relocations.clear();
+  }
+
+
   void DxvkContext::updateBuffer(
     const Rc<DxvkBuffer>&           buffer,
           VkDeviceSize              offset,
@@ -4150,8 +4257,10 @@ namespace dxvk {
     m_gpActivePipeline = m_state.gp.pipeline->getPipelineHandle(
       m_state.gp.state, m_state.om.framebufferInfo.renderPass());
 
-    if (unlikely(!m_gpActivePipeline))
+    if (unlikely(!m_gpActivePipeline)) {
+      m_cmd->addStatCtr(DxvkStatCounter::CmdSkippedDrawCalls, 1);
       return false;
+    }
 
     m_cmd->cmdBindPipeline(
       VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -4167,8 +4276,13 @@ namespace dxvk {
      || (m_state.cp.pipeline->layout()->hasStaticBufferBindings()))
       this->updateShaderResources<VK_PIPELINE_BIND_POINT_COMPUTE>(m_state.cp.pipeline->layout());
 
+    uint32_t setMask = std::exchange(m_cpDirtySets, 0);
+
+    if (m_flags.test(DxvkContextFlag::CpDirtyDescriptorBinding))
+      setMask |= m_state.cp.pipeline->layout()->dynamicSetMask();
+
     this->updateShaderDescriptorSetBinding<VK_PIPELINE_BIND_POINT_COMPUTE>(
-      m_cpSet, m_state.cp.pipeline->layout());
+      m_cpSets.data(), setMask, m_state.cp.pipeline->layout());
 
     m_flags.clr(DxvkContextFlag::CpDirtyResources,
                 DxvkContextFlag::CpDirtyDescriptorBinding);
@@ -4180,8 +4294,13 @@ namespace dxvk {
      || (m_state.gp.pipeline->layout()->hasStaticBufferBindings()))
       this->updateShaderResources<VK_PIPELINE_BIND_POINT_GRAPHICS>(m_state.gp.pipeline->layout());
 
+    uint32_t setMask = std::exchange(m_gpDirtySets, 0);
+
+    if (m_flags.test(DxvkContextFlag::GpDirtyDescriptorBinding))
+      setMask |= m_state.gp.pipeline->layout()->dynamicSetMask();
+
     this->updateShaderDescriptorSetBinding<VK_PIPELINE_BIND_POINT_GRAPHICS>(
-      m_gpSet, m_state.gp.pipeline->layout());
+      m_gpSets.data(), setMask, m_state.gp.pipeline->layout());
 
     m_flags.clr(DxvkContextFlag::GpDirtyResources,
                 DxvkContextFlag::GpDirtyDescriptorBinding);
@@ -4199,6 +4318,10 @@ namespace dxvk {
     for (uint32_t i = 0; i < layout->bindingCount(); i++) {
       const auto& binding = layout->binding(i);
       const auto& res     = m_rc[binding.slot];
+
+      // Zero out any padding so that the descriptor
+      // data can be used as a descriptor set cache key
+      descriptors[i] = DxvkDescriptorInfo();
       
       switch (binding.type) {
         case VK_DESCRIPTOR_TYPE_SAMPLER:
@@ -4327,16 +4450,49 @@ namespace dxvk {
       }
     }
 
-    // Allocate and update descriptor set
-    auto& set = BindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS ? m_gpSet : m_cpSet;
+    // Allocate and update descriptor sets. Sets whose contents
+    // did not change are found in the cache and don't need to
+    // be rebound, so only resources of the affected stages
+    // need to be rewritten.
+    auto& sets = BindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS ? m_gpSets : m_cpSets;
+    auto& dirtySets = BindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS ? m_gpDirtySets : m_cpDirtySets;
+    auto& setLayout = BindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS ? m_gpSetLayout : m_cpSetLayout;
 
-    if (layout->bindingCount()) {
-      set = allocateDescriptorSet(layout->descriptorSetLayout());
+    // Binding sets with a different pipeline layout may disturb
+    // previously bound sets, since layouts with a different set
+    // count are not compatible. Rebind all sets in that case.
+    if (setLayout != layout) {
+      sets.fill(VK_NULL_HANDLE);
+      setLayout = layout;
+    }
 
-      m_cmd->updateDescriptorSetWithTemplate(set,
-        layout->descriptorTemplate(), descriptors.data());
-    } else {
-      set = VK_NULL_HANDLE;
+    for (uint32_t i = 0; i < layout->setCount(); i++) {
+      const auto& setInfo = layout->descriptorSet(i);
+      const auto* setData = &descriptors[setInfo.bindingIndex];
+
+      size_t hash = DxvkDescriptorSetCache::hash(setInfo.setLayout,
+        setInfo.bindingCount, setData);
+
+      VkDescriptorSet set = m_descCache.find(setInfo.setLayout,
+        setInfo.bindingCount, setData, hash);
+
+      if (set) {
+        m_cmd->addStatCtr(DxvkStatCounter::DescriptorSetReused, 1);
+      } else {
+        set = allocateDescriptorSet(setInfo.setLayout, setInfo.descriptorCounts);
+
+        m_cmd->updateDescriptorSetWithTemplate(set,
+          setInfo.updateTemplate, setData);
+        m_cmd->addStatCtr(DxvkStatCounter::DescriptorSetAllocated, 1);
+
+        m_descCache.insert(setInfo.setLayout,
+          setInfo.bindingCount, setData, hash, set);
+      }
+
+      if (sets[i] != set) {
+        sets[i] = set;
+        dirtySets |= 1u << i;
+      }
     }
 
     // Select the active binding mask to update
@@ -4358,13 +4514,25 @@ namespace dxvk {
   
   template<VkPipelineBindPoint BindPoint>
   void DxvkContext::updateShaderDescriptorSetBinding(
-          VkDescriptorSet         set,
+    const VkDescriptorSet*        sets,
+          uint32_t                setMask,
     const DxvkPipelineLayout*     layout) {
-    if (set) {
-      std::array<uint32_t, MaxNumActiveBindings> offsets;
+    std::array<uint32_t, MaxNumActiveBindings> offsets;
+
+    // Bind consecutive sets with one call. Dynamic offsets
+    // of consecutive sets are stored contiguously as well.
+    while (setMask) {
+      uint32_t first = bit::tzcnt(setMask);
+      uint32_t count = bit::tzcnt(~(setMask >> first));
+
+      const auto& firstSet = layout->descriptorSet(first);
+      const auto& lastSet  = layout->descriptorSet(first + count - 1);
+
+      uint32_t dynamicCount = lastSet.dynamicIndex
+        + lastSet.dynamicCount - firstSet.dynamicIndex;
 
-      for (uint32_t i = 0; i < layout->dynamicBindingCount(); i++) {
-        const auto& binding = layout->dynamicBinding(i);
+      for (uint32_t i = 0; i < dynamicCount; i++) {
+        const auto& binding = layout->dynamicBinding(firstSet.dynamicIndex + i);
         const auto& res     = m_rc[binding.slot];
 
         offsets[i] = res.bufferSlice.defined()
@@ -4372,10 +4540,11 @@ namespace dxvk {
           : 0;
       }
       
-      m_cmd->cmdBindDescriptorSet(BindPoint,
-        layout->pipelineLayout(), set,
-        layout->dynamicBindingCount(),
-        offsets.data());
+      m_cmd->cmdBindDescriptorSets(BindPoint,
+        layout->pipelineLayout(), first, count,
+        &sets[first], dynamicCount, offsets.data());
+
+      setMask &= ~(((1u << count) - 1) << first);
     }
   }
   
@@ -5177,16 +5346,24 @@ namespace dxvk {
 
   VkDescriptorSet DxvkContext::allocateDescriptorSet(
           VkDescriptorSetLayout     layout) {
+    return allocateDescriptorSet(layout, DxvkDescriptorCounts());
+  }
+
+
+  VkDescriptorSet DxvkContext::allocateDescriptorSet(
+          VkDescriptorSetLayout     layout,
+    const DxvkDescriptorCounts&     counts) {
     if (m_descPool == nullptr)
       m_descPool = m_device->createDescriptorPool();
     
-    VkDescriptorSet set = m_descPool->alloc(layout);
+    VkDescriptorSet set = m_descPool->alloc(layout, counts);
 
     if (set == VK_NULL_HANDLE) {
       m_cmd->trackDescriptorPool(std::move(m_descPool));
+      m_cmd->addStatCtr(DxvkStatCounter::DescriptorPoolExhausted, 1);
 
       m_descPool = m_device->createDescriptorPool();
-      set = m_descPool->alloc(layout);
+      set = m_descPool->alloc(layout, counts);
     }
 
     return set;
@@ -5254,12 +5431,34 @@ namespace dxvk {
   Rc<DxvkFramebuffer> DxvkContext::lookupFramebuffer(
     const DxvkFramebufferInfo&      framebufferInfo) {
     DxvkFramebufferKey key = framebufferInfo.key();
-    size_t idx = key.hash() % m_framebufferCache.size();
 
-    if (m_framebufferCache[idx] == nullptr || !m_framebufferCache[idx]->key().eq(key))
-      m_framebufferCache[idx] = m_device->createFramebuffer(framebufferInfo);
+    // Each key maps to a set of entries, so that render target
+    // combinations whose hashes collide do not keep evicting
+    // each other. If none of the entries match, replace an
+    // empty one or the one that was used least recently.
+    size_t set = key.hash() % FramebufferCacheSets;
+    DxvkFramebufferCacheEntry* entries = &m_framebufferCache[set * FramebufferCacheWays];
+    DxvkFramebufferCacheEntry* victim  = &entries[0];
+
+    for (uint32_t i = 0; i < FramebufferCacheWays; i++) {
+      DxvkFramebufferCacheEntry& entry = entries[i];
+
+      if (entry.framebuffer != nullptr && entry.framebuffer->key().eq(key)) {
+        m_cmd->addStatCtr(DxvkStatCounter::FramebufferCacheHits, 1);
+        entry.lastUse = ++m_framebufferCacheUse;
+        return entry.framebuffer;
+      }
+
+      if (victim->framebuffer != nullptr
+       && (entry.framebuffer == nullptr || entry.lastUse < victim->lastUse))
+        victim = &entry;
+    }
+
+    m_cmd->addStatCtr(DxvkStatCounter::FramebufferCacheMisses, 1);
 
-    return m_framebufferCache[idx];
+    victim->framebuffer = m_device->createFramebuffer(framebufferInfo);
+    victim->lastUse     = ++m_framebufferCacheUse;
+    return victim->framebuffer;
   }
 
 
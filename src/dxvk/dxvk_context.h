@@ -20,6 +20,8 @@ namespace dxvk {
    */
   class DxvkContext : public RcObject {
     constexpr static VkDeviceSize StagingBufferSize = 4ull << 20;
+    constexpr static uint32_t FramebufferCacheSets = 128;
+    constexpr static uint32_t FramebufferCacheWays = 4;
   public:
     
     DxvkContext(const Rc<DxvkDevice>& device);
@@ -1056,6 +1058,7 @@ namespace dxvk {
     
     Rc<DxvkCommandList>     m_cmd;
     Rc<DxvkDescriptorPool>  m_descPool;
+    DxvkDescriptorSetCache  m_descCache;
     Rc<DxvkBuffer>          m_zeroBuffer;
 
     DxvkContextFlags        m_flags;
@@ -1078,18 +1081,32 @@ namespace dxvk {
     VkPipeline m_gpActivePipeline = VK_NULL_HANDLE;
     VkPipeline m_cpActivePipeline = VK_NULL_HANDLE;
 
-    VkDescriptorSet m_gpSet = VK_NULL_HANDLE;
-    VkDescriptorSet m_cpSet = VK_NULL_HANDLE;
+    std::array<VkDescriptorSet, MaxNumDescriptorSets> m_gpSets = { };
+    std::array<VkDescriptorSet, MaxNumDescriptorSets> m_cpSets = { };
+
+    uint32_t m_gpDirtySets = 0;
+    uint32_t m_cpDirtySets = 0;
+
+    const DxvkPipelineLayout* m_gpSetLayout = nullptr;
+    const DxvkPipelineLayout* m_cpSetLayout = nullptr;
 
     DxvkBindingSet<MaxNumVertexBindings + 1>  m_vbTracked;
     DxvkBindingSet<MaxNumResourceSlots>       m_rcTracked;
 
     std::vector<DxvkDeferredClear> m_deferredClears;
 
+    std::vector<Rc<DxvkBuffer>> m_relocations;
+    VkDeviceSize                m_relocationBudget  = 0;
+    VkDeviceSize                m_relocationBytes   = 0;
+    uint32_t                    m_relocationFrameId = 0;
+
     std::array<DxvkShaderResourceSlot, MaxNumResourceSlots>  m_rc;
     std::array<DxvkGraphicsPipeline*, 4096> m_gpLookupCache = { };
     std::array<DxvkComputePipeline*,   256> m_cpLookupCache = { };
-    std::array<Rc<DxvkFramebuffer>,    512> m_framebufferCache = { };
+
+    std::array<DxvkFramebufferCacheEntry,
+      FramebufferCacheSets * FramebufferCacheWays> m_framebufferCache = { };
+    uint64_t m_framebufferCacheUse = 0;
 
     void blitImageFb(
       const Rc<DxvkImage>&        dstImage,
@@ -1206,6 +1223,15 @@ namespace dxvk {
 
     void flushSharedImages();
 
+    void scheduleRelocation(
+      const Rc<DxvkBuffer>&           buffer);
+
+    void relocateBuffers();
+
+    void updateBufferBindings(
+      const Rc<DxvkBuffer>&           buffer,
+            bool                      sameHandle);
+
     void startRenderPass();
     void spillRenderPass(bool suspend);
     
@@ -1241,7 +1267,8 @@ namespace dxvk {
     
     template<VkPipelineBindPoint BindPoint>
     void updateShaderDescriptorSetBinding(
-            VkDescriptorSet         set,
+      const VkDescriptorSet*        sets,
+            uint32_t                setMask,
       const DxvkPipelineLayout*     layout);
 
     DxvkFramebufferInfo makeFramebufferInfo(
@@ -1321,6 +1348,10 @@ namespace dxvk {
     VkDescriptorSet allocateDescriptorSet(
             VkDescriptorSetLayout     layout);
 
+    VkDescriptorSet allocateDescriptorSet(
+            VkDescriptorSetLayout     layout,
+      const DxvkDescriptorCounts&     counts);
+
     void trackDrawBuffer();
 
     bool tryInvalidateDeviceLocalBuffer(
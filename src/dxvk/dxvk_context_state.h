@@ -60,6 +60,7 @@ namespace dxvk {
   enum class DxvkContextFeature {
     NullDescriptors,
     ExtendedDynamicState,
+    MemoryDefrag,
   };
 
   using DxvkContextFeatures = Flags<DxvkContextFeature>;
@@ -149,6 +150,19 @@ namespace dxvk {
     VkImageAspectFlags clearAspects;
     VkClearValue clearValue;
   };
+
+
+  /**
+   * \brief Framebuffer cache entry
+   *
+   * Stores a framebuffer along with the value of the
+   * context's use counter at the time it was last
+   * looked up, which is used for LRU replacement.
+   */
+  struct DxvkFramebufferCacheEntry {
+    Rc<DxvkFramebuffer> framebuffer;
+    uint64_t            lastUse = 0;
+  };
   
   
   /**
@@ -1,14 +1,20 @@
+#include <new>
+
 #include "dxvk_cs.h"
 
 namespace dxvk {
   
-  DxvkCsChunk::DxvkCsChunk() {
+  DxvkCsChunk::DxvkCsChunk(DxvkCsChunkSize size)
+  : m_capacity(getCapacity(size)), m_size(size),
+    m_data(static_cast<char*>(::operator new(m_capacity, std::align_val_t(64)))) {
     
   }
   
   
   DxvkCsChunk::~DxvkCsChunk() {
     this->reset();
+
+    ::operator delete(m_data, std::align_val_t(64));
   }
   
   
@@ -54,34 +60,52 @@ namespace dxvk {
     m_tail = nullptr;
 
     m_commandOffset = 0;
+    m_overflow = false;
   }
   
   
-  DxvkCsChunkPool::DxvkCsChunkPool() {
+  DxvkCsChunkPool::DxvkCsChunkPool()
+  : m_trimTime(dxvk::high_resolution_clock::now()) {
     
   }
   
   
   DxvkCsChunkPool::~DxvkCsChunkPool() {
-    for (DxvkCsChunk* chunk : m_chunks)
-      delete chunk;
+    for (auto& shard : m_shards) {
+      for (auto& chunks : shard.chunks) {
+        for (DxvkCsChunk* chunk : chunks)
+          delete chunk;
+      }
+    }
   }
   
   
-  DxvkCsChunk* DxvkCsChunkPool::allocChunk(DxvkCsChunkFlags flags) {
+  DxvkCsChunk* DxvkCsChunkPool::allocChunk(
+          DxvkCsChunkFlags  flags,
+          DxvkCsChunkSize   size) {
+    uint32_t shardIndex = getShardIndex();
+    uint32_t sizeIndex  = uint32_t(size);
+
     DxvkCsChunk* chunk = nullptr;
 
-    { std::lock_guard<dxvk::mutex> lock(m_mutex);
+    { Shard& shard = m_shards[shardIndex];
+      std::lock_guard<dxvk::mutex> lock(shard.mutex);
+
+      auto& chunks = shard.chunks[sizeIndex];
       
-      if (m_chunks.size() != 0) {
-        chunk = m_chunks.back();
-        m_chunks.pop_back();
+      if (chunks.size() != 0) {
+        chunk = chunks.back();
+        chunks.pop_back();
+
+        shard.minCount[sizeIndex] = std::min(
+          shard.minCount[sizeIndex], chunks.size());
       }
     }
     
     if (!chunk)
-      chunk = new DxvkCsChunk();
+      chunk = new DxvkCsChunk(size);
     
+    chunk->m_shard = shardIndex;
     chunk->init(flags);
     return chunk;
   }
@@ -90,17 +114,70 @@ namespace dxvk {
   void DxvkCsChunkPool::freeChunk(DxvkCsChunk* chunk) {
     chunk->reset();
     
-    std::lock_guard<dxvk::mutex> lock(m_mutex);
-    m_chunks.push_back(chunk);
+    { Shard& shard = m_shards[chunk->m_shard];
+      std::lock_guard<dxvk::mutex> lock(shard.mutex);
+      shard.chunks[uint32_t(chunk->size())].push_back(chunk);
+    }
+
+    if (!(++m_freeCount % TrimInterval))
+      trim();
+  }
+
+
+  void DxvkCsChunkPool::trim() {
+    std::unique_lock<dxvk::mutex> trimLock(m_trimLock, std::try_to_lock);
+
+    if (!trimLock)
+      return;
+
+    auto now = dxvk::high_resolution_clock::now();
+
+    if (now - m_trimTime < std::chrono::seconds(1))
+      return;
+
+    m_trimTime = now;
+
+    // Any chunks that were not needed since the last trim
+    // are unlikely to be needed soon, so free them. Free
+    // lists are LIFO, so the unused chunks are in front.
+    std::vector<DxvkCsChunk*> unused;
+
+    for (auto& shard : m_shards) {
+      std::lock_guard<dxvk::mutex> lock(shard.mutex);
+
+      for (uint32_t i = 0; i < SizeClassCount; i++) {
+        auto& chunks = shard.chunks[i];
+
+        size_t count = std::min(shard.minCount[i], chunks.size());
+        unused.insert(unused.end(), chunks.begin(), chunks.begin() + count);
+        chunks.erase(chunks.begin(), chunks.begin() + count);
+
+        shard.minCount[i] = chunks.size();
+      }
+    }
+
+    for (DxvkCsChunk* chunk : unused)
+      delete chunk;
+  }
+
+
+  uint32_t DxvkCsChunkPool::getShardIndex() {
+    static std::atomic<uint32_t> s_nextShard = { 0u };
+    static thread_local uint32_t s_shard = s_nextShard++ % ShardCount;
+    return s_shard;
   }
   
   
   DxvkCsThread::DxvkCsThread(
     const Rc<DxvkDevice>&   device,
     const Rc<DxvkContext>&  context)
-  : m_device(device), m_context(context),
-    m_thread([this] { threadFunc(); }) {
-    
+  : m_device(device), m_context(context) {
+    // Slot sequence numbers must be set up
+    // before the worker starts polling them
+    for (uint64_t i = 0; i < QueueSize; i++)
+      m_queue[i].seq.store(i, std::memory_order_relaxed);
+
+    m_thread = dxvk::thread([this] { threadFunc(); });
   }
   
   
@@ -115,31 +192,52 @@ namespace dxvk {
   
   
   uint64_t DxvkCsThread::dispatchChunk(DxvkCsChunkRef&& chunk) {
-    uint64_t seq;
+    uint64_t pos = m_chunksDispatched.load(std::memory_order_relaxed);
+    QueueSlot* slot;
 
-    { std::unique_lock<dxvk::mutex> lock(m_mutex);
-      seq = ++m_chunksDispatched;
-      m_chunksQueued.push(std::move(chunk));
+    while (true) {
+      slot = &m_queue[pos & (QueueSize - 1)];
+      uint64_t seq = slot->seq.load(std::memory_order_acquire);
+
+      if (seq == pos) {
+        // Slot is free, try to claim it
+        if (m_chunksDispatched.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      } else {
+        // If the slot still holds a chunk from the previous lap,
+        // the queue is full and we need to wait for the worker.
+        // Otherwise, another thread claimed the slot first.
+        if (seq < pos)
+          waitForChunks(pos + 1 - QueueSize);
+
+        pos = m_chunksDispatched.load(std::memory_order_relaxed);
+      }
     }
-    
-    m_condOnAdd.notify_one();
-    return seq;
+
+    slot->chunk = std::move(chunk);
+    slot->seq.store(pos + 1, std::memory_order_release);
+
+    // Only take the lock if the worker is actually asleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (m_consumerWaiting.load()) {
+      std::lock_guard<dxvk::mutex> lock(m_mutex);
+      m_condOnAdd.notify_one();
+    }
+
+    return pos + 1;
   }
   
   
   void DxvkCsThread::synchronize(uint64_t seq) {
-    // Avoid locking if we know the sync is a no-op, may
+    // Avoid waiting if we know the sync is a no-op, may
     // reduce overhead if this is being called frequently
     if (seq > m_chunksExecuted.load(std::memory_order_acquire)) {
-      std::unique_lock<dxvk::mutex> lock(m_mutex);
-
       if (seq == SynchronizeAll)
         seq = m_chunksDispatched.load();
 
       auto t0 = dxvk::high_resolution_clock::now();
-      m_condOnSync.wait(lock, [this, seq] {
-        return m_chunksExecuted.load() >= seq;
-      });
+      waitForChunks(seq);
       auto t1 = dxvk::high_resolution_clock::now();
       auto ticks = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0);
 
@@ -149,6 +247,73 @@ namespace dxvk {
   }
   
   
+  bool DxvkCsThread::hasChunk() const {
+    const QueueSlot& slot = m_queue[m_chunksDequeued & (QueueSize - 1)];
+    return slot.seq.load(std::memory_order_acquire) == m_chunksDequeued + 1;
+  }
+
+
+  DxvkCsChunkRef DxvkCsThread::dequeueChunk() {
+    // Chunks tend to arrive in quick succession when the
+    // application is CPU-bound, so poll for a while first
+    for (uint32_t i = 0; i < SpinCount && !hasChunk(); i++)
+      spinPause(i);
+
+    if (!hasChunk()) {
+      std::unique_lock<dxvk::mutex> lock(m_mutex);
+      m_consumerWaiting.store(true);
+
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+
+      m_condOnAdd.wait(lock, [this] {
+        return hasChunk() || m_stopped.load();
+      });
+
+      m_consumerWaiting.store(false);
+    }
+
+    if (!hasChunk())
+      return DxvkCsChunkRef();
+
+    QueueSlot& slot = m_queue[m_chunksDequeued & (QueueSize - 1)];
+    DxvkCsChunkRef chunk = std::move(slot.chunk);
+
+    // Hand the slot back to producers for the next lap
+    slot.seq.store(m_chunksDequeued + QueueSize, std::memory_order_release);
+    m_chunksDequeued += 1;
+    return chunk;
+  }
+
+
+  void DxvkCsThread::waitForChunks(uint64_t seq) {
+    for (uint32_t i = 0; i < SpinCount; i++) {
+      if (m_chunksExecuted.load(std::memory_order_acquire) >= seq)
+        return;
+
+      spinPause(i);
+    }
+
+    std::unique_lock<dxvk::mutex> lock(m_mutex);
+    m_syncWaiting += 1;
+
+    m_condOnSync.wait(lock, [this, seq] {
+      return m_chunksExecuted.load() >= seq;
+    });
+
+    m_syncWaiting -= 1;
+  }
+
+
+  void DxvkCsThread::spinPause(uint32_t iteration) {
+    // Yield periodically so that polling does not starve the
+    // other thread if both have to share a single CPU core
+    if ((iteration + 1) % SpinYieldInterval)
+      _mm_pause();
+    else
+      dxvk::this_thread::yield();
+  }
+
+
   void DxvkCsThread::threadFunc() {
     env::setThreadName("dxvk-cs");
 
@@ -156,30 +321,20 @@ namespace dxvk {
 
     try {
       while (!m_stopped.load()) {
-        { std::unique_lock<dxvk::mutex> lock(m_mutex);
-          if (chunk) {
-            m_chunksExecuted++;
-            m_condOnSync.notify_one();
-            
-            chunk = DxvkCsChunkRef();
-          }
-          
-          if (m_chunksQueued.size() == 0) {
-            m_condOnAdd.wait(lock, [this] {
-              return (m_chunksQueued.size() != 0)
-                  || (m_stopped.load());
-            });
-          }
-          
-          if (m_chunksQueued.size() != 0) {
-            chunk = std::move(m_chunksQueued.front());
-            m_chunksQueued.pop();
-          }
-        }
-        
+        chunk = dequeueChunk();
+
         if (chunk) {
           m_context->addStatCtr(DxvkStatCounter::CsChunkCount, 1);
           chunk->executeAll(m_context.ptr());
+
+          chunk = DxvkCsChunkRef();
+          m_chunksExecuted += 1;
+
+          // Only take the lock if anyone is waiting
+          if (m_syncWaiting.load()) {
+            std::lock_guard<dxvk::mutex> lock(m_mutex);
+            m_condOnSync.notify_all();
+          }
         }
       }
     } catch (const DxvkError& e) {
@@ -188,4 +343,4 @@ namespace dxvk {
     }
   }
   
-}
\ No newline at end of file
+}
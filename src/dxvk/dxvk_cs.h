@@ -1,11 +1,13 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <condition_variable>
 #include <mutex>
-#include <queue>
+#include <vector>
 
 #include "../util/thread.h"
+#include "../util/util_time.h"
 
 #include "dxvk_device.h"
 #include "dxvk_context.h"
@@ -130,6 +132,21 @@ namespace dxvk {
   };
 
   using DxvkCsChunkFlags = Flags<DxvkCsChunkFlag>;
+
+
+  /**
+   * \brief Chunk size class
+   */
+  enum class DxvkCsChunkSize : uint32_t {
+    /// 4 kB, for chunks that get flushed
+    /// before they fill up most of the time
+    Small   = 0,
+    /// 16 kB, default size
+    Medium  = 1,
+    /// 64 kB, for command lists that get
+    /// recorded on deferred contexts
+    Large   = 2,
+  };
   
   
   /**
@@ -138,10 +155,10 @@ namespace dxvk {
    * Stores a list of commands.
    */
   class DxvkCsChunk : public RcObject {
-    constexpr static size_t MaxBlockSize = 16384;
+    friend class DxvkCsChunkPool;
   public:
     
-    DxvkCsChunk();
+    DxvkCsChunk(DxvkCsChunkSize size);
     ~DxvkCsChunk();
     
     /**
@@ -152,6 +169,44 @@ namespace dxvk {
       return m_commandOffset == 0;
     }
 
+    /**
+     * \brief Chunk size class
+     * \returns Chunk size class
+     */
+    DxvkCsChunkSize size() const {
+      return m_size;
+    }
+
+    /**
+     * \brief Picks size class for the next chunk
+     *
+     * Chooses a larger size class if this chunk
+     * ran out of space, or a smaller one if it
+     * got submitted while mostly empty.
+     * \param [in] maxSize Largest allowed size
+     * \returns Size class for the next chunk
+     */
+    DxvkCsChunkSize getNextSize(DxvkCsChunkSize maxSize) const {
+      uint32_t size = uint32_t(m_size);
+
+      if (m_overflow)
+        size += 1;
+      else if (size && m_commandOffset < getCapacity(m_size) / 4)
+        size -= 1;
+
+      return DxvkCsChunkSize(std::min(size, uint32_t(maxSize)));
+    }
+
+    /**
+     * \brief Computes capacity of a size class
+     *
+     * \param [in] size Size class
+     * \returns Capacity, in bytes
+     */
+    static constexpr size_t getCapacity(DxvkCsChunkSize size) {
+      return size_t(4096) << (2 * uint32_t(size));
+    }
+
     /**
      * \brief Tries to add a command to the chunk
      * 
@@ -166,8 +221,10 @@ namespace dxvk {
     bool push(T& command) {
       using FuncType = DxvkCsTypedCmd<T>;
       
-      if (unlikely(m_commandOffset > MaxBlockSize - sizeof(FuncType)))
+      if (unlikely(m_commandOffset + sizeof(FuncType) > m_capacity)) {
+        m_overflow = true;
         return false;
+      }
       
       DxvkCsCmd* tail = m_tail;
       
@@ -194,8 +251,10 @@ namespace dxvk {
     M* pushCmd(T& command, Args&&... args) {
       using FuncType = DxvkCsDataCmd<T, M>;
       
-      if (unlikely(m_commandOffset > MaxBlockSize - sizeof(FuncType)))
+      if (unlikely(m_commandOffset + sizeof(FuncType) > m_capacity)) {
+        m_overflow = true;
         return nullptr;
+      }
       
       FuncType* func = new (m_data + m_commandOffset)
         FuncType(std::move(command), std::forward<Args>(args)...);
@@ -237,14 +296,17 @@ namespace dxvk {
   private:
     
     size_t m_commandOffset = 0;
+    size_t m_capacity;
     
     DxvkCsCmd* m_head = nullptr;
     DxvkCsCmd* m_tail = nullptr;
 
     DxvkCsChunkFlags m_flags;
+    DxvkCsChunkSize  m_size;
+    bool             m_overflow = false;
+    uint32_t         m_shard    = 0;
     
-    alignas(64)
-    char m_data[MaxBlockSize];
+    char* m_data;
     
   };
   
@@ -255,9 +317,19 @@ namespace dxvk {
    * Implements a pool of CS chunks which can be
    * recycled. The goal is to reduce the number
    * of dynamic memory allocations.
+   *
+   * Free chunks are kept in a number of shards,
+   * and each thread allocates from its own shard
+   * so that contexts recording on different threads
+   * do not contend on the same lock. Chunks are
+   * returned to the shard they were allocated from.
+   * Chunks that remain unused for a while will be
+   * freed in order to reduce memory usage.
    */
   class DxvkCsChunkPool {
-    
+    constexpr static uint32_t ShardCount      = 8;
+    constexpr static uint32_t SizeClassCount  = 3;
+    constexpr static uint32_t TrimInterval    = 1024;
   public:
     
     DxvkCsChunkPool();
@@ -272,9 +344,12 @@ namespace dxvk {
      * Takes an existing chunk from the pool,
      * or creates a new one if necessary.
      * \param [in] flags Chunk flags
+     * \param [in] size Chunk size class
      * \returns Allocated chunk object
      */
-    DxvkCsChunk* allocChunk(DxvkCsChunkFlags flags);
+    DxvkCsChunk* allocChunk(
+            DxvkCsChunkFlags  flags,
+            DxvkCsChunkSize   size = DxvkCsChunkSize::Medium);
     
     /**
      * \brief Releases a chunk
@@ -285,9 +360,23 @@ namespace dxvk {
     void freeChunk(DxvkCsChunk* chunk);
     
   private:
+
+    struct alignas(CACHE_LINE_SIZE) Shard {
+      dxvk::mutex mutex;
+      std::array<std::vector<DxvkCsChunk*>, SizeClassCount> chunks;
+      std::array<size_t, SizeClassCount> minCount = { };
+    };
     
-    dxvk::mutex               m_mutex;
-    std::vector<DxvkCsChunk*> m_chunks;
+    std::array<Shard, ShardCount> m_shards;
+
+    std::atomic<uint32_t>     m_freeCount = { 0u };
+
+    dxvk::mutex               m_trimLock;
+    dxvk::high_resolution_clock::time_point m_trimTime;
+
+    void trim();
+
+    static uint32_t getShardIndex();
     
   };
   
@@ -377,9 +466,21 @@ namespace dxvk {
    * 
    * Spawns a thread that will execute
    * commands on a DXVK context. 
+   *
+   * Chunks are passed to the thread through a bounded
+   * lock-free ring buffer. Both the worker thread and
+   * threads waiting for chunks to complete will spin
+   * for a short while before going to sleep, so that
+   * the mutex is only used when a thread needs to be
+   * woken up.
    */
   class DxvkCsThread {
-    
+    /// Number of ring buffer slots. Must be a power of two.
+    constexpr static uint64_t QueueSize = 1024;
+    /// Number of polling iterations before a thread goes to sleep
+    constexpr static uint32_t SpinCount = 256;
+    /// Number of polling iterations between yields
+    constexpr static uint32_t SpinYieldInterval = 32;
   public:
 
     constexpr static uint64_t SynchronizeAll = ~0ull;
@@ -422,19 +523,40 @@ namespace dxvk {
 
   private:
     
+    struct QueueSlot {
+      std::atomic<uint64_t>     seq;
+      DxvkCsChunkRef            chunk;
+    };
+
     Rc<DxvkDevice>              m_device;
     Rc<DxvkContext>             m_context;
 
+    alignas(CACHE_LINE_SIZE)
     std::atomic<uint64_t>       m_chunksDispatched = { 0ull };
+
+    alignas(CACHE_LINE_SIZE)
     std::atomic<uint64_t>       m_chunksExecuted   = { 0ull };
-    
+    uint64_t                    m_chunksDequeued   = 0ull;
+
+    std::atomic<bool>           m_consumerWaiting  = { false };
+    std::atomic<uint32_t>       m_syncWaiting      = { 0u };
+
+    std::array<QueueSlot, QueueSize> m_queue;
+
     std::atomic<bool>           m_stopped = { false };
     dxvk::mutex                 m_mutex;
     dxvk::condition_variable    m_condOnAdd;
     dxvk::condition_variable    m_condOnSync;
-    std::queue<DxvkCsChunkRef>  m_chunksQueued;
     dxvk::thread                m_thread;
     
+    bool hasChunk() const;
+
+    DxvkCsChunkRef dequeueChunk();
+
+    void waitForChunks(uint64_t seq);
+
+    static void spinPause(uint32_t iteration);
+
     void threadFunc();
     
   };
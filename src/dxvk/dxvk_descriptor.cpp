@@ -1,43 +1,65 @@
+#include <cstring>
+
 #include "dxvk_descriptor.h"
 #include "dxvk_device.h"
+#include "dxvk_limits.h"
 
 namespace dxvk {
   
-  DxvkDescriptorPool::DxvkDescriptorPool(const Rc<vk::DeviceFn>& vkd)
-  : m_vkd(vkd) {
-    constexpr uint32_t MaxSets = 2048;
-
-    std::array<VkDescriptorPoolSize, 9> pools = {{
-      { VK_DESCRIPTOR_TYPE_SAMPLER,                MaxSets * 2 },
-      { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,          MaxSets * 3 },
-      { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          MaxSets / 8 },
-      { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         MaxSets * 3 },
-      { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         MaxSets / 8 },
-      { VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER,   MaxSets * 3 },
-      { VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER,   MaxSets / 8 },
-      { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, MaxSets * 3 },
-      { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MaxSets * 2 } }};
+  DxvkDescriptorPool::DxvkDescriptorPool(
+    const Rc<vk::DeviceFn>&       vkd,
+          DxvkDescriptorPoolManager* manager,
+    const DxvkDescriptorCounts&   capacity)
+  : m_vkd(vkd), m_manager(manager), m_capacity(capacity) {
+    std::array<VkDescriptorPoolSize, DxvkDescriptorTypeCount> pools;
+    uint32_t poolCount = 0;
+
+    for (uint32_t i = 0; i < DxvkDescriptorTypeCount; i++) {
+      if (m_capacity.descriptors[i]) {
+        pools[poolCount].type            = VkDescriptorType(i);
+        pools[poolCount].descriptorCount = m_capacity.descriptors[i];
+        poolCount += 1;
+      }
+    }
     
     VkDescriptorPoolCreateInfo info;
     info.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     info.pNext         = nullptr;
     info.flags         = 0;
-    info.maxSets       = MaxSets;
-    info.poolSizeCount = pools.size();
+    info.maxSets       = m_capacity.sets;
+    info.poolSizeCount = poolCount;
     info.pPoolSizes    = pools.data();
     
     if (m_vkd->vkCreateDescriptorPool(m_vkd->device(), &info, nullptr, &m_pool) != VK_SUCCESS)
       throw DxvkError("DxvkDescriptorPool: Failed to create descriptor pool");
+
+    m_manager->m_poolCount += 1;
   }
   
   
   DxvkDescriptorPool::~DxvkDescriptorPool() {
     m_vkd->vkDestroyDescriptorPool(
       m_vkd->device(), m_pool, nullptr);
+
+    m_manager->m_poolCount -= 1;
   }
   
   
-  VkDescriptorSet DxvkDescriptorPool::alloc(VkDescriptorSetLayout layout) {
+  VkDescriptorSet DxvkDescriptorPool::alloc(
+          VkDescriptorSetLayout   layout,
+    const DxvkDescriptorCounts&   counts) {
+    // Check against our own counters first so that we
+    // don't rely on drivers failing allocations, and so
+    // that usage stats reflect what actually exhausted
+    // the pool.
+    if (m_usage.sets >= m_capacity.sets)
+      return VK_NULL_HANDLE;
+
+    for (uint32_t i = 0; i < DxvkDescriptorTypeCount; i++) {
+      if (m_usage.descriptors[i] + counts.descriptors[i] > m_capacity.descriptors[i])
+        return VK_NULL_HANDLE;
+    }
+
     VkDescriptorSetAllocateInfo info;
     info.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     info.pNext              = nullptr;
@@ -48,6 +70,12 @@ namespace dxvk {
     VkDescriptorSet set = VK_NULL_HANDLE;
     if (m_vkd->vkAllocateDescriptorSets(m_vkd->device(), &info, &set) != VK_SUCCESS)
       return VK_NULL_HANDLE;
+
+    m_usage.sets += 1;
+
+    for (uint32_t i = 0; i < DxvkDescriptorTypeCount; i++)
+      m_usage.descriptors[i] += counts.descriptors[i];
+
     return set;
   }
   
@@ -55,6 +83,8 @@ namespace dxvk {
   void DxvkDescriptorPool::reset() {
     m_vkd->vkResetDescriptorPool(
       m_vkd->device(), m_pool, 0);
+
+    m_usage = DxvkDescriptorCounts();
   }
 
 
@@ -77,12 +107,218 @@ namespace dxvk {
 
   
   void DxvkDescriptorPoolTracker::reset() {
-    for (const auto& pool : m_pools) {
-      pool->reset();
+    for (const auto& pool : m_pools)
       m_device->recycleDescriptorPool(pool);
-    }
 
     m_pools.clear();
   }
   
+
+
+  const std::array<VkDescriptorType, 9> DxvkDescriptorPoolManager::s_descriptorTypes = {{
+    VK_DESCRIPTOR_TYPE_SAMPLER,
+    VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+    VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+    VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+    VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER,
+    VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER,
+    VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+    VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC }};
+
+
+  DxvkDescriptorPoolManager::DxvkDescriptorPoolManager(DxvkDevice* device)
+  : m_device(device) {
+    // Initial ratios of descriptors per set. These are
+    // conservative and will be refined as soon as the
+    // first pools have been used.
+    m_typeRatios[VK_DESCRIPTOR_TYPE_SAMPLER]                = 2.0f;
+    m_typeRatios[VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER] = 2.0f;
+    m_typeRatios[VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE]          = 3.0f;
+    m_typeRatios[VK_DESCRIPTOR_TYPE_STORAGE_IMAGE]          = 0.125f;
+    m_typeRatios[VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER]   = 3.0f;
+    m_typeRatios[VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER]   = 0.125f;
+    m_typeRatios[VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER]         = 3.0f;
+    m_typeRatios[VK_DESCRIPTOR_TYPE_STORAGE_BUFFER]         = 0.125f;
+    m_typeRatios[VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC] = 3.0f;
+
+    this->updateCapacity();
+  }
+
+
+  DxvkDescriptorPoolManager::~DxvkDescriptorPoolManager() {
+
+  }
+
+
+  Rc<DxvkDescriptorPool> DxvkDescriptorPoolManager::createPool() {
+    std::lock_guard<dxvk::mutex> lock(m_mutex);
+
+    this->updateSizeClass();
+
+    if (!m_freePools.empty()) {
+      Rc<DxvkDescriptorPool> pool = std::move(m_freePools.back());
+      m_freePools.pop_back();
+      return pool;
+    }
+
+    return new DxvkDescriptorPool(m_device->vkd(), this, m_capacity);
+  }
+
+
+  void DxvkDescriptorPoolManager::recyclePool(
+    const Rc<DxvkDescriptorPool>& pool) {
+    DxvkDescriptorCounts usage = pool->usage();
+    pool->reset();
+
+    std::lock_guard<dxvk::mutex> lock(m_mutex);
+
+    // Pools are only returned once they are full or no longer
+    // used by a context, so the ratio of descriptors to sets
+    // in a pool is representative of the current workload.
+    if (usage.sets) {
+      for (uint32_t i = 0; i < DxvkDescriptorTypeCount; i++) {
+        float ratio = float(usage.descriptors[i]) / float(usage.sets);
+        m_typeRatios[i] = 0.75f * m_typeRatios[i] + 0.25f * ratio;
+      }
+
+      this->updateCapacity();
+    }
+
+    if (pool->capacity().eq(m_capacity) && m_freePools.size() < MaxFreePools)
+      m_freePools.push_back(pool);
+  }
+
+
+  void DxvkDescriptorPoolManager::updateSizeClass() {
+    uint32_t frameId = m_device->getCurrentFrameId();
+
+    // Use larger pools if more than one pool per frame runs full,
+    // and smaller ones if a single pool lasts for many frames.
+    if (frameId == m_frameId) {
+      if (++m_framePools > 2 && m_sizeClass + 1 < SizeClassCount) {
+        m_sizeClass += 1;
+        m_framePools = 0;
+        this->updateCapacity();
+      }
+    } else {
+      if (frameId - m_frameId > 64 && m_sizeClass > 0) {
+        m_sizeClass -= 1;
+        this->updateCapacity();
+      }
+
+      m_frameId    = frameId;
+      m_framePools = 1;
+    }
+  }
+
+
+  void DxvkDescriptorPoolManager::updateCapacity() {
+    DxvkDescriptorCounts capacity;
+    capacity.sets = MinSetCount << m_sizeClass;
+
+    // Round descriptor counts up to powers of two so that
+    // small changes in usage don't invalidate recycled pools.
+    // Keep a minimum number of descriptors for each type,
+    // since internal operations may use them without being
+    // accounted for, and any single set must fit into an
+    // empty pool.
+    for (VkDescriptorType type : s_descriptorTypes) {
+      uint32_t count = uint32_t(float(capacity.sets) * m_typeRatios[type] * 1.25f);
+      count = std::max(count, capacity.sets / 8);
+      count = std::max(count, uint32_t(MaxNumActiveBindings));
+
+      capacity.descriptors[type] = 1u << (32 - bit::lzcnt(count - 1));
+    }
+
+    if (!capacity.eq(m_capacity)) {
+      m_capacity = capacity;
+      m_freePools.clear();
+    }
+  }
+
+
+  DxvkDescriptorSetCache::DxvkDescriptorSetCache() {
+
+  }
+
+
+  DxvkDescriptorSetCache::~DxvkDescriptorSetCache() {
+
+  }
+
+
+  size_t DxvkDescriptorSetCache::hash(
+          VkDescriptorSetLayout   layout,
+          uint32_t                count,
+    const DxvkDescriptorInfo*     descriptors) {
+    DxvkHashState result;
+    result.add(std::hash<VkDescriptorSetLayout>()(layout));
+    result.add(count);
+
+    auto data = reinterpret_cast<const char*>(descriptors);
+    size_t size = count * sizeof(DxvkDescriptorInfo);
+
+    for (size_t i = 0; i < size; i += sizeof(uint32_t)) {
+      uint32_t dword;
+      std::memcpy(&dword, data + i, sizeof(dword));
+      result.add(dword);
+    }
+
+    return result;
+  }
+
+
+  VkDescriptorSet DxvkDescriptorSetCache::find(
+          VkDescriptorSetLayout   layout,
+          uint32_t                count,
+    const DxvkDescriptorInfo*     descriptors,
+          size_t                  hash) const {
+    auto head = m_lookup.find(hash);
+
+    if (head == m_lookup.end())
+      return VK_NULL_HANDLE;
+
+    for (uint32_t i = head->second; i != ~0u; i = m_entries[i].next) {
+      const Entry& entry = m_entries[i];
+
+      if (entry.layout == layout && entry.count == count
+       && !std::memcmp(&m_descriptors[entry.offset], descriptors,
+            count * sizeof(DxvkDescriptorInfo)))
+        return entry.set;
+    }
+
+    return VK_NULL_HANDLE;
+  }
+
+
+  void DxvkDescriptorSetCache::insert(
+          VkDescriptorSetLayout   layout,
+          uint32_t                count,
+    const DxvkDescriptorInfo*     descriptors,
+          size_t                  hash,
+          VkDescriptorSet         set) {
+    auto head = m_lookup.emplace(hash, ~0u).first;
+
+    Entry entry;
+    entry.layout = layout;
+    entry.count  = count;
+    entry.offset = uint32_t(m_descriptors.size());
+    entry.next   = head->second;
+    entry.set    = set;
+
+    head->second = uint32_t(m_entries.size());
+
+    m_entries.push_back(entry);
+    m_descriptors.insert(m_descriptors.end(),
+      descriptors, descriptors + count);
+  }
+
+
+  void DxvkDescriptorSetCache::clear() {
+    m_entries.clear();
+    m_descriptors.clear();
+    m_lookup.clear();
+  }
+  
 }
\ No newline at end of file
@@ -1,12 +1,43 @@
 #pragma once
 
+#include <atomic>
+#include <unordered_map>
 #include <vector>
 
+#include "dxvk_hash.h"
 #include "dxvk_include.h"
 
+#include "../util/thread.h"
+
 namespace dxvk {
 
   class DxvkDevice;
+  class DxvkDescriptorPoolManager;
+
+  /**
+   * \brief Number of descriptor types
+   *
+   * Descriptor counts are indexed directly
+   * by the Vulkan descriptor type enum.
+   */
+  constexpr uint32_t DxvkDescriptorTypeCount = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT + 1;
+
+  /**
+   * \brief Descriptor counts
+   *
+   * Stores a number of descriptor sets and the
+   * number of descriptors of each type. Used both
+   * for descriptor pool capacities and to track
+   * how many descriptors were allocated.
+   */
+  struct DxvkDescriptorCounts {
+    uint32_t sets = 0;
+    std::array<uint32_t, DxvkDescriptorTypeCount> descriptors = { };
+
+    bool eq(const DxvkDescriptorCounts& other) const {
+      return sets == other.sets && descriptors == other.descriptors;
+    }
+  };
   
   /**
    * \brief Descriptor info
@@ -25,24 +56,49 @@ namespace dxvk {
    * \brief Descriptor pool
    * 
    * Wrapper around a Vulkan descriptor pool that
-   * descriptor sets can be allocated from.
+   * descriptor sets can be allocated from. Keeps
+   * track of how many descriptors of each type have
+   * been allocated so that future pools can be sized
+   * according to the application's needs.
    */
   class DxvkDescriptorPool : public RcObject {
     
   public:
     
     DxvkDescriptorPool(
-      const Rc<vk::DeviceFn>& vkd);
+      const Rc<vk::DeviceFn>&       vkd,
+            DxvkDescriptorPoolManager* manager,
+      const DxvkDescriptorCounts&   capacity);
     ~DxvkDescriptorPool();
     
+    /**
+     * \brief Pool capacity
+     * \returns Maximum number of sets and descriptors
+     */
+    const DxvkDescriptorCounts& capacity() const {
+      return m_capacity;
+    }
+
+    /**
+     * \brief Pool usage
+     * \returns Number of allocated sets and descriptors
+     */
+    const DxvkDescriptorCounts& usage() const {
+      return m_usage;
+    }
+
     /**
      * \brief Allocates a descriptor set
      * 
      * \param [in] layout Descriptor set layout
-     * \returns The descriptor set
+     * \param [in] counts Descriptors used by the layout.
+     *    The number of sets in this struct is ignored.
+     * \returns The descriptor set, or \c VK_NULL_HANDLE
+     *    if the pool does not have enough space left
      */
     VkDescriptorSet alloc(
-      VkDescriptorSetLayout layout);
+            VkDescriptorSetLayout   layout,
+      const DxvkDescriptorCounts&   counts);
     
     /**
      * \brief Resets descriptor set allocator
@@ -54,12 +110,90 @@ namespace dxvk {
     
   private:
     
-    Rc<vk::DeviceFn> m_vkd;
-    VkDescriptorPool m_pool;
+    Rc<vk::DeviceFn>            m_vkd;
+    DxvkDescriptorPoolManager*  m_manager;
+    VkDescriptorPool            m_pool = VK_NULL_HANDLE;
+
+    DxvkDescriptorCounts        m_capacity;
+    DxvkDescriptorCounts        m_usage;
     
   };
 
 
+  /**
+   * \brief Descriptor pool manager
+   *
+   * Creates and recycles descriptor pools. Pool sizes
+   * are derived from the number of descriptors of each
+   * type that previously used pools have served, and the
+   * number of sets per pool is adjusted depending on how
+   * often pools run full, so that the pools match the
+   * application's workload without wasting memory.
+   */
+  class DxvkDescriptorPoolManager {
+    friend class DxvkDescriptorPool;
+
+    constexpr static uint32_t MinSetCount     = 256;
+    constexpr static uint32_t SizeClassCount  = 5;
+    constexpr static uint32_t MaxFreePools    = 16;
+  public:
+
+    DxvkDescriptorPoolManager(DxvkDevice* device);
+    ~DxvkDescriptorPoolManager();
+
+    /**
+     * \brief Creates a descriptor pool
+     *
+     * Returns a recycled pool if one with the current
+     * target capacity is available, or creates a new one.
+     * \returns Empty descriptor pool
+     */
+    Rc<DxvkDescriptorPool> createPool();
+
+    /**
+     * \brief Recycles a descriptor pool
+     *
+     * Updates usage statistics with the pool's usage
+     * and resets it. All descriptor sets allocated from
+     * the pool must no longer be in use by the GPU.
+     * \param [in] pool The descriptor pool
+     */
+    void recyclePool(
+      const Rc<DxvkDescriptorPool>& pool);
+
+    /**
+     * \brief Number of live descriptor pools
+     * \returns Number of Vulkan descriptor pools
+     */
+    uint32_t getPoolCount() const {
+      return m_poolCount.load();
+    }
+
+  private:
+
+    DxvkDevice*           m_device;
+    std::atomic<uint32_t> m_poolCount = { 0u };
+
+    dxvk::mutex           m_mutex;
+
+    std::array<float, DxvkDescriptorTypeCount> m_typeRatios = { };
+
+    DxvkDescriptorCounts  m_capacity;
+    uint32_t              m_sizeClass   = 3;
+    uint32_t              m_frameId     = 0;
+    uint32_t              m_framePools  = 0;
+
+    std::vector<Rc<DxvkDescriptorPool>> m_freePools;
+
+    static const std::array<VkDescriptorType, 9> s_descriptorTypes;
+
+    void updateSizeClass();
+
+    void updateCapacity();
+
+  };
+
+
   /**
    * \brief Descriptor pool tracker
    * 
@@ -96,5 +230,96 @@ namespace dxvk {
     std::vector<Rc<DxvkDescriptorPool>> m_pools;
 
   };
+
+
+  /**
+   * \brief Descriptor set cache
+   *
+   * Maps descriptor set layouts and the exact set of
+   * descriptors written to a set to a descriptor set
+   * that has already been written with that data, so
+   * that redundant allocations and updates can be
+   * skipped when the same resources are bound again.
+   *
+   * Cached sets are only valid while the command list
+   * they were allocated for is being recorded, since
+   * the resources they reference are only kept alive
+   * for that long. The cache must be cleared whenever
+   * a new command list begins recording.
+   */
+  class DxvkDescriptorSetCache {
+
+    struct Entry {
+      VkDescriptorSetLayout layout;
+      uint32_t              count;
+      uint32_t              offset;
+      uint32_t              next;
+      VkDescriptorSet       set;
+    };
+
+  public:
+
+    DxvkDescriptorSetCache();
+    ~DxvkDescriptorSetCache();
+
+    /**
+     * \brief Computes lookup hash
+     *
+     * \param [in] layout Descriptor set layout
+     * \param [in] count Number of descriptors
+     * \param [in] descriptors Descriptor data
+     * \returns Hash to pass to \ref find and \ref insert
+     */
+    static size_t hash(
+            VkDescriptorSetLayout   layout,
+            uint32_t                count,
+      const DxvkDescriptorInfo*     descriptors);
+
+    /**
+     * \brief Looks up a descriptor set
+     *
+     * Descriptor data is compared bit by bit, so any
+     * padding in the descriptor infos must be zeroed.
+     * \param [in] layout Descriptor set layout
+     * \param [in] count Number of descriptors
+     * \param [in] descriptors Descriptor data
+     * \param [in] hash Hash of the above
+     * \returns Matching set, or \c VK_NULL_HANDLE
+     */
+    VkDescriptorSet find(
+            VkDescriptorSetLayout   layout,
+            uint32_t                count,
+      const DxvkDescriptorInfo*     descriptors,
+            size_t                  hash) const;
+
+    /**
+     * \brief Adds a descriptor set to the cache
+     *
+     * \param [in] layout Descriptor set layout
+     * \param [in] count Number of descriptors
+     * \param [in] descriptors Descriptor data
+     * \param [in] hash Hash of the above
+     * \param [in] set Descriptor set written
+     *    with the given descriptor data
+     */
+    void insert(
+            VkDescriptorSetLayout   layout,
+            uint32_t                count,
+      const DxvkDescriptorInfo*     descriptors,
+            size_t                  hash,
+            VkDescriptorSet         set);
+
+    /**
+     * \brief Removes all cached sets
+     */
+    void clear();
+
+  private:
+
+    std::vector<Entry>                    m_entries;
+    std::vector<DxvkDescriptorInfo>       m_descriptors;
+    std::unordered_map<size_t, uint32_t>  m_lookup;
+
+  };
   
 }
\ No newline at end of file
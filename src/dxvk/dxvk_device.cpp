@@ -18,6 +18,7 @@ namespace dxvk {
     m_properties        (adapter->devicePropertiesExt()),
     m_perfHints         (getPerfHints()),
     m_objects           (this),
+    m_descriptorPools   (this),
     m_submissionQueue   (this) {
     auto queueFamilies = m_adapter->findQueueFamilies();
     m_queues.graphics = getQueue(queueFamilies.graphics, 0);
@@ -92,12 +93,7 @@ namespace dxvk {
 
 
   Rc<DxvkDescriptorPool> DxvkDevice::createDescriptorPool() {
-    Rc<DxvkDescriptorPool> pool = m_recycledDescriptorPools.retrieveObject();
-
-    if (pool == nullptr)
-      pool = new DxvkDescriptorPool(m_vkd);
-    
-    return pool;
+    return m_descriptorPools.createPool();
   }
   
   
@@ -179,6 +175,7 @@ namespace dxvk {
     result.setCtr(DxvkStatCounter::PipeCountCompute,  pipe.numComputePipelines);
     result.setCtr(DxvkStatCounter::PipeCompilerBusy,  m_objects.pipelineManager().isCompilingShaders());
     result.setCtr(DxvkStatCounter::GpuIdleTicks,      m_submissionQueue.gpuIdleTicks());
+    result.setCtr(DxvkStatCounter::DescriptorPoolCount, m_descriptorPools.getPoolCount());
 
     std::lock_guard<sync::Spinlock> lock(m_statLock);
     result.merge(m_statCounters);
@@ -204,6 +201,20 @@ namespace dxvk {
   void DxvkDevice::registerShader(const Rc<DxvkShader>& shader) {
     m_objects.pipelineManager().registerShader(shader);
   }
+
+
+  Rc<DxvkShader> DxvkDevice::lookupShader(
+    const DxvkShaderKey&          key,
+    const Sha1Hash&               options) {
+    return m_objects.shaderCache().lookupShader(key, options);
+  }
+
+
+  void DxvkDevice::cacheShader(
+    const Rc<DxvkShader>&         shader,
+    const Sha1Hash&               options) {
+    m_objects.shaderCache().addShader(shader, options);
+  }
   
   
   void DxvkDevice::presentImage(
@@ -293,7 +304,7 @@ namespace dxvk {
   
 
   void DxvkDevice::recycleDescriptorPool(const Rc<DxvkDescriptorPool>& pool) {
-    m_recycledDescriptorPools.returnObject(pool);
+    m_descriptorPools.recyclePool(pool);
   }
 
 
@@ -234,8 +234,9 @@ namespace dxvk {
      * \brief Creates a descriptor pool
      * 
      * Returns a previously recycled pool, or creates
-     * a new one if necessary. The context should take
-     * ownership of the returned pool.
+     * a new one if necessary. Pool sizes are adjusted
+     * based on how previous pools were used. The context
+     * should take ownership of the returned pool.
      * \returns Descriptor pool
      */
     Rc<DxvkDescriptorPool> createDescriptorPool();
@@ -388,6 +389,29 @@ namespace dxvk {
      */
     void registerShader(
       const Rc<DxvkShader>&         shader);
+
+    /**
+     * \brief Looks up a translated shader
+     *
+     * Checks the persistent shader cache for a shader
+     * that was translated with the same options.
+     * \param [in] key Shader key
+     * \param [in] options Compiler options hash
+     * \returns Cached shader, or \c nullptr
+     */
+    Rc<DxvkShader> lookupShader(
+      const DxvkShaderKey&          key,
+      const Sha1Hash&               options);
+
+    /**
+     * \brief Adds a translated shader to the cache
+     *
+     * \param [in] shader Newly compiled shader
+     * \param [in] options Compiler options hash
+     */
+    void cacheShader(
+      const Rc<DxvkShader>&         shader,
+      const Sha1Hash&               options);
     
     /**
      * \brief Presents a swap chain image
@@ -506,8 +530,8 @@ namespace dxvk {
     
     DxvkDeviceQueueSet          m_queues;
     
+    DxvkDescriptorPoolManager           m_descriptorPools;
     DxvkRecycler<DxvkCommandList,    16> m_recycledCommandLists;
-    DxvkRecycler<DxvkDescriptorPool, 16> m_recycledDescriptorPools;
     
     DxvkSubmissionQueue m_submissionQueue;
 
@@ -23,6 +23,9 @@ namespace dxvk {
       pipeMgr->m_device->options().maxNumDynamicUniformBuffers,
       pipeMgr->m_device->options().maxNumDynamicStorageBuffers);
     
+    if (pipeMgr->m_device->config().splitDescriptorSets)
+      m_slotMapping.splitDescriptorSets();
+    
     m_layout = new DxvkPipelineLayout(m_vkd,
       m_slotMapping, VK_PIPELINE_BIND_POINT_GRAPHICS);
     
@@ -37,6 +40,13 @@ namespace dxvk {
     
     m_common.msSampleShadingEnable = m_shaders.fs != nullptr && m_shaders.fs->flags().test(DxvkShaderFlag::HasSampleRateShading);
     m_common.msSampleShadingFactor = 1.0f;
+
+    // Skipping draws with side effects would break rendering
+    // in ways that persist beyond the current frame
+    m_allowAsync = pipeMgr->m_device->config().enableAsync
+      && pipeMgr->m_stateCache != nullptr
+      && !m_flags.any(DxvkGraphicsPipelineFlag::HasTransformFeedback,
+                      DxvkGraphicsPipelineFlag::HasStorageDescriptors);
   }
   
   
@@ -75,9 +85,17 @@ namespace dxvk {
       instance = this->findInstance(state, renderPass);
 
       if (!instance) {
-        // Keep pipeline object locked, at worst we're going to stall
-        // a state cache worker and the current thread needs priority.
-        instance = this->createInstance(state, renderPass);
+        if (m_allowAsync) {
+          // Hand the pipeline off to the state cache workers and
+          // skip draws using it until compilation has finished.
+          instance = this->insertInstance(state, renderPass, VK_NULL_HANDLE);
+          m_pipeMgr->m_stateCache->compileInstanceAsync(this, instance);
+        } else {
+          // Keep pipeline object locked, at worst we're going to stall
+          // a state cache worker and the current thread needs priority.
+          instance = this->createInstance(state, renderPass, m_pipeMgr->m_cache->handle());
+        }
+
         this->writePipelineStateToCache(state, renderPass->format());
       }
     }
@@ -88,7 +106,8 @@ namespace dxvk {
 
   void DxvkGraphicsPipeline::compilePipeline(
     const DxvkGraphicsPipelineStateInfo& state,
-    const DxvkRenderPass*                renderPass) {
+    const DxvkRenderPass*                renderPass,
+          VkPipelineCache                cache) {
     // Exit early if the state vector is invalid
     if (!this->validatePipelineState(state, false))
       return;
@@ -98,35 +117,89 @@ namespace dxvk {
     std::lock_guard<dxvk::mutex> lock(m_mutex);
 
     if (!this->findInstance(state, renderPass))
-      this->createInstance(state, renderPass);
+      this->createInstance(state, renderPass, cache);
+  }
+
+
+  void DxvkGraphicsPipeline::compileInstance(
+          DxvkGraphicsPipelineInstance*  instance,
+          VkPipelineCache                cache) {
+    // Do not lock the pipeline object here since that would
+    // stall the CS thread whenever it misses another state
+    VkPipeline pipeline = this->createPipeline(
+      instance->stateVector(), instance->renderPass(), cache);
+
+    m_pipeMgr->m_numGraphicsPipelines += 1;
+    m_pipeMgr->m_cache->update();
+
+    instance->setPipeline(pipeline);
   }
 
 
   DxvkGraphicsPipelineInstance* DxvkGraphicsPipeline::createInstance(
     const DxvkGraphicsPipelineStateInfo& state,
-    const DxvkRenderPass*                renderPass) {
-    VkPipeline pipeline = this->createPipeline(state, renderPass);
+    const DxvkRenderPass*                renderPass,
+          VkPipelineCache                cache) {
+    VkPipeline pipeline = this->createPipeline(state, renderPass, cache);
 
     m_pipeMgr->m_numGraphicsPipelines += 1;
-    return &(*m_pipelines.emplace(state, renderPass, pipeline));
+    m_pipeMgr->m_cache->update();
+    return this->insertInstance(state, renderPass, pipeline);
+  }
+
+
+  DxvkGraphicsPipelineInstance* DxvkGraphicsPipeline::insertInstance(
+    const DxvkGraphicsPipelineStateInfo& state,
+    const DxvkRenderPass*                renderPass,
+          VkPipeline                     pipeline) {
+    DxvkGraphicsPipelineInstance* instance = &(*m_pipelines.emplace(state, renderPass, pipeline));
+    m_pipelineIndex.insert(getInstanceHash(state, renderPass), instance);
+    return instance;
   }
   
   
   DxvkGraphicsPipelineInstance* DxvkGraphicsPipeline::findInstance(
     const DxvkGraphicsPipelineStateInfo& state,
     const DxvkRenderPass*                renderPass) {
+    // Most pipelines only ever get a handful of instances, and
+    // comparing those directly is cheaper than hashing the full
+    // state vector. Newer instances are at the front of the list.
+    constexpr uint32_t MaxLinearSearchCount = 4;
+
+    uint32_t count = 0;
+
     for (auto& instance : m_pipelines) {
       if (instance.isCompatible(state, renderPass))
         return &instance;
+
+      if (++count == MaxLinearSearchCount)
+        break;
     }
-    
-    return nullptr;
+
+    if (count < MaxLinearSearchCount)
+      return nullptr;
+
+    return m_pipelineIndex.find(getInstanceHash(state, renderPass),
+      [&state, renderPass] (const DxvkGraphicsPipelineInstance& instance) {
+        return instance.isCompatible(state, renderPass);
+      });
+  }
+
+
+  size_t DxvkGraphicsPipeline::getInstanceHash(
+    const DxvkGraphicsPipelineStateInfo& state,
+    const DxvkRenderPass*                renderPass) {
+    DxvkHashState hash;
+    hash.add(state.hash());
+    hash.add(reinterpret_cast<uintptr_t>(renderPass));
+    return hash;
   }
   
   
   VkPipeline DxvkGraphicsPipeline::createPipeline(
     const DxvkGraphicsPipelineStateInfo& state,
-    const DxvkRenderPass*                renderPass) const {
+    const DxvkRenderPass*                renderPass,
+          VkPipelineCache                cache) const {
     if (Logger::logLevel() <= LogLevel::Debug) {
       Logger::debug("Compiling graphics pipeline...");
       this->logPipelineState(LogLevel::Debug, state);
@@ -424,7 +497,7 @@ namespace dxvk {
     
     VkPipeline pipeline = VK_NULL_HANDLE;
     if (m_vkd->vkCreateGraphicsPipelines(m_vkd->device(),
-          m_pipeMgr->m_cache->handle(), 1, &info, nullptr, &pipeline) != VK_SUCCESS) {
+          cache, 1, &info, nullptr, &pipeline) != VK_SUCCESS) {
       Logger::err("DxvkGraphicsPipeline: Failed to compile pipeline");
       this->logPipelineState(LogLevel::Error, state);
       return VK_NULL_HANDLE;
@@ -2,6 +2,7 @@
 
 #include <mutex>
 
+#include "../util/sync/sync_index.h"
 #include "../util/sync/sync_list.h"
 
 #include "dxvk_bind_mask.h"
@@ -87,6 +88,8 @@ namespace dxvk {
    * 
    * Stores a state vector and the
    * corresponding pipeline handle.
+   * The handle may be null while the
+   * pipeline is compiled asynchronously.
    */
   class DxvkGraphicsPipelineInstance {
 
@@ -114,24 +117,50 @@ namespace dxvk {
      */
     bool isCompatible(
       const DxvkGraphicsPipelineStateInfo&  state,
-      const DxvkRenderPass*                 rp) {
+      const DxvkRenderPass*                 rp) const {
       return m_renderPass  == rp
           && m_stateVector == state;
     }
 
+    /**
+     * \brief Retrieves state vector
+     * \returns Graphics pipeline state
+     */
+    const DxvkGraphicsPipelineStateInfo& stateVector() const {
+      return m_stateVector;
+    }
+
+    /**
+     * \brief Retrieves render pass
+     * \returns Render pass
+     */
+    const DxvkRenderPass* renderPass() const {
+      return m_renderPass;
+    }
+
     /**
      * \brief Retrieves pipeline
      * \returns The pipeline handle
      */
     VkPipeline pipeline() const {
-      return m_pipeline;
+      return m_pipeline.load(std::memory_order_acquire);
+    }
+
+    /**
+     * \brief Sets pipeline handle
+     *
+     * Publishes an asynchronously compiled pipeline.
+     * \param [in] pipe The pipeline handle
+     */
+    void setPipeline(VkPipeline pipe) {
+      m_pipeline.store(pipe, std::memory_order_release);
     }
 
   private:
 
     DxvkGraphicsPipelineStateInfo m_stateVector;
     const DxvkRenderPass*         m_renderPass;
-    VkPipeline                    m_pipeline;
+    std::atomic<VkPipeline>       m_pipeline;
 
   };
 
@@ -197,6 +226,9 @@ namespace dxvk {
      * 
      * Retrieves a pipeline handle for the given pipeline
      * state. If necessary, a new pipeline will be created.
+     * If asynchronous compilation is enabled, this may
+     * return \c VK_NULL_HANDLE until the pipeline has
+     * been compiled on a worker thread.
      * \param [in] state Pipeline state vector
      * \param [in] renderPass The render pass
      * \returns Pipeline handle
@@ -212,10 +244,24 @@ namespace dxvk {
      * and stores the result for future use.
      * \param [in] state Pipeline state vector
      * \param [in] renderPass The render pass
+     * \param [in] cache Pipeline cache to use
      */
     void compilePipeline(
       const DxvkGraphicsPipelineStateInfo&    state,
-      const DxvkRenderPass*                   renderPass);
+      const DxvkRenderPass*                   renderPass,
+            VkPipelineCache                   cache);
+    
+    /**
+     * \brief Compiles a pending pipeline instance
+     * 
+     * Finishes an instance that was queued for
+     * asynchronous compilation by \ref getPipelineHandle.
+     * \param [in] instance The pipeline instance
+     * \param [in] cache Pipeline cache to use
+     */
+    void compileInstance(
+            DxvkGraphicsPipelineInstance*     instance,
+            VkPipelineCache                   cache);
     
   private:
     
@@ -232,23 +278,37 @@ namespace dxvk {
     
     DxvkGraphicsPipelineFlags           m_flags;
     DxvkGraphicsCommonPipelineStateInfo m_common;
+
+    bool m_allowAsync = false;
     
     // List of pipeline instances, shared between threads
     alignas(CACHE_LINE_SIZE)
-    dxvk::mutex                               m_mutex;
-    sync::List<DxvkGraphicsPipelineInstance>  m_pipelines;
+    dxvk::mutex                                   m_mutex;
+    sync::List<DxvkGraphicsPipelineInstance>      m_pipelines;
+    sync::HashIndex<DxvkGraphicsPipelineInstance> m_pipelineIndex;
     
     DxvkGraphicsPipelineInstance* createInstance(
       const DxvkGraphicsPipelineStateInfo& state,
-      const DxvkRenderPass*                renderPass);
+      const DxvkRenderPass*                renderPass,
+            VkPipelineCache                cache);
+    
+    DxvkGraphicsPipelineInstance* insertInstance(
+      const DxvkGraphicsPipelineStateInfo& state,
+      const DxvkRenderPass*                renderPass,
+            VkPipeline                     pipeline);
     
     DxvkGraphicsPipelineInstance* findInstance(
       const DxvkGraphicsPipelineStateInfo& state,
       const DxvkRenderPass*                renderPass);
     
+    static size_t getInstanceHash(
+      const DxvkGraphicsPipelineStateInfo& state,
+      const DxvkRenderPass*                renderPass);
+    
     VkPipeline createPipeline(
       const DxvkGraphicsPipelineStateInfo& state,
-      const DxvkRenderPass*                renderPass) const;
+      const DxvkRenderPass*                renderPass,
+            VkPipelineCache                cache) const;
     
     void destroyPipeline(
             VkPipeline                     pipeline) const;
@@ -653,6 +653,10 @@ namespace dxvk {
       return !bit::bcmpeq(this, &other);
     }
 
+    size_t hash() const {
+      return bit::bhash(this);
+    }
+
     bool useDynamicStencilRef() const {
       return ds.enableStencilTest();
     }
@@ -720,6 +724,10 @@ namespace dxvk {
     bool operator != (const DxvkComputePipelineStateInfo& other) const {
       return !bit::bcmpeq(this, &other);
     }
+
+    size_t hash() const {
+      return bit::bhash(this);
+    }
     
     DxvkBindingMask         bsBindingMask;
     DxvkScInfo              sc;
@@ -2,7 +2,12 @@
 
 namespace dxvk {
   
-  DxvkLifetimeTracker:: DxvkLifetimeTracker() { }
+  std::atomic<uint64_t> DxvkLifetimeTracker::s_trackingId = { 0ull };
+
+
+  DxvkLifetimeTracker:: DxvkLifetimeTracker()
+  : m_trackingId(++s_trackingId) { }
+
   DxvkLifetimeTracker::~DxvkLifetimeTracker() { }
   
   
@@ -21,6 +26,10 @@ namespace dxvk {
       this->notify();
 
     m_resources.clear();
+
+    // Resources may still store the current ID, so
+    // the next submission needs a different one
+    m_trackingId = ++s_trackingId;
   }
   
 }
\ No newline at end of file
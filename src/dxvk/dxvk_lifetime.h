@@ -23,12 +23,28 @@ namespace dxvk {
     
     /**
      * \brief Adds a resource to track
+     *
+     * Resources that have already been tracked with
+     * the same access type are ignored, so that the
+     * use count and reference count of a resource are
+     * only modified once per command list.
      * \param [in] rc The resource to track
      */
-    template<DxvkAccess Access>
-    void trackResource(Rc<DxvkResource>&& rc) {
+    template<DxvkAccess Access, typename T>
+    void trackResource(const Rc<T>& rc) {
+      if (!rc->markTracked(Access, m_trackingId))
+        return;
+
       rc->acquire(Access);
-      m_resources.emplace_back(std::move(rc), Access);
+      m_resources.emplace_back(rc, Access);
+    }
+
+    /**
+     * \brief Number of tracked resources
+     * \returns Number of resources tracked since reset
+     */
+    size_t count() const {
+      return m_resources.size();
     }
 
     /**
@@ -50,6 +66,10 @@ namespace dxvk {
     
     std::vector<std::pair<Rc<DxvkResource>, DxvkAccess>> m_resources;
     bool m_notified = false;
+
+    uint64_t m_trackingId;
+
+    static std::atomic<uint64_t> s_trackingId;
     
   };
   
@@ -4,6 +4,15 @@
 #include "dxvk_memory.h"
 
 namespace dxvk {
+
+  static uint32_t findMsb(VkDeviceSize n) {
+    uint32_t hi = uint32_t(n >> 32);
+
+    return hi
+      ? 63 - bit::lzcnt(hi)
+      : 31 - bit::lzcnt(uint32_t(n));
+  }
+
   
   DxvkMemory::DxvkMemory() { }
   DxvkMemory::DxvkMemory(
@@ -13,14 +22,16 @@ namespace dxvk {
           VkDeviceMemory        memory,
           VkDeviceSize          offset,
           VkDeviceSize          length,
-          void*                 mapPtr)
+          void*                 mapPtr,
+          uint32_t              block)
   : m_alloc   (alloc),
     m_chunk   (chunk),
     m_type    (type),
     m_memory  (memory),
     m_offset  (offset),
     m_length  (length),
-    m_mapPtr  (mapPtr) { }
+    m_mapPtr  (mapPtr),
+    m_block   (block) { }
   
   
   DxvkMemory::DxvkMemory(DxvkMemory&& other)
@@ -30,7 +41,8 @@ namespace dxvk {
     m_memory  (std::exchange(other.m_memory, VkDeviceMemory(VK_NULL_HANDLE))),
     m_offset  (std::exchange(other.m_offset, 0)),
     m_length  (std::exchange(other.m_length, 0)),
-    m_mapPtr  (std::exchange(other.m_mapPtr, nullptr)) { }
+    m_mapPtr  (std::exchange(other.m_mapPtr, nullptr)),
+    m_block   (std::exchange(other.m_block,  0)) { }
   
   
   DxvkMemory& DxvkMemory::operator = (DxvkMemory&& other) {
@@ -42,6 +54,7 @@ namespace dxvk {
     m_offset  = std::exchange(other.m_offset, 0);
     m_length  = std::exchange(other.m_length, 0);
     m_mapPtr  = std::exchange(other.m_mapPtr, nullptr);
+    m_block   = std::exchange(other.m_block,  0);
     return *this;
   }
   
@@ -55,6 +68,12 @@ namespace dxvk {
     if (m_alloc != nullptr)
       m_alloc->free(*this);
   }
+
+
+  bool DxvkMemory::isEvacuating() const {
+    return m_chunk != nullptr
+        && m_chunk->isEvacuating();
+  }
   
 
   DxvkMemoryChunk::DxvkMemoryChunk(
@@ -63,8 +82,10 @@ namespace dxvk {
           DxvkDeviceMemory      memory,
           DxvkMemoryFlags       hints)
   : m_alloc(alloc), m_type(type), m_memory(memory), m_hints(hints) {
+    m_freeLists.fill(NoBlock);
+
     // Mark the entire chunk as free
-    m_freeList.push_back(FreeSlice { 0, memory.memSize });
+    insertFreeBlock(createBlock(0, memory.memSize, NoBlock, NoBlock));
   }
   
   
@@ -80,83 +101,121 @@ namespace dxvk {
           VkDeviceSize          size,
           VkDeviceSize          align,
           DxvkMemoryFlags       hints) {
-    // Property flags must be compatible. This could
-    // be refined a bit in the future if necessary.
-    if (m_memory.memFlags != flags || !checkHints(hints))
+    if (!isSuitable(flags, hints))
       return DxvkMemory();
     
     // If the chunk is full, return
-    if (m_freeList.size() == 0)
+    if (!m_flMask)
       return DxvkMemory();
     
-    // Select the slice to allocate from in a worst-fit
-    // manner. This may help keep fragmentation low.
-    auto bestSlice = m_freeList.begin();
-    
-    for (auto slice = m_freeList.begin(); slice != m_freeList.end(); slice++) {
-      if (slice->length == size) {
-        bestSlice = slice;
-        break;
-      } else if (slice->length > bestSlice->length) {
-        bestSlice = slice;
-      }
+    // Most free blocks are already suitably aligned, so try
+    // to find a block that fits the allocation itself first.
+    // If that block does not work out, look for one that is
+    // guaranteed to fit the allocation with any padding.
+    const VkDeviceSize allocSize = dxvk::align(size, align);
+
+    uint32_t index = findFreeBlock(allocSize);
+
+    if (index == NoBlock || !checkBlock(index, size, align)) {
+      index = findFreeBlock(allocSize + align - 1);
+
+      if (index == NoBlock)
+        return DxvkMemory();
     }
     
     // We need to align the allocation to the requested alignment
-    const VkDeviceSize sliceStart = bestSlice->offset;
-    const VkDeviceSize sliceEnd   = bestSlice->offset + bestSlice->length;
-    
-    const VkDeviceSize allocStart = dxvk::align(sliceStart,        align);
-    const VkDeviceSize allocEnd   = dxvk::align(allocStart + size, align);
-    
-    if (allocEnd > sliceEnd)
-      return DxvkMemory();
-    
-    // We can use this slice, but we'll have to add
-    // the unused parts of it back to the free list.
-    m_freeList.erase(bestSlice);
+    const VkDeviceSize blockStart = m_blocks[index].offset;
+    const VkDeviceSize blockEnd   = m_blocks[index].offset + m_blocks[index].length;
     
-    if (allocStart != sliceStart)
-      m_freeList.push_back({ sliceStart, allocStart - sliceStart });
-    
-    if (allocEnd != sliceEnd)
-      m_freeList.push_back({ allocEnd, sliceEnd - allocEnd });
+    const VkDeviceSize allocStart = dxvk::align(blockStart, align);
+    const VkDeviceSize allocEnd   = allocStart + allocSize;
+
+    // We can use this block, but we'll have to split
+    // off the unused parts and return them as free
+    // blocks. Note that creating blocks may invalidate
+    // references into the block array.
+    removeFreeBlock(index);
+
+    if (allocStart != blockStart) {
+      uint32_t prev = createBlock(blockStart, allocStart - blockStart,
+        m_blocks[index].prevPhys, index);
+
+      if (m_blocks[prev].prevPhys != NoBlock)
+        m_blocks[m_blocks[prev].prevPhys].nextPhys = prev;
+
+      m_blocks[index].prevPhys = prev;
+      insertFreeBlock(prev);
+    }
+
+    if (allocEnd != blockEnd) {
+      uint32_t next = createBlock(allocEnd, blockEnd - allocEnd,
+        index, m_blocks[index].nextPhys);
+
+      if (m_blocks[next].nextPhys != NoBlock)
+        m_blocks[m_blocks[next].nextPhys].prevPhys = next;
+
+      m_blocks[index].nextPhys = next;
+      insertFreeBlock(next);
+    }
+
+    m_blocks[index].offset = allocStart;
+    m_blocks[index].length = allocSize;
+    m_allocCount += 1;
+    m_used       += allocSize;
     
     // Create the memory object with the aligned slice
     return DxvkMemory(m_alloc, this, m_type,
-      m_memory.memHandle, allocStart, allocEnd - allocStart,
-      reinterpret_cast<char*>(m_memory.memPointer) + allocStart);
+      m_memory.memHandle, allocStart, allocSize,
+      reinterpret_cast<char*>(m_memory.memPointer) + allocStart,
+      index);
   }
   
   
   void DxvkMemoryChunk::free(
-          VkDeviceSize  offset,
-          VkDeviceSize  length) {
-    // Remove adjacent entries from the free list and then add
-    // a new slice that covers all those entries. Without doing
-    // so, the slice could not be reused for larger allocations.
-    auto curr = m_freeList.begin();
-    
-    while (curr != m_freeList.end()) {
-      if (curr->offset == offset + length) {
-        length += curr->length;
-        curr = m_freeList.erase(curr);
-      } else if (curr->offset + curr->length == offset) {
-        offset -= curr->length;
-        length += curr->length;
-        curr = m_freeList.erase(curr);
-      } else {
-        curr++;
-      }
+          uint32_t      block) {
+    m_used -= m_blocks[block].length;
+
+    // Merge the block with its free neighbours. Without doing
+    // so, the block could not be reused for larger allocations.
+    uint32_t prev = m_blocks[block].prevPhys;
+    uint32_t next = m_blocks[block].nextPhys;
+
+    if (prev != NoBlock && m_blocks[prev].isFree) {
+      removeFreeBlock(prev);
+
+      m_blocks[block].offset  = m_blocks[prev].offset;
+      m_blocks[block].length += m_blocks[prev].length;
+      m_blocks[block].prevPhys = m_blocks[prev].prevPhys;
+
+      if (m_blocks[block].prevPhys != NoBlock)
+        m_blocks[m_blocks[block].prevPhys].nextPhys = block;
+
+      destroyBlock(prev);
     }
-    
-    m_freeList.push_back({ offset, length });
+
+    if (next != NoBlock && m_blocks[next].isFree) {
+      removeFreeBlock(next);
+
+      m_blocks[block].length += m_blocks[next].length;
+      m_blocks[block].nextPhys = m_blocks[next].nextPhys;
+
+      if (m_blocks[block].nextPhys != NoBlock)
+        m_blocks[m_blocks[block].nextPhys].prevPhys = block;
+
+      destroyBlock(next);
+    }
+
+    insertFreeBlock(block);
+    m_allocCount -= 1;
+
+    // Empty chunks can be used normally again
+    if (!m_allocCount)
+      setEvacuating(false);
   }
   
   
   bool DxvkMemoryChunk::isEmpty() const {
-    return m_freeList.size() == 1
-        && m_freeList[0].length == m_memory.memSize;
+    return m_allocCount == 0;
   }
 
 
@@ -165,6 +224,15 @@ namespace dxvk {
   }
 
 
+  bool DxvkMemoryChunk::isSuitable(
+          VkMemoryPropertyFlags flags,
+          DxvkMemoryFlags       hints) const {
+    // Property flags must be compatible. This could
+    // be refined a bit in the future if necessary.
+    return m_memory.memFlags == flags && checkHints(hints);
+  }
+
+
   bool DxvkMemoryChunk::checkHints(DxvkMemoryFlags hints) const {
     DxvkMemoryFlags mask(
       DxvkMemoryFlag::Small,
@@ -179,6 +247,155 @@ namespace dxvk {
   }
 
 
+  bool DxvkMemoryChunk::checkBlock(
+          uint32_t      block,
+          VkDeviceSize  size,
+          VkDeviceSize  align) const {
+    const VkDeviceSize blockStart = m_blocks[block].offset;
+    const VkDeviceSize blockEnd   = m_blocks[block].offset + m_blocks[block].length;
+
+    const VkDeviceSize allocStart = dxvk::align(blockStart,        align);
+    const VkDeviceSize allocEnd   = dxvk::align(allocStart + size, align);
+
+    return allocEnd <= blockEnd;
+  }
+
+
+  uint32_t DxvkMemoryChunk::findFreeBlock(
+          VkDeviceSize  size) const {
+    // Round the size up to the next list boundary so
+    // that any block in the list we pick is large enough
+    if (size >= SlCount) {
+      uint32_t msb = findMsb(size);
+      size += (VkDeviceSize(1) << (msb - SlBits)) - 1;
+    }
+
+    uint32_t fl, sl;
+    getListIndex(size, fl, sl);
+
+    if (fl >= FlCount)
+      return NoBlock;
+
+    uint32_t slMask = m_slMasks[fl] & (~0u << sl);
+
+    if (!slMask) {
+      uint32_t flMask = fl + 1 < FlCount
+        ? m_flMask & (~0u << (fl + 1))
+        : 0u;
+
+      if (!flMask)
+        return NoBlock;
+
+      fl = bit::tzcnt(flMask);
+      slMask = m_slMasks[fl];
+    }
+
+    sl = bit::tzcnt(slMask);
+    return m_freeLists[fl * SlCount + sl];
+  }
+
+
+  void DxvkMemoryChunk::insertFreeBlock(
+          uint32_t      block) {
+    uint32_t fl, sl;
+    getListIndex(m_blocks[block].length, fl, sl);
+
+    uint32_t& head = m_freeLists[fl * SlCount + sl];
+
+    m_blocks[block].isFree   = true;
+    m_blocks[block].prevFree = NoBlock;
+    m_blocks[block].nextFree = head;
+
+    if (head != NoBlock)
+      m_blocks[head].prevFree = block;
+
+    head = block;
+
+    m_flMask      |= 1u << fl;
+    m_slMasks[fl] |= 1u << sl;
+  }
+
+
+  void DxvkMemoryChunk::removeFreeBlock(
+          uint32_t      block) {
+    uint32_t prev = m_blocks[block].prevFree;
+    uint32_t next = m_blocks[block].nextFree;
+
+    if (next != NoBlock)
+      m_blocks[next].prevFree = prev;
+
+    if (prev != NoBlock) {
+      m_blocks[prev].nextFree = next;
+    } else {
+      uint32_t fl, sl;
+      getListIndex(m_blocks[block].length, fl, sl);
+
+      m_freeLists[fl * SlCount + sl] = next;
+
+      if (next == NoBlock) {
+        m_slMasks[fl] &= ~(1u << sl);
+
+        if (!m_slMasks[fl])
+          m_flMask &= ~(1u << fl);
+      }
+    }
+
+    m_blocks[block].isFree = false;
+  }
+
+
+  uint32_t DxvkMemoryChunk::createBlock(
+          VkDeviceSize  offset,
+          VkDeviceSize  length,
+          uint32_t      prevPhys,
+          uint32_t      nextPhys) {
+    uint32_t index;
+
+    if (!m_unusedBlocks.empty()) {
+      index = m_unusedBlocks.back();
+      m_unusedBlocks.pop_back();
+    } else {
+      index = uint32_t(m_blocks.size());
+      m_blocks.emplace_back();
+    }
+
+    Block& block = m_blocks[index];
+    block.offset    = offset;
+    block.length    = length;
+    block.prevPhys  = prevPhys;
+    block.nextPhys  = nextPhys;
+    block.prevFree  = NoBlock;
+    block.nextFree  = NoBlock;
+    block.isFree    = false;
+    return index;
+  }
+
+
+  void DxvkMemoryChunk::destroyBlock(
+          uint32_t      block) {
+    m_unusedBlocks.push_back(block);
+  }
+
+
+  void DxvkMemoryChunk::getListIndex(
+          VkDeviceSize  size,
+          uint32_t&     fl,
+          uint32_t&     sl) {
+    // Sizes below the second-level count are
+    // stored in the first list, one per size
+    if (size < SlCount) {
+      fl = 0;
+      sl = uint32_t(size);
+      return;
+    }
+
+    uint32_t msb = findMsb(size);
+
+    fl = msb - SlBits + 1;
+    sl = uint32_t(size >> (msb - SlBits)) - SlCount;
+  }
+
+
   DxvkMemoryAllocator::DxvkMemoryAllocator(const DxvkDevice* device)
   : m_vkd             (device->vkd()),
     m_device          (device),
@@ -186,7 +403,6 @@ namespace dxvk {
     m_memProps        (device->adapter()->memoryProperties()) {
     for (uint32_t i = 0; i < m_memProps.memoryHeapCount; i++) {
       m_memHeaps[i].properties = m_memProps.memoryHeaps[i];
-      m_memHeaps[i].stats      = DxvkMemoryStats { 0, 0 };
       m_memHeaps[i].budget     = 0;
 
       /* Target 80% of a heap on systems where we want
@@ -232,11 +448,25 @@ namespace dxvk {
         }
       }
     }
+
+    if (device->config().enableMemoryDefrag)
+      m_defragThread = dxvk::thread([this] () { runDefragThread(); });
   }
   
   
   DxvkMemoryAllocator::~DxvkMemoryAllocator() {
-    
+    if (m_defragThread.joinable()) {
+      { std::lock_guard<dxvk::mutex> lock(m_defragMutex);
+        m_defragStop = true;
+        m_defragCond.notify_one();
+      }
+
+      m_defragThread.join();
+    }
+
+    // Return cached slices to their chunks so
+    // that all chunks can be freed properly
+    this->flushMagazines();
   }
   
   
@@ -246,8 +476,6 @@ namespace dxvk {
     const VkMemoryDedicatedAllocateInfo&    dedAllocInfo,
           VkMemoryPropertyFlags             flags,
           DxvkMemoryFlags                   hints) {
-    std::lock_guard<dxvk::mutex> lock(m_mutex);
-
     // Keep small allocations together to avoid fragmenting
     // chunks for larger resources with lots of small gaps,
     // as well as resources with potentially weird lifetimes
@@ -301,8 +529,8 @@ namespace dxvk {
 
       for (uint32_t i = 0; i < m_memProps.memoryHeapCount; i++) {
         Logger::err(str::format("Heap ", i, ": ",
-          (m_memHeaps[i].stats.memoryAllocated >> 20), " MB allocated, ",
-          (m_memHeaps[i].stats.memoryUsed      >> 20), " MB used, ",
+          (m_memHeaps[i].memoryAllocated.load() >> 20), " MB allocated, ",
+          (m_memHeaps[i].memoryUsed.load()      >> 20), " MB used, ",
           m_device->extensions().extMemoryBudget
             ? str::format(
                 (memHeapInfo.heaps[i].memoryAllocated >> 20), " MB allocated (driver), ",
@@ -319,6 +547,29 @@ namespace dxvk {
   }
   
   
+  DxvkMemoryStats DxvkMemoryAllocator::getMemoryStats(uint32_t heap) {
+    DxvkMemoryStats result;
+    result.memoryAllocated = m_memHeaps[heap].memoryAllocated.load();
+    result.memoryUsed      = m_memHeaps[heap].memoryUsed.load();
+
+    for (uint32_t i = 0; i < m_memProps.memoryTypeCount; i++) {
+      DxvkMemoryType* type = &m_memTypes[i];
+
+      if (type->heapId != heap)
+        continue;
+
+      std::lock_guard<dxvk::mutex> lock(type->mutex);
+
+      for (const auto& chunk : type->chunks) {
+        if (!chunk->isEmpty())
+          result.memoryFragmented += chunk->size() - chunk->usedSize();
+      }
+    }
+
+    return result;
+  }
+
+
   DxvkMemory DxvkMemoryAllocator::tryAlloc(
     const VkMemoryRequirements*             req,
     const VkMemoryDedicatedAllocateInfo*    dedAllocInfo,
@@ -359,31 +610,57 @@ namespace dxvk {
         type, flags, size, hints, dedAllocInfo);
 
       if (devMem.memHandle != VK_NULL_HANDLE)
-        memory = DxvkMemory(this, nullptr, type, devMem.memHandle, 0, size, devMem.memPointer);
+        memory = DxvkMemory(this, nullptr, type, devMem.memHandle, 0, size, devMem.memPointer, 0);
     } else {
-      for (uint32_t i = 0; i < type->chunks.size() && !memory; i++)
-        memory = type->chunks[i]->alloc(flags, size, align, hints);
-      
-      if (!memory) {
-        DxvkDeviceMemory devMem;
-        
-        if (this->shouldFreeEmptyChunks(type->heap, chunkSize))
-          this->freeEmptyChunks(type->heap);
+      // Round small allocations up to a size class so
+      // that freed slices can be reused for other
+      // allocations via the magazines
+      if (size <= MagazineMaxSize) {
+        size = getSizeClassSize(getSizeClass(size));
+        memory = this->tryAllocFromMagazine(type, flags, size, align, hints);
+      }
 
-        for (uint32_t i = 0; i < 6 && (chunkSize >> i) >= size && !devMem.memHandle; i++)
-          devMem = tryAllocDeviceMemory(type, flags, chunkSize >> i, hints, nullptr);
+      if (!memory) {
+        std::unique_lock<dxvk::mutex> lock(type->mutex);
 
-        if (devMem.memHandle) {
-          Rc<DxvkMemoryChunk> chunk = new DxvkMemoryChunk(this, type, devMem, hints);
-          memory = chunk->alloc(flags, size, align, hints);
+        // Only use chunks that are being evacuated if
+        // the allocation does not fit anywhere else
+        for (uint32_t i = 0; i < type->chunks.size() && !memory; i++) {
+          if (!type->chunks[i]->isEvacuating())
+            memory = type->chunks[i]->alloc(flags, size, align, hints);
+        }
 
-          type->chunks.push_back(std::move(chunk));
+        for (uint32_t i = 0; i < type->chunks.size() && !memory; i++) {
+          if (type->chunks[i]->isEvacuating())
+            memory = type->chunks[i]->alloc(flags, size, align, hints);
+        }
+      
+        if (!memory) {
+          DxvkDeviceMemory devMem;
+        
+          // Freeing empty chunks needs to lock the other
+          // memory types on the heap, so drop our own lock
+          if (this->shouldFreeEmptyChunks(type->heap, chunkSize)) {
+            lock.unlock();
+            this->freeEmptyChunks(type->heap);
+            lock.lock();
+          }
+
+          for (uint32_t i = 0; i < 6 && (chunkSize >> i) >= size && !devMem.memHandle; i++)
+            devMem = tryAllocDeviceMemory(type, flags, chunkSize >> i, hints, nullptr);
+
+          if (devMem.memHandle) {
+            Rc<DxvkMemoryChunk> chunk = new DxvkMemoryChunk(this, type, devMem, hints);
+            memory = chunk->alloc(flags, size, align, hints);
+
+            type->chunks.push_back(std::move(chunk));
+          }
         }
       }
     }
 
     if (memory)
-      type->heap->stats.memoryUsed += memory.m_length;
+      type->heap->memoryUsed += memory.m_length;
 
     return memory;
   }
@@ -398,8 +675,14 @@ namespace dxvk {
     bool useMemoryPriority = (flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
                           && (m_device->features().extMemoryPriority.memoryPriority);
     
-    if (type->heap->budget && type->heap->stats.memoryAllocated + size > type->heap->budget)
-      return DxvkDeviceMemory();
+    // Reserve the memory up front so that concurrent allocations
+    // from other memory types on the heap cannot exceed the budget
+    VkDeviceSize allocated = type->heap->memoryAllocated.load();
+
+    do {
+      if (type->heap->budget && allocated + size > type->heap->budget)
+        return DxvkDeviceMemory();
+    } while (!type->heap->memoryAllocated.compare_exchange_weak(allocated, allocated + size));
 
     float priority = 0.0f;
 
@@ -424,8 +707,10 @@ namespace dxvk {
     info.allocationSize   = size;
     info.memoryTypeIndex  = type->memTypeId;
 
-    if (m_vkd->vkAllocateMemory(m_vkd->device(), &info, nullptr, &result.memHandle) != VK_SUCCESS)
+    if (m_vkd->vkAllocateMemory(m_vkd->device(), &info, nullptr, &result.memHandle) != VK_SUCCESS) {
+      type->heap->memoryAllocated -= size;
       return DxvkDeviceMemory();
+    }
     
     if (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
       VkResult status = m_vkd->vkMapMemory(m_vkd->device(), result.memHandle, 0, VK_WHOLE_SIZE, 0, &result.memPointer);
@@ -433,11 +718,11 @@ namespace dxvk {
       if (status != VK_SUCCESS) {
         Logger::err(str::format("DxvkMemoryAllocator: Mapping memory failed with ", status));
         m_vkd->vkFreeMemory(m_vkd->device(), result.memHandle, nullptr);
+        type->heap->memoryAllocated -= size;
         return DxvkDeviceMemory();
       }
     }
 
-    type->heap->stats.memoryAllocated += size;
     m_device->adapter()->notifyHeapMemoryAlloc(type->heapId, size);
     return result;
   }
@@ -445,15 +730,17 @@ namespace dxvk {
 
   void DxvkMemoryAllocator::free(
     const DxvkMemory&           memory) {
-    std::lock_guard<dxvk::mutex> lock(m_mutex);
-    memory.m_type->heap->stats.memoryUsed -= memory.m_length;
+    memory.m_type->heap->memoryUsed -= memory.m_length;
 
     if (memory.m_chunk != nullptr) {
+      if (this->tryFreeToMagazine(memory))
+        return;
+
+      std::lock_guard<dxvk::mutex> lock(memory.m_type->mutex);
       this->freeChunkMemory(
         memory.m_type,
         memory.m_chunk,
-        memory.m_offset,
-        memory.m_length);
+        memory.m_block);
     } else {
       DxvkDeviceMemory devMem;
       devMem.memHandle  = memory.m_memory;
@@ -467,9 +754,8 @@ namespace dxvk {
   void DxvkMemoryAllocator::freeChunkMemory(
           DxvkMemoryType*       type,
           DxvkMemoryChunk*      chunk,
-          VkDeviceSize          offset,
-          VkDeviceSize          length) {
-    chunk->free(offset, length);
+          uint32_t              block) {
+    chunk->free(block);
 
     if (chunk->isEmpty()) {
       Rc<DxvkMemoryChunk> chunkRef = chunk;
@@ -489,7 +775,7 @@ namespace dxvk {
           DxvkMemoryType*       type,
           DxvkDeviceMemory      memory) {
     m_vkd->vkFreeMemory(m_vkd->device(), memory.memHandle, nullptr);
-    type->heap->stats.memoryAllocated -= memory.memSize;
+    type->heap->memoryAllocated -= memory.memSize;
     m_device->adapter()->notifyHeapMemoryFree(type->heapId, memory.memSize);
   }
 
@@ -544,18 +830,23 @@ namespace dxvk {
     if (!budget)
       budget = (heap->properties.size * 4) / 5;
 
-    return heap->stats.memoryAllocated + allocationSize > budget;
+    return heap->memoryAllocated.load() + allocationSize > budget;
   }
 
 
   void DxvkMemoryAllocator::freeEmptyChunks(
     const DxvkMemoryHeap*       heap) {
+    // Cached slices keep their chunks alive
+    this->flushMagazines();
+
     for (uint32_t i = 0; i < m_memProps.memoryTypeCount; i++) {
       DxvkMemoryType* type = &m_memTypes[i];
 
       if (type->heap != heap)
         continue;
 
+      std::lock_guard<dxvk::mutex> lock(type->mutex);
+
       type->chunks.erase(
         std::remove_if(type->chunks.begin(), type->chunks.end(),
           [] (const Rc<DxvkMemoryChunk>& chunk) { return chunk->isEmpty(); }),
@@ -563,4 +854,178 @@ namespace dxvk {
     }
   }
 
+
+  DxvkMemory DxvkMemoryAllocator::tryAllocFromMagazine(
+          DxvkMemoryType*       type,
+          VkMemoryPropertyFlags flags,
+          VkDeviceSize          size,
+          VkDeviceSize          align,
+          DxvkMemoryFlags       hints) {
+    Magazine& magazine = m_magazines[getMagazineIndex()];
+    std::lock_guard<dxvk::mutex> lock(magazine.mutex);
+
+    auto& slices = magazine.slices[getSizeClass(size)];
+
+    // Prefer the most recently freed slices
+    for (size_t i = slices.size(); i--; ) {
+      const CachedSlice& slice = slices[i];
+
+      if (slice.type == type
+       && !(slice.offset & (align - 1))
+       && !slice.chunk->isEvacuating()
+       && slice.chunk->isSuitable(flags, hints)) {
+        DxvkMemory memory(this, slice.chunk, slice.type,
+          slice.memory, slice.offset, slice.length,
+          slice.mapPtr, slice.block);
+
+        slices.erase(slices.begin() + i);
+        return memory;
+      }
+    }
+
+    return DxvkMemory();
+  }
+
+
+  bool DxvkMemoryAllocator::tryFreeToMagazine(
+    const DxvkMemory&           memory) {
+    // Slices from evacuated chunks must not be reused
+    if (memory.m_length > MagazineMaxSize || memory.m_chunk->isEvacuating())
+      return false;
+
+    // The slice may be larger than its size
+    // class due to alignment requirements
+    uint32_t sizeClass = getSizeClass(memory.m_length);
+
+    if (getSizeClassSize(sizeClass) != memory.m_length)
+      return false;
+
+    Magazine& magazine = m_magazines[getMagazineIndex()];
+    std::lock_guard<dxvk::mutex> lock(magazine.mutex);
+
+    auto& slices = magazine.slices[sizeClass];
+
+    if (slices.size() >= MagazineSliceCount)
+      return false;
+
+    CachedSlice& slice = slices.emplace_back();
+    slice.type    = memory.m_type;
+    slice.chunk   = memory.m_chunk;
+    slice.memory  = memory.m_memory;
+    slice.offset  = memory.m_offset;
+    slice.length  = memory.m_length;
+    slice.mapPtr  = memory.m_mapPtr;
+    slice.block   = memory.m_block;
+    return true;
+  }
+
+
+  void DxvkMemoryAllocator::flushMagazines() {
+    std::vector<CachedSlice> slices;
+
+    for (auto& magazine : m_magazines) {
+      std::lock_guard<dxvk::mutex> lock(magazine.mutex);
+
+      for (auto& list : magazine.slices) {
+        slices.insert(slices.end(), list.begin(), list.end());
+        list.clear();
+      }
+    }
+
+    for (const auto& slice : slices) {
+      std::lock_guard<dxvk::mutex> lock(slice.type->mutex);
+      this->freeChunkMemory(slice.type, slice.chunk, slice.block);
+    }
+  }
+
+
+  void DxvkMemoryAllocator::runDefragThread() {
+    env::setThreadName("dxvk-defrag");
+
+    while (true) {
+      { std::unique_lock<dxvk::mutex> lock(m_defragMutex);
+
+        bool stop = m_defragCond.wait_for(lock,
+          std::chrono::seconds(1),
+          [this] { return m_defragStop; });
+
+        if (stop)
+          return;
+      }
+
+      for (uint32_t i = 0; i < m_memProps.memoryTypeCount; i++)
+        this->updateEvacuation(&m_memTypes[i]);
+    }
+  }
+
+
+  void DxvkMemoryAllocator::updateEvacuation(
+          DxvkMemoryType*       type) {
+    std::lock_guard<dxvk::mutex> lock(type->mutex);
+
+    // Stop evacuating chunks that filled up again, this
+    // can happen if other chunks ran out of memory
+    for (const auto& chunk : type->chunks) {
+      if (chunk->isEvacuating() && 2 * chunk->usedSize() >= chunk->size())
+        chunk->setEvacuating(false);
+    }
+
+    // Chunks that are at most a quarter full are considered
+    // sparse. Only evacuate one chunk per pass, and only if
+    // the remaining chunks have enough space to take in all
+    // of its resources, so that no new memory is needed.
+    auto isSparse = [] (const Rc<DxvkMemoryChunk>& chunk) {
+      return 4 * chunk->usedSize() <= chunk->size();
+    };
+
+    for (const auto& chunk : type->chunks) {
+      if (chunk->isEmpty() || chunk->isEvacuating() || !isSparse(chunk))
+        continue;
+
+      VkDeviceSize freeSize = 0;
+
+      for (const auto& other : type->chunks) {
+        if (other != chunk && !other->isEvacuating() && !isSparse(other) && other->isCompatible(chunk))
+          freeSize += other->size() - other->usedSize();
+      }
+
+      if (freeSize >= chunk->usedSize()) {
+        chunk->setEvacuating(true);
+        break;
+      }
+    }
+  }
+
+
+  uint32_t DxvkMemoryAllocator::getMagazineIndex() {
+    static std::atomic<uint32_t> s_nextMagazine = { 0u };
+    static thread_local uint32_t s_magazine = s_nextMagazine++ % MagazineCount;
+    return s_magazine;
+  }
+
+
+  uint32_t DxvkMemoryAllocator::getSizeClass(
+          VkDeviceSize          size) {
+    // Each power of two is divided into four size
+    // classes, which limits the amount of memory
+    // wasted by rounding up to 25 percent.
+    if (size <= MagazineMinSize)
+      return 0;
+
+    uint32_t msb = findMsb(size - 1);
+    uint32_t sub = uint32_t((size - 1) >> (msb - 2)) - 4;
+    return 1 + 4 * (msb - findMsb(MagazineMinSize)) + sub;
+  }
+
+
+  VkDeviceSize DxvkMemoryAllocator::getSizeClassSize(
+          uint32_t              sizeClass) {
+    if (!sizeClass)
+      return MagazineMinSize;
+
+    uint32_t octave = (sizeClass - 1) / 4;
+    uint32_t sub    = (sizeClass - 1) % 4;
+    return (MagazineMinSize + (MagazineMinSize / 4) * (sub + 1)) << octave;
+  }
+
 }
@@ -11,11 +11,14 @@ namespace dxvk {
    * \brief Memory stats
    * 
    * Reports the amount of device memory
-   * allocated and used by the application.
+   * allocated and used by the application,
+   * as well as the amount of unused memory
+   * in chunks that are partially in use.
    */
   struct DxvkMemoryStats {
-    VkDeviceSize memoryAllocated = 0;
-    VkDeviceSize memoryUsed      = 0;
+    VkDeviceSize memoryAllocated  = 0;
+    VkDeviceSize memoryUsed       = 0;
+    VkDeviceSize memoryFragmented = 0;
   };
 
 
@@ -65,11 +68,14 @@ namespace dxvk {
    * 
    * Corresponds to a Vulkan memory heap and stores
    * its properties as well as allocation statistics.
+   * Statistics are atomic since memory types on the
+   * same heap can be allocated from concurrently.
    */
   struct DxvkMemoryHeap {
-    VkMemoryHeap      properties;
-    DxvkMemoryStats   stats;
-    VkDeviceSize      budget;
+    VkMemoryHeap              properties;
+    std::atomic<VkDeviceSize> memoryAllocated = { 0 };
+    std::atomic<VkDeviceSize> memoryUsed      = { 0 };
+    VkDeviceSize              budget;
   };
 
 
@@ -78,7 +84,8 @@ namespace dxvk {
    * 
    * Corresponds to a Vulkan memory type and stores
    * memory chunks used to sub-allocate memory on
-   * this memory type.
+   * this memory type. The chunk list is protected
+   * by a per-type lock.
    */
   struct DxvkMemoryType {
     DxvkMemoryHeap*   heap;
@@ -87,6 +94,8 @@ namespace dxvk {
     VkMemoryType      memType;
     uint32_t          memTypeId;
 
+    dxvk::mutex       mutex;
+
     std::vector<Rc<DxvkMemoryChunk>> chunks;
   };
   
@@ -109,7 +118,8 @@ namespace dxvk {
       VkDeviceMemory        memory,
       VkDeviceSize          offset,
       VkDeviceSize          length,
-      void*                 mapPtr);
+      void*                 mapPtr,
+      uint32_t              block);
     DxvkMemory             (DxvkMemory&& other);
     DxvkMemory& operator = (DxvkMemory&& other);
     ~DxvkMemory();
@@ -164,6 +174,16 @@ namespace dxvk {
     operator bool () const {
       return m_memory != VK_NULL_HANDLE;
     }
+
+    /**
+     * \brief Checks whether the slice should be moved
+     *
+     * This is the case if the slice was allocated from
+     * a sparsely used chunk that is being evacuated as
+     * part of memory defragmentation.
+     * \returns \c true if the owner should be moved
+     */
+    bool isEvacuating() const;
     
   private:
     
@@ -174,6 +194,7 @@ namespace dxvk {
     VkDeviceSize          m_offset = 0;
     VkDeviceSize          m_length = 0;
     void*                 m_mapPtr = nullptr;
+    uint32_t              m_block  = 0;
     
     void free();
     
@@ -202,6 +223,13 @@ namespace dxvk {
    * 
    * A single chunk of memory that provides a
    * sub-allocator. This is not thread-safe.
+   *
+   * Free blocks are managed in a two-level segregated
+   * fit (TLSF) manner: Blocks are sorted into lists by
+   * the position of their most significant bit and the
+   * next few bits below it, and non-empty lists are
+   * tracked in bit masks, so that both allocating and
+   * freeing memory are constant-time operations.
    */
   class DxvkMemoryChunk : public RcObject {
     
@@ -238,12 +266,10 @@ namespace dxvk {
      * Returns a slice back to the chunk.
      * Called automatically when a memory
      * slice runs out of scope.
-     * \param [in] offset Slice offset
-     * \param [in] length Slice length
+     * \param [in] block Block index of the slice
      */
     void free(
-            VkDeviceSize  offset,
-            VkDeviceSize  length);
+            uint32_t      block);
 
     /**
      * \brief Checks whether the chunk is being used
@@ -251,17 +277,74 @@ namespace dxvk {
      */
     bool isEmpty() const;
 
+    /**
+     * \brief Chunk size
+     * \returns Chunk size, in bytes
+     */
+    VkDeviceSize size() const {
+      return m_memory.memSize;
+    }
+
+    /**
+     * \brief Allocated memory
+     * \returns Number of bytes in use
+     */
+    VkDeviceSize usedSize() const {
+      return m_used;
+    }
+
+    /**
+     * \brief Checks whether the chunk is being evacuated
+     *
+     * Evacuated chunks are only used for allocations
+     * if no other chunk can serve them, so that they
+     * can eventually be freed.
+     * \returns \c true if the chunk is being evacuated
+     */
+    bool isEvacuating() const {
+      return m_evacuate.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Starts or stops evacuating the chunk
+     * \param [in] evacuate Whether to evacuate the chunk
+     */
+    void setEvacuating(bool evacuate) {
+      m_evacuate.store(evacuate, std::memory_order_relaxed);
+    }
+
     /**
      * \brief Checks whether hints and flags of another chunk match
      * \param [in] other The chunk to compare to
      */
     bool isCompatible(const Rc<DxvkMemoryChunk>& other) const;
 
+    /**
+     * \brief Checks whether the chunk can serve an allocation
+     *
+     * \param [in] flags Requested memory type flags
+     * \param [in] hints Memory category
+     * \returns \c true if flags and hints are compatible
+     */
+    bool isSuitable(
+            VkMemoryPropertyFlags flags,
+            DxvkMemoryFlags       hints) const;
+
   private:
-    
-    struct FreeSlice {
+
+    constexpr static uint32_t SlBits  = 4;
+    constexpr static uint32_t SlCount = 1u << SlBits;
+    constexpr static uint32_t FlCount = 32;
+    constexpr static uint32_t NoBlock = ~0u;
+
+    struct Block {
       VkDeviceSize offset;
       VkDeviceSize length;
+      uint32_t     prevPhys;
+      uint32_t     nextPhys;
+      uint32_t     prevFree;
+      uint32_t     nextFree;
+      bool         isFree;
     };
     
     DxvkMemoryAllocator*  m_alloc;
@@ -269,9 +352,46 @@ namespace dxvk {
     DxvkDeviceMemory      m_memory;
     DxvkMemoryFlags       m_hints;
     
-    std::vector<FreeSlice> m_freeList;
+    std::vector<Block>    m_blocks;
+    std::vector<uint32_t> m_unusedBlocks;
+    uint32_t              m_allocCount = 0;
+    VkDeviceSize          m_used       = 0;
+
+    std::atomic<bool>     m_evacuate   = { false };
+
+    uint32_t                                m_flMask = 0;
+    std::array<uint32_t, FlCount>           m_slMasks = { };
+    std::array<uint32_t, FlCount * SlCount> m_freeLists;
 
     bool checkHints(DxvkMemoryFlags hints) const;
+
+    bool checkBlock(
+            uint32_t      block,
+            VkDeviceSize  size,
+            VkDeviceSize  align) const;
+
+    uint32_t findFreeBlock(
+            VkDeviceSize  size) const;
+
+    void insertFreeBlock(
+            uint32_t      block);
+
+    void removeFreeBlock(
+            uint32_t      block);
+
+    uint32_t createBlock(
+            VkDeviceSize  offset,
+            VkDeviceSize  length,
+            uint32_t      prevPhys,
+            uint32_t      nextPhys);
+
+    void destroyBlock(
+            uint32_t      block);
+
+    static void getListIndex(
+            VkDeviceSize  size,
+            uint32_t&     fl,
+            uint32_t&     sl);
     
   };
   
@@ -281,12 +401,30 @@ namespace dxvk {
    * 
    * Allocates device memory for Vulkan resources.
    * Memory objects will be destroyed automatically.
+   *
+   * Each memory type is locked individually. Small
+   * allocations are rounded up to a size class, and
+   * freed slices are cached in a number of magazines
+   * so that they can be reused without taking the
+   * memory type lock. Each thread uses its own
+   * magazine in order to avoid contention.
+   *
+   * If defragmentation is enabled, a background thread
+   * periodically marks sparsely used chunks for
+   * evacuation. Resources that live in such chunks
+   * are moved elsewhere by the context.
    */
   class DxvkMemoryAllocator {
     friend class DxvkMemory;
     friend class DxvkMemoryChunk;
 
     constexpr static VkDeviceSize SmallAllocationThreshold = 256 << 10;
+
+    constexpr static VkDeviceSize MagazineMinSize     = 256;
+    constexpr static VkDeviceSize MagazineMaxSize     = 16 << 10;
+    constexpr static uint32_t     MagazineClassCount  = 25;
+    constexpr static uint32_t     MagazineSliceCount  = 8;
+    constexpr static uint32_t     MagazineCount       = 8;
   public:
     
     DxvkMemoryAllocator(const DxvkDevice* device);
@@ -329,21 +467,40 @@ namespace dxvk {
      * \param [in] heap Heap index
      * \returns Memory stats for this heap
      */
-    DxvkMemoryStats getMemoryStats(uint32_t heap) const {
-      return m_memHeaps[heap].stats;
-    }
+    DxvkMemoryStats getMemoryStats(uint32_t heap);
     
   private:
 
+    struct CachedSlice {
+      DxvkMemoryType*       type;
+      DxvkMemoryChunk*      chunk;
+      VkDeviceMemory        memory;
+      VkDeviceSize          offset;
+      VkDeviceSize          length;
+      void*                 mapPtr;
+      uint32_t              block;
+    };
+
+    struct alignas(CACHE_LINE_SIZE) Magazine {
+      dxvk::mutex                                               mutex;
+      std::array<std::vector<CachedSlice>, MagazineClassCount>  slices;
+    };
+
     const Rc<vk::DeviceFn>                 m_vkd;
     const DxvkDevice*                      m_device;
     const VkPhysicalDeviceProperties       m_devProps;
     const VkPhysicalDeviceMemoryProperties m_memProps;
     
-    dxvk::mutex                                     m_mutex;
     std::array<DxvkMemoryHeap, VK_MAX_MEMORY_HEAPS> m_memHeaps;
     std::array<DxvkMemoryType, VK_MAX_MEMORY_TYPES> m_memTypes;
 
+    std::array<Magazine, MagazineCount>             m_magazines;
+
+    dxvk::mutex                                     m_defragMutex;
+    dxvk::condition_variable                        m_defragCond;
+    bool                                            m_defragStop = false;
+    dxvk::thread                                    m_defragThread;
+
     DxvkMemory tryAlloc(
       const VkMemoryRequirements*             req,
       const VkMemoryDedicatedAllocateInfo*    dedAllocInfo,
@@ -371,8 +528,7 @@ namespace dxvk {
     void freeChunkMemory(
             DxvkMemoryType*       type,
             DxvkMemoryChunk*      chunk,
-            VkDeviceSize          offset,
-            VkDeviceSize          length);
+            uint32_t              block);
     
     void freeDeviceMemory(
             DxvkMemoryType*       type,
@@ -393,6 +549,31 @@ namespace dxvk {
     void freeEmptyChunks(
       const DxvkMemoryHeap*       heap);
 
+    DxvkMemory tryAllocFromMagazine(
+            DxvkMemoryType*       type,
+            VkMemoryPropertyFlags flags,
+            VkDeviceSize          size,
+            VkDeviceSize          align,
+            DxvkMemoryFlags       hints);
+
+    bool tryFreeToMagazine(
+      const DxvkMemory&           memory);
+
+    void flushMagazines();
+
+    void runDefragThread();
+
+    void updateEvacuation(
+            DxvkMemoryType*       type);
+
+    static uint32_t getMagazineIndex();
+
+    static uint32_t getSizeClass(
+            VkDeviceSize          size);
+
+    static VkDeviceSize getSizeClassSize(
+            uint32_t              sizeClass);
+
   };
   
 }
@@ -11,6 +11,7 @@
 #include "dxvk_meta_resolve.h"
 #include "dxvk_pipemanager.h"
 #include "dxvk_renderpass.h"
+#include "dxvk_shader_cache.h"
 #include "dxvk_unbound.h"
 
 #include "../util/util_lazy.h"
@@ -76,6 +77,10 @@ namespace dxvk {
       return m_metaPack.get(m_device);
     }
 
+    DxvkShaderCache& shaderCache() {
+      return m_shaderCache.get(m_device);
+    }
+
   private:
 
     DxvkDevice*                   m_device;
@@ -95,6 +100,8 @@ namespace dxvk {
     Lazy<DxvkMetaResolveObjects>  m_metaResolve;
     Lazy<DxvkMetaPackObjects>     m_metaPack;
 
+    Lazy<DxvkShaderCache>         m_shaderCache;
+
   };
 
 }
\ No newline at end of file
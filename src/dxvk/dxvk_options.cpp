@@ -5,7 +5,13 @@ namespace dxvk {
   DxvkOptions::DxvkOptions(const Config& config) {
     enableDebugUtils      = config.getOption<bool>    ("dxvk.enableDebugUtils",       false);
     enableStateCache      = config.getOption<bool>    ("dxvk.enableStateCache",       true);
+    enablePipelineCache   = config.getOption<bool>    ("dxvk.enablePipelineCache",    true);
+    enableShaderCache     = config.getOption<bool>    ("dxvk.enableShaderCache",      true);
     numCompilerThreads    = config.getOption<int32_t> ("dxvk.numCompilerThreads",     0);
+    enableAsync           = config.getOption<bool>    ("dxvk.enableAsync",            false);
+    enableMemoryDefrag    = config.getOption<bool>    ("dxvk.enableMemoryDefrag",     false);
+    memoryDefragBudget    = config.getOption<int32_t> ("dxvk.memoryDefragBudget",     16);
+    splitDescriptorSets   = config.getOption<bool>    ("dxvk.splitDescriptorSets",    true);
     useRawSsbo            = config.getOption<Tristate>("dxvk.useRawSsbo",             Tristate::Auto);
     shrinkNvidiaHvvHeap   = config.getOption<Tristate>("dxvk.shrinkNvidiaHvvHeap",    Tristate::Auto);
     hud                   = config.getOption<std::string>("dxvk.hud", "");
@@ -14,10 +14,32 @@ namespace dxvk {
     /// Enable state cache
     bool enableStateCache;
 
+    /// Enable persistent driver pipeline cache
+    bool enablePipelineCache;
+
+    /// Enable persistent cache for translated shaders
+    bool enableShaderCache;
+
     /// Number of compiler threads
     /// when using the state cache
     int32_t numCompilerThreads;
 
+    /// Compile pipelines asynchronously
+    /// and skip draws until they are ready
+    bool enableAsync;
+
+    /// Move buffers out of sparsely
+    /// used memory chunks
+    bool enableMemoryDefrag;
+
+    /// Number of bytes that may be moved
+    /// per frame for defragmentation, in MiB
+    int32_t memoryDefragBudget;
+
+    /// Use separate descriptor sets
+    /// for different shader stages
+    bool splitDescriptorSets;
+
     /// Shader-related options
     Tristate useRawSsbo;
 
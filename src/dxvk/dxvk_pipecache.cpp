@@ -1,5 +1,244 @@
+#include <cstring>
+
+#include "dxvk_device.h"
 #include "dxvk_pipecache.h"
 
 namespace dxvk {
-  
+
+  DxvkPipelineCache::DxvkPipelineCache(const DxvkDevice* device)
+  : m_device(device), m_vkd(device->vkd()) {
+    std::string usePipelineCache = env::getEnvVar("DXVK_PIPELINE_CACHE");
+
+    if (usePipelineCache != "0" && device->config().enablePipelineCache)
+      m_fileName = getCacheFileName();
+
+    std::vector<char> initialData;
+
+    if (!m_fileName.empty())
+      initialData = loadCacheFile();
+
+    VkPipelineCacheCreateInfo info;
+    info.sType            = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    info.pNext            = nullptr;
+    info.flags            = 0;
+    info.initialDataSize  = initialData.size();
+    info.pInitialData     = initialData.data();
+
+    if (m_vkd->vkCreatePipelineCache(m_vkd->device(), &info, nullptr, &m_handle) != VK_SUCCESS) {
+      // Drivers may reject data that passed our own validation,
+      // so retry with an empty cache before giving up entirely
+      info.initialDataSize  = 0;
+      info.pInitialData     = nullptr;
+
+      if (m_vkd->vkCreatePipelineCache(m_vkd->device(), &info, nullptr, &m_handle) != VK_SUCCESS)
+        throw DxvkError("DxvkPipelineCache: Failed to create pipeline cache");
+    }
+
+    info.initialDataSize  = 0;
+    info.pInitialData     = nullptr;
+
+    if (m_vkd->vkCreatePipelineCache(m_vkd->device(), &info, nullptr, &m_mergeHandle) != VK_SUCCESS)
+      throw DxvkError("DxvkPipelineCache: Failed to create pipeline cache");
+
+    if (!m_fileName.empty())
+      m_updateThread = dxvk::thread([this] () { runThread(); });
+  }
+
+
+  DxvkPipelineCache::~DxvkPipelineCache() {
+    if (m_updateThread.joinable()) {
+      { std::lock_guard<dxvk::mutex> lock(m_updateLock);
+        m_updateStop = true;
+        m_updateCond.notify_one();
+      }
+
+      m_updateThread.join();
+
+      // Write out whatever got added since the last update
+      if (m_updateCounter.load() != m_storeCounter)
+        storeCacheFile();
+    }
+
+    m_vkd->vkDestroyPipelineCache(m_vkd->device(), m_handle, nullptr);
+    m_vkd->vkDestroyPipelineCache(m_vkd->device(), m_mergeHandle, nullptr);
+  }
+
+
+  void DxvkPipelineCache::runThread() {
+    env::setThreadName("dxvk-pipecache");
+
+    while (true) {
+      // Only check for updates once a minute, writing out the
+      // entire cache for every single pipeline is too expensive
+      { std::unique_lock<dxvk::mutex> lock(m_updateLock);
+
+        bool stop = m_updateCond.wait_for(lock,
+          std::chrono::seconds(60),
+          [this] { return m_updateStop; });
+
+        if (stop)
+          return;
+      }
+
+      if (m_updateCounter.load() != m_storeCounter)
+        storeCacheFile();
+    }
+  }
+
+
+  std::vector<char> DxvkPipelineCache::loadCacheFile() const {
+    std::ifstream file(m_fileName.c_str(), std::ios_base::binary);
+
+    if (!file) {
+      Logger::warn("DXVK: No pipeline cache file found");
+      return std::vector<char>();
+    }
+
+    DxvkPipelineCacheHeader expected = getExpectedHeader();
+    DxvkPipelineCacheHeader header;
+
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+      Logger::warn("DXVK: Failed to read pipeline cache header");
+      return std::vector<char>();
+    }
+
+    if (std::memcmp(header.magic, expected.magic, sizeof(header.magic))
+     || header.version != expected.version) {
+      Logger::warn("DXVK: Pipeline cache version not supported");
+      return std::vector<char>();
+    }
+
+    if (header.vendorId      != expected.vendorId
+     || header.deviceId      != expected.deviceId
+     || header.driverVersion != expected.driverVersion
+     || std::memcmp(header.uuid, expected.uuid, sizeof(header.uuid))) {
+      Logger::warn("DXVK: Pipeline cache created for different device or driver");
+      return std::vector<char>();
+    }
+
+    std::vector<char> data(header.dataSize);
+
+    if (!file.read(data.data(), data.size())
+     || Sha1Hash::compute(data.data(), data.size()) != header.dataHash) {
+      Logger::warn("DXVK: Pipeline cache data corrupted");
+      return std::vector<char>();
+    }
+
+    Logger::info(str::format("DXVK: Read ", data.size(), " bytes of pipeline cache data"));
+    return data;
+  }
+
+
+  void DxvkPipelineCache::storeCacheFile() {
+    m_storeCounter = m_updateCounter.load();
+
+    std::vector<char> data;
+
+    { std::lock_guard<dxvk::mutex> lock(m_mergeLock);
+
+      // The main cache may be in use by other threads, which
+      // is fine as long as it is only used as a merge source
+      if (m_vkd->vkMergePipelineCaches(m_vkd->device(), m_mergeHandle, 1, &m_handle) != VK_SUCCESS)
+        Logger::warn("DxvkPipelineCache: Failed to merge main cache");
+
+      if (!readCacheData(data))
+        return;
+    }
+
+    DxvkPipelineCacheHeader header = getExpectedHeader();
+    header.dataSize = data.size();
+    header.dataHash = Sha1Hash::compute(data.data(), data.size());
+
+    // Write to a temporary file first and replace the old
+    // file only once all data is written, so that an
+    // interrupted write cannot leave a truncated cache
+    std::wstring tmpName = m_fileName + L".tmp";
+
+    { std::ofstream file(tmpName.c_str(),
+        std::ios_base::binary |
+        std::ios_base::trunc);
+
+      if (!file && env::createDirectory(getCacheDir())) {
+        file = std::ofstream(tmpName.c_str(),
+          std::ios_base::binary |
+          std::ios_base::trunc);
+      }
+
+      file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      file.write(data.data(), data.size());
+      file.flush();
+
+      if (!file) {
+        Logger::warn("DXVK: Failed to write pipeline cache file");
+        return;
+      }
+    }
+
+#ifdef _WIN32
+    bool renamed = ::MoveFileExW(tmpName.c_str(), m_fileName.c_str(),
+      MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+    bool renamed = !std::rename(str::fromws(tmpName.c_str()).c_str(),
+      str::fromws(m_fileName.c_str()).c_str());
+#endif
+
+    if (!renamed)
+      Logger::warn("DXVK: Failed to replace pipeline cache file");
+  }
+
+
+  bool DxvkPipelineCache::readCacheData(
+          std::vector<char>&      data) const {
+    // The merge cache can only change while the merge lock
+    // is held, which the caller must hold, so the size will
+    // not change between the two queries.
+    size_t dataSize = 0;
+
+    VkResult status = m_vkd->vkGetPipelineCacheData(
+      m_vkd->device(), m_mergeHandle, &dataSize, nullptr);
+
+    if (status == VK_SUCCESS) {
+      data.resize(dataSize);
+      status = m_vkd->vkGetPipelineCacheData(m_vkd->device(),
+        m_mergeHandle, &dataSize, data.data());
+      data.resize(dataSize);
+    }
+
+    if (status != VK_SUCCESS) {
+      Logger::warn("DxvkPipelineCache: Failed to retrieve pipeline cache data");
+      return false;
+    }
+
+    return true;
+  }
+
+
+  DxvkPipelineCacheHeader DxvkPipelineCache::getExpectedHeader() const {
+    const VkPhysicalDeviceProperties& properties = m_device->properties().core.properties;
+
+    DxvkPipelineCacheHeader header;
+    header.vendorId       = properties.vendorID;
+    header.deviceId       = properties.deviceID;
+    header.driverVersion  = properties.driverVersion;
+    std::memcpy(header.uuid, properties.pipelineCacheUUID, VK_UUID_SIZE);
+    return header;
+  }
+
+
+  std::wstring DxvkPipelineCache::getCacheFileName() const {
+    std::string path = getCacheDir();
+
+    if (!path.empty() && *path.rbegin() != '/')
+      path += '/';
+
+    std::string exeName = env::getExeBaseName();
+    path += exeName + ".dxvk-pipecache";
+    return str::tows(path.c_str());
+  }
+
+
+  std::string DxvkPipelineCache::getCacheDir() const {
+    return env::getEnvVar("DXVK_STATE_CACHE_PATH");
+  }
+
 }
@@ -3,35 +3,120 @@
 #include <atomic>
 #include <condition_variable>
 #include <fstream>
+#include <vector>
 
 #include "dxvk_include.h"
 
 #include "../util/sha1/sha1_util.h"
+#include "../util/thread.h"
 #include "../util/util_env.h"
 #include "../util/util_time.h"
 
 namespace dxvk {
-  
+
+  class DxvkDevice;
+
+  /**
+   * \brief Pipeline cache file header
+   *
+   * Identifies the device and driver that produced
+   * the cache data. If any of these do not match the
+   * current device, the file will be discarded rather
+   * than passed to the driver.
+   */
+  struct DxvkPipelineCacheHeader {
+    char     magic[4]             = { 'D', 'X', 'P', 'C' };
+    uint32_t version              = 1;
+    uint32_t vendorId             = 0;
+    uint32_t deviceId             = 0;
+    uint32_t driverVersion        = 0;
+    uint8_t  uuid[VK_UUID_SIZE]   = { };
+    uint32_t dataSize             = 0;
+    Sha1Hash dataHash;
+  };
+
+  static_assert(sizeof(DxvkPipelineCacheHeader) == 60);
+
   /**
    * \brief Pipeline cache
-   * 
+   *
    * Allows the Vulkan implementation to
    * re-use previously compiled pipelines.
+   * The cache is loaded from disk on startup
+   * and periodically written back to disk
+   * by a background thread.
+   *
+   * All threads compile pipelines against the
+   * main cache. Merging requires external
+   * synchronization of the destination cache,
+   * so the main cache is only ever used as a
+   * merge source, and its contents are merged
+   * into a separate cache before writing the
+   * file.
    */
   class DxvkPipelineCache : public RcObject {
-    
+
   public:
-    
-    DxvkPipelineCache(const Rc<vk::DeviceFn>& vkd) { }
-    
+
+    DxvkPipelineCache(const DxvkDevice* device);
+    ~DxvkPipelineCache();
+
     /**
      * \brief Pipeline cache handle
+     *
+     * Can be used to compile pipelines from any
+     * thread, since this cache is never used as
+     * the destination of a merge operation.
      * \returns Pipeline cache handle
      */
     VkPipelineCache handle() const {
-      return VK_NULL_HANDLE;
+      return m_handle;
     }
-    
+
+    /**
+     * \brief Notifies the cache about new pipelines
+     *
+     * The cache file will only be written back
+     * to disk if new pipelines have been added.
+     */
+    void update() {
+      m_updateCounter += 1;
+    }
+
+  private:
+
+    const DxvkDevice*         m_device;
+    Rc<vk::DeviceFn>          m_vkd;
+    VkPipelineCache           m_handle = VK_NULL_HANDLE;
+    VkPipelineCache           m_mergeHandle = VK_NULL_HANDLE;
+
+    std::wstring              m_fileName;
+
+    std::atomic<uint32_t>     m_updateCounter = { 0u };
+    uint32_t                  m_storeCounter  = 0u;
+
+    dxvk::mutex               m_mergeLock;
+
+    dxvk::mutex               m_updateLock;
+    dxvk::condition_variable  m_updateCond;
+    bool                      m_updateStop = false;
+    dxvk::thread              m_updateThread;
+
+    void runThread();
+
+    std::vector<char> loadCacheFile() const;
+
+    void storeCacheFile();
+
+    bool readCacheData(
+            std::vector<char>&      data) const;
+
+    DxvkPipelineCacheHeader getExpectedHeader() const;
+
+    std::wstring getCacheFileName() const;
+
+    std::string getCacheDir() const;
+
   };
-  
+
 }
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstring>
 
 #include "dxvk_descriptor.h"
@@ -25,6 +26,7 @@ namespace dxvk {
       slotInfo.view   = desc.view;
       slotInfo.stages = stage;
       slotInfo.access = desc.access;
+      slotInfo.set    = 0;
       m_descriptorSlots.push_back(slotInfo);
     }
   }
@@ -53,6 +55,17 @@ namespace dxvk {
   }
   
   
+  uint32_t DxvkDescriptorSlotMapping::getSetBindingId(uint32_t bindingId) const {
+    uint32_t set   = m_descriptorSlots[bindingId].set;
+    uint32_t first = bindingId;
+
+    while (first && m_descriptorSlots[first - 1].set == set)
+      first -= 1;
+    
+    return bindingId - first;
+  }
+  
+  
   void DxvkDescriptorSlotMapping::makeDescriptorsDynamic(
           uint32_t              uniformBuffers,
           uint32_t              storageBuffers) {
@@ -61,6 +74,27 @@ namespace dxvk {
   }
 
 
+  void DxvkDescriptorSlotMapping::splitDescriptorSets() {
+    // Only assign set indices to classes that are actually
+    // used, since pipeline layouts cannot have any holes
+    uint32_t classMask = 0;
+
+    for (const auto& slot : m_descriptorSlots)
+      classMask |= 1u << getSetClass(slot.stages);
+
+    for (auto& slot : m_descriptorSlots) {
+      uint32_t setClass = getSetClass(slot.stages);
+      slot.set = bit::popcnt(classMask & ((1u << setClass) - 1));
+    }
+
+    // Bindings of the same set must be contiguous
+    std::stable_sort(m_descriptorSlots.begin(), m_descriptorSlots.end(),
+      [] (const DxvkDescriptorSlot& a, const DxvkDescriptorSlot& b) {
+        return a.set < b.set;
+      });
+  }
+
+
   uint32_t DxvkDescriptorSlotMapping::countDescriptors(
           VkDescriptorType      type) const {
     uint32_t count = 0;
@@ -82,12 +116,29 @@ namespace dxvk {
   }
 
 
+  uint32_t DxvkDescriptorSlotMapping::getSetClass(
+          VkShaderStageFlags    stages) {
+    // Resources shared between stages go into the set of
+    // the earliest stage. Compute shaders only use one set.
+    if (stages & VK_SHADER_STAGE_VERTEX_BIT)
+      return 0;
+    
+    if (stages & (VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT
+                | VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT
+                | VK_SHADER_STAGE_GEOMETRY_BIT))
+      return 1;
+    
+    return 2;
+  }
+
+
   DxvkPipelineLayout::DxvkPipelineLayout(
     const Rc<vk::DeviceFn>&   vkd,
     const DxvkDescriptorSlotMapping& slotMapping,
           VkPipelineBindPoint pipelineBindPoint)
   : m_vkd           (vkd),
     m_pushConstRange(slotMapping.pushConstRange()),
+    m_setCount      (slotMapping.setCount()),
     m_bindingSlots  (slotMapping.bindingCount()) {
 
     auto bindingCount = slotMapping.bindingCount();
@@ -96,6 +147,9 @@ namespace dxvk {
     if (bindingCount > MaxNumActiveBindings)
       throw DxvkError(str::format("Too many active bindings in pipeline layout (", bindingCount, ")"));
     
+    if (m_setCount > MaxNumDescriptorSets)
+      throw DxvkError(str::format("Too many descriptor sets in pipeline layout (", m_setCount, ")"));
+    
     for (uint32_t i = 0; i < bindingCount; i++)
       m_bindingSlots[i] = bindingInfos[i];
     
@@ -103,47 +157,69 @@ namespace dxvk {
     std::vector<VkDescriptorUpdateTemplateEntry> tEntries(bindingCount);
     
     for (uint32_t i = 0; i < bindingCount; i++) {
-      bindings[i].binding            = i;
+      auto& set = m_descriptorSets[bindingInfos[i].set];
+
+      if (!set.bindingCount) {
+        set.bindingIndex = i;
+        set.dynamicIndex = m_dynamicSlots.size();
+      }
+
+      uint32_t binding = i - set.bindingIndex;
+
+      bindings[i].binding            = binding;
       bindings[i].descriptorType     = bindingInfos[i].type;
       bindings[i].descriptorCount    = 1;
       bindings[i].stageFlags         = bindingInfos[i].stages;
       bindings[i].pImmutableSamplers = nullptr;
       
-      tEntries[i].dstBinding      = i;
+      tEntries[i].dstBinding      = binding;
       tEntries[i].dstArrayElement = 0;
       tEntries[i].descriptorCount = 1;
       tEntries[i].descriptorType  = bindingInfos[i].type;
-      tEntries[i].offset          = sizeof(DxvkDescriptorInfo) * i;
+      tEntries[i].offset          = sizeof(DxvkDescriptorInfo) * binding;
       tEntries[i].stride          = 0;
 
-      if (bindingInfos[i].type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC)
+      if (bindingInfos[i].type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC) {
         m_dynamicSlots.push_back(i);
+        m_dynamicSetMask |= 1u << bindingInfos[i].set;
+        set.dynamicCount += 1;
+      }
       
       m_descriptorTypes.set(bindingInfos[i].type);
+      set.descriptorCounts.descriptors[bindingInfos[i].type] += 1;
+      set.bindingCount += 1;
     }
     
-    // Create descriptor set layout. We do not need to
-    // create one if there are no active resource bindings.
-    if (bindingCount > 0) {
+    // Create descriptor set layouts. We do not need to
+    // create any if there are no active resource bindings.
+    std::array<VkDescriptorSetLayout, MaxNumDescriptorSets> setLayouts;
+
+    for (uint32_t i = 0; i < m_setCount; i++) {
+      auto& set = m_descriptorSets[i];
+
       VkDescriptorSetLayoutCreateInfo dsetInfo;
       dsetInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
       dsetInfo.pNext        = nullptr;
       dsetInfo.flags        = 0;
-      dsetInfo.bindingCount = bindings.size();
-      dsetInfo.pBindings    = bindings.data();
+      dsetInfo.bindingCount = set.bindingCount;
+      dsetInfo.pBindings    = &bindings[set.bindingIndex];
       
       if (m_vkd->vkCreateDescriptorSetLayout(m_vkd->device(),
-            &dsetInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS)
+            &dsetInfo, nullptr, &set.setLayout) != VK_SUCCESS) {
+        this->destroyObjects();
         throw DxvkError("DxvkPipelineLayout: Failed to create descriptor set layout");
+      }
+
+      setLayouts[i] = set.setLayout;
     }
     
-    // Create pipeline layout with the given descriptor set layout
+    // Create pipeline layout with the given descriptor set layouts
     VkPipelineLayoutCreateInfo pipeInfo;
     pipeInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipeInfo.pNext                  = nullptr;
     pipeInfo.flags                  = 0;
-    pipeInfo.setLayoutCount         = bindingCount > 0 ? 1 : 0;
-    pipeInfo.pSetLayouts            = &m_descriptorSetLayout;
+    pipeInfo.setLayoutCount         = m_setCount;
+    pipeInfo.pSetLayouts            = setLayouts.data();
     pipeInfo.pushConstantRangeCount = 0;
     pipeInfo.pPushConstantRanges    = nullptr;
 
@@ -154,29 +230,31 @@ namespace dxvk {
     
     if (m_vkd->vkCreatePipelineLayout(m_vkd->device(),
         &pipeInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
-      m_vkd->vkDestroyDescriptorSetLayout(m_vkd->device(), m_descriptorSetLayout, nullptr);
+      this->destroyObjects();
       throw DxvkError("DxvkPipelineLayout: Failed to create pipeline layout");
     }
     
-    // Create descriptor update template. If there are no active
-    // resource bindings, there won't be any descriptors to update.
-    if (bindingCount > 0) {
+    // Create one descriptor update template per set. Descriptor
+    // data passed to the template must start at the first
+    // binding of the respective set.
+    for (uint32_t i = 0; i < m_setCount; i++) {
+      auto& set = m_descriptorSets[i];
+
       VkDescriptorUpdateTemplateCreateInfo templateInfo;
       templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
       templateInfo.pNext = nullptr;
       templateInfo.flags = 0;
-      templateInfo.descriptorUpdateEntryCount = tEntries.size();
-      templateInfo.pDescriptorUpdateEntries   = tEntries.data();
+      templateInfo.descriptorUpdateEntryCount = set.bindingCount;
+      templateInfo.pDescriptorUpdateEntries   = &tEntries[set.bindingIndex];
       templateInfo.templateType               = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
-      templateInfo.descriptorSetLayout        = m_descriptorSetLayout;
+      templateInfo.descriptorSetLayout        = set.setLayout;
       templateInfo.pipelineBindPoint          = pipelineBindPoint;
       templateInfo.pipelineLayout             = m_pipelineLayout;
-      templateInfo.set                        = 0;
+      templateInfo.set                        = i;
       
       if (m_vkd->vkCreateDescriptorUpdateTemplate(
-          m_vkd->device(), &templateInfo, nullptr, &m_descriptorTemplate) != VK_SUCCESS) {
-        m_vkd->vkDestroyDescriptorSetLayout(m_vkd->device(), m_descriptorSetLayout, nullptr);
-        m_vkd->vkDestroyPipelineLayout(m_vkd->device(), m_pipelineLayout, nullptr);
+          m_vkd->device(), &templateInfo, nullptr, &set.updateTemplate) != VK_SUCCESS) {
+        this->destroyObjects();
         throw DxvkError("DxvkPipelineLayout: Failed to create descriptor update template");
       }
     }
@@ -184,14 +262,23 @@ namespace dxvk {
   
   
   DxvkPipelineLayout::~DxvkPipelineLayout() {
-    m_vkd->vkDestroyDescriptorUpdateTemplate(
-      m_vkd->device(), m_descriptorTemplate, nullptr);
+    this->destroyObjects();
+  }
+
+
+  void DxvkPipelineLayout::destroyObjects() {
+    for (uint32_t i = 0; i < m_setCount; i++) {
+      m_vkd->vkDestroyDescriptorUpdateTemplate(
+        m_vkd->device(), m_descriptorSets[i].updateTemplate, nullptr);
+    }
     
     m_vkd->vkDestroyPipelineLayout(
       m_vkd->device(), m_pipelineLayout, nullptr);
     
-    m_vkd->vkDestroyDescriptorSetLayout(
-      m_vkd->device(), m_descriptorSetLayout, nullptr);
+    for (uint32_t i = 0; i < m_setCount; i++) {
+      m_vkd->vkDestroyDescriptorSetLayout(
+        m_vkd->device(), m_descriptorSets[i].setLayout, nullptr);
+    }
   }
   
 }
\ No newline at end of file
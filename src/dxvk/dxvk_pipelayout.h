@@ -1,8 +1,11 @@
 #pragma once
 
+#include <array>
 #include <vector>
 
+#include "dxvk_descriptor.h"
 #include "dxvk_include.h"
+#include "dxvk_limits.h"
 
 namespace dxvk {
 
@@ -32,6 +35,27 @@ namespace dxvk {
     VkImageViewType    view;    ///< Compatible image view type
     VkShaderStageFlags stages;  ///< Stages that can use the resource
     VkAccessFlags      access;  ///< Access flags
+    uint32_t           set;     ///< Descriptor set index
+  };
+  
+  
+  /**
+   * \brief Descriptor set info
+   * 
+   * Stores the Vulkan objects required to allocate
+   * and update a single descriptor set, as well as
+   * the range of bindings within the pipeline layout
+   * that are part of the set. Bindings of one set are
+   * always stored contiguously.
+   */
+  struct DxvkDescriptorSetInfo {
+    VkDescriptorSetLayout         setLayout      = VK_NULL_HANDLE;
+    VkDescriptorUpdateTemplateKHR updateTemplate = VK_NULL_HANDLE;
+    uint32_t                      bindingIndex   = 0;
+    uint32_t                      bindingCount   = 0;
+    uint32_t                      dynamicIndex   = 0;
+    uint32_t                      dynamicCount   = 0;
+    DxvkDescriptorCounts          descriptorCounts;
   };
   
   
@@ -66,6 +90,15 @@ namespace dxvk {
       return m_descriptorSlots.data();
     }
 
+    /**
+     * \brief Number of descriptor sets
+     * \returns Descriptor set count
+     */
+    uint32_t setCount() const {
+      return m_descriptorSlots.empty()
+        ? 0 : m_descriptorSlots.back().set + 1;
+    }
+
     /**
      * \brief Push constant range
      * \returns Push constant range
@@ -109,6 +142,17 @@ namespace dxvk {
     uint32_t getBindingId(
             uint32_t              slot) const;
     
+    /**
+     * \brief Gets binding index within its set
+     * 
+     * \param [in] bindingId Binding index, as
+     *    returned by \ref getBindingId
+     * \returns Binding index relative to the
+     *    first binding of the descriptor set
+     */
+    uint32_t getSetBindingId(
+            uint32_t              bindingId) const;
+    
     /**
      * \brief Makes static descriptors dynamic
      * 
@@ -123,6 +167,19 @@ namespace dxvk {
             uint32_t              uniformBuffers,
             uint32_t              storageBuffers);
     
+    /**
+     * \brief Splits bindings into multiple descriptor sets
+     * 
+     * Assigns bindings used by the vertex shader, other
+     * pre-rasterization stages and the fragment shader
+     * to separate descriptor sets, so that changing the
+     * resources of one stage does not require rewriting
+     * descriptors for the other stages. Must be called
+     * after all slots have been defined and before any
+     * binding IDs are queried.
+     */
+    void splitDescriptorSets();
+    
   private:
     
     std::vector<DxvkDescriptorSlot> m_descriptorSlots;
@@ -134,6 +191,9 @@ namespace dxvk {
     void replaceDescriptors(
             VkDescriptorType      oldType,
             VkDescriptorType      newType);
+
+    static uint32_t getSetClass(
+            VkShaderStageFlags    stages);
     
   };
   
@@ -190,11 +250,22 @@ namespace dxvk {
     }
     
     /**
-     * \brief Descriptor set layout handle
-     * \returns Descriptor set layout handle
+     * \brief Number of descriptor sets
+     * \returns Descriptor set count
      */
-    VkDescriptorSetLayout descriptorSetLayout() const {
-      return m_descriptorSetLayout;
+    uint32_t setCount() const {
+      return m_setCount;
+    }
+    
+    /**
+     * \brief Descriptor set info
+     * 
+     * \param [in] set Descriptor set index
+     * \returns Descriptor set layout, update
+     *    template and binding ranges of the set
+     */
+    const DxvkDescriptorSetInfo& descriptorSet(uint32_t set) const {
+      return m_descriptorSets[set];
     }
     
     /**
@@ -205,14 +276,6 @@ namespace dxvk {
       return m_pipelineLayout;
     }
     
-    /**
-     * \brief Descriptor update template
-     * \returns Descriptor update template
-     */
-    VkDescriptorUpdateTemplateKHR descriptorTemplate() const {
-      return m_descriptorTemplate;
-    }
-
     /**
      * \brief Number of dynamic bindings
      * \returns Dynamic binding count
@@ -230,6 +293,17 @@ namespace dxvk {
     const DxvkDescriptorSlot& dynamicBinding(uint32_t id) const {
       return this->binding(m_dynamicSlots[id]);
     }
+
+    /**
+     * \brief Sets with dynamic bindings
+     * 
+     * These sets need to be rebound whenever
+     * any of the dynamic offsets change.
+     * \returns Bit mask of descriptor sets
+     */
+    uint32_t dynamicSetMask() const {
+      return m_dynamicSetMask;
+    }
     
     /**
      * \brief Checks for static buffer bindings
@@ -267,14 +341,18 @@ namespace dxvk {
     Rc<vk::DeviceFn> m_vkd;
     
     VkPushConstantRange             m_pushConstRange      = { };
-    VkDescriptorSetLayout           m_descriptorSetLayout = VK_NULL_HANDLE;
     VkPipelineLayout                m_pipelineLayout      = VK_NULL_HANDLE;
-    VkDescriptorUpdateTemplateKHR   m_descriptorTemplate  = VK_NULL_HANDLE;
+
+    uint32_t                        m_setCount            = 0;
+    uint32_t                        m_dynamicSetMask      = 0;
+    std::array<DxvkDescriptorSetInfo, MaxNumDescriptorSets> m_descriptorSets;
     
     std::vector<DxvkDescriptorSlot> m_bindingSlots;
     std::vector<uint32_t>           m_dynamicSlots;
 
     Flags<VkDescriptorType>         m_descriptorTypes;
+
+    void destroyObjects();
     
   };
   
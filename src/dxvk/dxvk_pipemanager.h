@@ -35,6 +35,7 @@ namespace dxvk {
   class DxvkPipelineManager {
     friend class DxvkComputePipeline;
     friend class DxvkGraphicsPipeline;
+    friend class DxvkStateCache;
   public:
     
     DxvkPipelineManager(
@@ -5,6 +5,7 @@ namespace dxvk {
   
   DxvkSubmissionQueue::DxvkSubmissionQueue(DxvkDevice* device)
   : m_device(device),
+    m_semaphore(createSemaphore()),
     m_submitThread([this] () { submitCmdLists(); }),
     m_finishThread([this] () { finishCmdLists(); }) {
 
@@ -21,6 +22,9 @@ namespace dxvk {
 
     m_submitThread.join();
     m_finishThread.join();
+
+    auto vkd = m_device->vkd();
+    vkd->vkDestroySemaphore(vkd->device(), m_semaphore, nullptr);
   }
   
   
@@ -104,9 +108,15 @@ namespace dxvk {
         std::lock_guard<dxvk::mutex> lock(m_mutexQueue);
 
         if (entry.submit.cmdList != nullptr) {
+          entry.timelineValue = m_semaphore ? m_semaphoreValue + 1 : 0;
+
           status = entry.submit.cmdList->submit(
             entry.submit.waitSync,
-            entry.submit.wakeSync);
+            entry.submit.wakeSync,
+            m_semaphore, entry.timelineValue);
+
+          if (status == VK_SUCCESS)
+            m_semaphoreValue = entry.timelineValue;
         } else if (entry.present.presenter != nullptr) {
           status = entry.present.presenter->presentImage();
         }
@@ -162,8 +172,14 @@ namespace dxvk {
       
       VkResult status = m_lastError.load();
       
-      if (status != VK_ERROR_DEVICE_LOST)
-        status = entry.submit.cmdList->synchronize();
+      if (status != VK_ERROR_DEVICE_LOST) {
+        // Command lists that completed along with a previous
+        // one can be retired without waiting again
+        if (!m_semaphore)
+          status = entry.submit.cmdList->synchronize();
+        else if (entry.timelineValue > m_semaphoreCompleted)
+          status = waitForValue(entry.timelineValue);
+      }
       
       if (status != VK_SUCCESS) {
         Logger::err(str::format("DxvkSubmissionQueue: Failed to sync fence: ", status));
@@ -188,5 +204,52 @@ namespace dxvk {
       m_device->recycleCommandList(entry.submit.cmdList);
     }
   }
+
+
+  VkResult DxvkSubmissionQueue::waitForValue(
+          uint64_t        value) {
+    auto vkd = m_device->vkd();
+
+    VkSemaphoreWaitInfoKHR waitInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR };
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores    = &m_semaphore;
+    waitInfo.pValues        = &value;
+
+    VkResult status = VK_TIMEOUT;
+
+    while (status == VK_TIMEOUT) {
+      status = vkd->vkWaitSemaphoresKHR(
+        vkd->device(), &waitInfo, 1'000'000'000ull);
+    }
+
+    if (status != VK_SUCCESS)
+      return status;
+
+    // Query the actual value, since the GPU may have
+    // completed any number of later submissions by now
+    return vkd->vkGetSemaphoreCounterValueKHR(
+      vkd->device(), m_semaphore, &m_semaphoreCompleted);
+  }
+
+
+  VkSemaphore DxvkSubmissionQueue::createSemaphore() {
+    if (!m_device->features().khrTimelineSemaphore.timelineSemaphore)
+      return VK_NULL_HANDLE;
+
+    auto vkd = m_device->vkd();
+
+    VkSemaphoreTypeCreateInfoKHR typeInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR };
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+    typeInfo.initialValue  = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO, &typeInfo };
+
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+
+    if (vkd->vkCreateSemaphore(vkd->device(), &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+      throw DxvkError("DxvkSubmissionQueue: Failed to create timeline semaphore");
+
+    return semaphore;
+  }
   
 }
\ No newline at end of file
@@ -56,11 +56,18 @@ namespace dxvk {
     DxvkSubmitStatus*   status;
     DxvkSubmitInfo      submit;
     DxvkPresentInfo     present;
+    uint64_t            timelineValue;
   };
 
 
   /**
    * \brief Submission queue
+   *
+   * If timeline semaphores are supported, all command
+   * lists signal a single timeline semaphore with
+   * increasing values on completion. This allows the
+   * finish thread to retire all completed command
+   * lists after a single wait.
    */
   class DxvkSubmissionQueue {
 
@@ -185,6 +192,10 @@ namespace dxvk {
     std::atomic<uint32_t>   m_pending = { 0u };
     std::atomic<uint64_t>   m_gpuIdle = { 0ull };
 
+    VkSemaphore             m_semaphore;
+    uint64_t                m_semaphoreValue = 0ull;
+    uint64_t                m_semaphoreCompleted = 0ull;
+
     dxvk::mutex                 m_mutex;
     dxvk::mutex                 m_mutexQueue;
     
@@ -201,6 +212,11 @@ namespace dxvk {
     VkResult submitToQueue(
       const DxvkSubmitInfo& submission);
 
+    VkResult waitForValue(
+            uint64_t        value);
+
+    VkSemaphore createSemaphore();
+
     void submitCmdLists();
 
     void finishCmdLists();
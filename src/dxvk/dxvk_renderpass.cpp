@@ -47,9 +47,11 @@ namespace dxvk {
   DxvkRenderPass::~DxvkRenderPass() {
     m_vkd->vkDestroyRenderPass(m_vkd->device(), m_default, nullptr);
     
-    for (const auto& i : m_instances) {
-      m_vkd->vkDestroyRenderPass(
-        m_vkd->device(), i.handle, nullptr);
+    for (const auto& bucket : m_instances) {
+      for (const auto& i : bucket) {
+        m_vkd->vkDestroyRenderPass(
+          m_vkd->device(), i.handle, nullptr);
+      }
     }
   }
   
@@ -68,7 +70,7 @@ namespace dxvk {
 
       if (!handle) {
         handle = this->createRenderPass(ops);
-        m_instances.insert({ ops, handle });
+        m_instances[hashOps(ops) % InstanceBucketCount].insert({ ops, handle });
       }
     }
     
@@ -77,7 +79,9 @@ namespace dxvk {
 
 
   VkRenderPass DxvkRenderPass::findHandle(const DxvkRenderPassOps& ops) {
-    for (const auto& i : m_instances) {
+    const auto& bucket = m_instances[hashOps(ops) % InstanceBucketCount];
+
+    for (const auto& i : bucket) {
       if (compareOps(i.ops, ops))
         return i.handle;
     }
@@ -266,6 +270,29 @@ namespace dxvk {
     
     return eq;
   }
+
+
+  size_t DxvkRenderPass::hashOps(
+    const DxvkRenderPassOps& ops) {
+    DxvkHashState state;
+    state.add(uint32_t(ops.barrier.srcStages));
+    state.add(uint32_t(ops.barrier.srcAccess));
+    state.add(uint32_t(ops.barrier.dstStages));
+    state.add(uint32_t(ops.barrier.dstAccess));
+
+    state.add(uint32_t(ops.depthOps.loadOpD));
+    state.add(uint32_t(ops.depthOps.loadOpS));
+    state.add(uint32_t(ops.depthOps.loadLayout));
+    state.add(uint32_t(ops.depthOps.storeLayout));
+
+    for (uint32_t i = 0; i < MaxNumRenderTargets; i++) {
+      state.add(uint32_t(ops.colorOps[i].loadOp));
+      state.add(uint32_t(ops.colorOps[i].loadLayout));
+      state.add(uint32_t(ops.colorOps[i].storeLayout));
+    }
+
+    return state;
+  }
   
   
   DxvkRenderPassPool::DxvkRenderPassPool(const DxvkDevice* device)
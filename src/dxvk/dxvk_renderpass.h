@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <mutex>
 #include <vector>
 #include <unordered_map>
@@ -171,6 +172,8 @@ namespace dxvk {
     
   private:
     
+    constexpr static uint32_t InstanceBucketCount = 32;
+
     struct Instance {
       DxvkRenderPassOps ops;
       VkRenderPass      handle;
@@ -181,7 +184,9 @@ namespace dxvk {
     VkRenderPass            m_default;
     
     dxvk::mutex             m_mutex;
-    sync::List<Instance>    m_instances;
+
+    std::array<sync::List<Instance>,
+      InstanceBucketCount>  m_instances;
 
     VkRenderPass findHandle(
       const DxvkRenderPassOps& ops);
@@ -193,6 +198,9 @@ namespace dxvk {
       const DxvkRenderPassOps& a,
       const DxvkRenderPassOps& b);
     
+    static size_t hashOps(
+      const DxvkRenderPassOps& ops);
+    
   };
   
   
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+
 #include "dxvk_include.h"
 
 namespace dxvk {
@@ -70,6 +72,29 @@ namespace dxvk {
       }
     }
 
+    /**
+     * \brief Marks resource as tracked
+     *
+     * A command list only needs to track each resource once
+     * per access type. Resources store the tracking ID of the
+     * last command list that tracked them, so that redundant
+     * tracking, which would otherwise modify both the use
+     * count and the reference count, can be skipped.
+     * \param [in] access Access type
+     * \param [in] trackingId Command list tracking ID
+     * \returns \c true if the resource was not tracked
+     *    for the given access type with the given ID yet
+     */
+    bool markTracked(DxvkAccess access, uint64_t trackingId) {
+      auto& lastId = m_trackingIds[uint32_t(access)];
+
+      if (lastId.load(std::memory_order_relaxed) == trackingId)
+        return false;
+
+      lastId.store(trackingId, std::memory_order_relaxed);
+      return true;
+    }
+
     /**
      * \brief Waits for resource to become unused
      *
@@ -88,6 +113,8 @@ namespace dxvk {
     std::atomic<uint32_t> m_useCountR = { 0u };
     std::atomic<uint32_t> m_useCountW = { 0u };
 
+    std::array<std::atomic<uint64_t>, 3> m_trackingIds = { };
+
   };
   
 }
\ No newline at end of file
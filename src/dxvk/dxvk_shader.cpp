@@ -6,57 +6,47 @@
 
 namespace dxvk {
   
-  DxvkShaderModule::DxvkShaderModule()
-  : m_vkd(nullptr), m_stage() {
+  bool DxvkShaderModuleKey::eq(const DxvkShaderModuleKey& other) const {
+    return bindings             == other.bindings
+        && info.fsDualSrcBlend  == other.info.fsDualSrcBlend
+        && info.undefinedInputs == other.info.undefinedInputs;
+  }
+
+
+  size_t DxvkShaderModuleKey::hash() const {
+    DxvkHashState result;
+    result.add(uint32_t(info.fsDualSrcBlend));
+    result.add(info.undefinedInputs);
 
+    for (uint32_t binding : bindings)
+      result.add(binding);
+
+    return result;
   }
 
 
-  DxvkShaderModule::DxvkShaderModule(DxvkShaderModule&& other)
-  : m_vkd(std::move(other.m_vkd)) {
-    this->m_stage = other.m_stage;
-    other.m_stage = VkPipelineShaderStageCreateInfo();
+  DxvkShaderModule::DxvkShaderModule()
+  : m_stage() {
+
   }
 
 
   DxvkShaderModule::DxvkShaderModule(
-    const Rc<vk::DeviceFn>&     vkd,
-    const Rc<DxvkShader>&       shader,
-    const SpirvCodeBuffer&      code)
-  : m_vkd(vkd), m_stage() {
+          VkShaderStageFlagBits stage,
+          VkShaderModule        module)
+  : m_stage() {
     m_stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     m_stage.pNext = nullptr;
     m_stage.flags = 0;
-    m_stage.stage = shader->info().stage;
-    m_stage.module = VK_NULL_HANDLE;
+    m_stage.stage = stage;
+    m_stage.module = module;
     m_stage.pName = "main";
     m_stage.pSpecializationInfo = nullptr;
-
-    VkShaderModuleCreateInfo info;
-    info.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    info.pNext    = nullptr;
-    info.flags    = 0;
-    info.codeSize = code.size();
-    info.pCode    = code.data();
-    
-    if (m_vkd->vkCreateShaderModule(m_vkd->device(), &info, nullptr, &m_stage.module) != VK_SUCCESS)
-      throw DxvkError("DxvkComputePipeline::DxvkComputePipeline: Failed to create shader module");
   }
   
   
   DxvkShaderModule::~DxvkShaderModule() {
-    if (m_vkd != nullptr) {
-      m_vkd->vkDestroyShaderModule(
-        m_vkd->device(), m_stage.module, nullptr);
-    }
-  }
-  
-  
-  DxvkShaderModule& DxvkShaderModule::operator = (DxvkShaderModule&& other) {
-    this->m_vkd   = std::move(other.m_vkd);
-    this->m_stage = other.m_stage;
-    other.m_stage = VkPipelineShaderStageCreateInfo();
-    return *this;
+
   }
 
 
@@ -89,8 +79,10 @@ namespace dxvk {
     
     for (auto ins : code) {
       if (ins.opCode() == spv::OpDecorate) {
-        if (ins.arg(2) == spv::DecorationBinding
-         || ins.arg(2) == spv::DecorationSpecId)
+        if (ins.arg(2) == spv::DecorationBinding)
+          m_bindingOffsets.push_back({ ins.arg(1), ins.offset() + 3, 0 });
+
+        if (ins.arg(2) == spv::DecorationSpecId)
           m_idOffsets.push_back(ins.offset() + 3);
         
         if (ins.arg(2) == spv::DecorationLocation && ins.arg(3) == 1) {
@@ -118,11 +110,44 @@ namespace dxvk {
           m_flags.set(DxvkShaderFlag::ExportsViewportIndexLayerFromVertexStage);
       }
     }
+
+    // Descriptor set decorations need to be patched along
+    // with the binding index when splitting descriptor sets
+    for (auto ins : code) {
+      if (ins.opCode() == spv::OpDecorate && ins.arg(2) == spv::DecorationDescriptorSet) {
+        for (auto& binding : m_bindingOffsets) {
+          if (binding.varId == ins.arg(1))
+            binding.setOffset = ins.offset() + 3;
+        }
+      }
+    }
+
+    // Gather all resource slots that need to be remapped
+    // in order to look up shader modules efficiently
+    for (const auto& binding : m_bindingOffsets)
+      m_remappedSlots.push_back(code.data()[binding.bindingOffset]);
+
+    for (size_t ofs : m_idOffsets)
+      m_remappedSlots.push_back(code.data()[ofs]);
+
+    std::sort(m_remappedSlots.begin(), m_remappedSlots.end());
+
+    m_remappedSlots.erase(std::unique(
+      m_remappedSlots.begin(), m_remappedSlots.end()),
+      m_remappedSlots.end());
+
+    m_remappedSlots.erase(std::remove_if(
+      m_remappedSlots.begin(), m_remappedSlots.end(),
+      [] (uint32_t slot) { return slot >= MaxNumResourceSlots; }),
+      m_remappedSlots.end());
   }
 
 
   DxvkShader::~DxvkShader() {
-    
+    for (const auto& module : m_modules) {
+      m_moduleVkd->vkDestroyShaderModule(
+        m_moduleVkd->device(), module.second, nullptr);
+    }
   }
   
   
@@ -143,15 +168,97 @@ namespace dxvk {
     const Rc<vk::DeviceFn>&          vkd,
     const DxvkDescriptorSlotMapping& mapping,
     const DxvkShaderModuleCreateInfo& info) {
+    DxvkShaderModuleKey key = getModuleKey(mapping, info);
+
+    { std::lock_guard<dxvk::mutex> lock(m_moduleMutex);
+      auto entry = m_modules.find(key);
+
+      if (entry != m_modules.end())
+        return DxvkShaderModule(m_info.stage, entry->second);
+    }
+
+    // Compile outside the lock, pipelines using this
+    // shader may be compiled on multiple threads
+    SpirvCodeBuffer code = getModuleCode(mapping, info);
+
+    VkShaderModuleCreateInfo moduleInfo;
+    moduleInfo.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleInfo.pNext    = nullptr;
+    moduleInfo.flags    = 0;
+    moduleInfo.codeSize = code.size();
+    moduleInfo.pCode    = code.data();
+
+    VkShaderModule module = VK_NULL_HANDLE;
+
+    if (vkd->vkCreateShaderModule(vkd->device(), &moduleInfo, nullptr, &module) != VK_SUCCESS)
+      throw DxvkError("DxvkShader: Failed to create shader module");
+
+    std::lock_guard<dxvk::mutex> lock(m_moduleMutex);
+    m_moduleVkd = vkd;
+
+    auto entry = m_modules.insert({ key, module });
+
+    // Another thread may have created the same module
+    if (!entry.second)
+      vkd->vkDestroyShaderModule(vkd->device(), module, nullptr);
+
+    return DxvkShaderModule(m_info.stage, entry.first->second);
+  }
+
+
+  DxvkShaderModuleKey DxvkShader::getModuleKey(
+    const DxvkDescriptorSlotMapping& mapping,
+    const DxvkShaderModuleCreateInfo& info) const {
+    DxvkShaderModuleKey key;
+    key.bindings.reserve(3 * m_remappedSlots.size());
+    key.info = info;
+
+    // Only the part of the mapping that affects this
+    // shader's bindings matters, so that the module can
+    // be shared between pipelines with different layouts
+    for (uint32_t slot : m_remappedSlots) {
+      uint32_t bindingId = mapping.getBindingId(slot);
+      key.bindings.push_back(bindingId);
+
+      if (bindingId < mapping.bindingCount()) {
+        key.bindings.push_back(mapping.bindingInfos()[bindingId].set);
+        key.bindings.push_back(mapping.getSetBindingId(bindingId));
+      }
+    }
+
+    return key;
+  }
+
+
+  SpirvCodeBuffer DxvkShader::getModuleCode(
+    const DxvkDescriptorSlotMapping& mapping,
+    const DxvkShaderModuleCreateInfo& info) const {
     SpirvCodeBuffer spirvCode = m_code.decompress();
     uint32_t* code = spirvCode.data();
     
-    // Remap resource binding IDs
+    // Remap resource binding IDs. Specialization constants
+    // use the binding index within the whole pipeline layout,
+    // while descriptor bindings are relative to their set.
     for (uint32_t ofs : m_idOffsets) {
       if (code[ofs] < MaxNumResourceSlots)
         code[ofs] = mapping.getBindingId(code[ofs]);
     }
 
+    for (const auto& binding : m_bindingOffsets) {
+      if (code[binding.bindingOffset] < MaxNumResourceSlots) {
+        uint32_t bindingId = mapping.getBindingId(code[binding.bindingOffset]);
+
+        if (bindingId < mapping.bindingCount()) {
+          code[binding.bindingOffset] = mapping.getSetBindingId(bindingId);
+
+          if (binding.setOffset)
+            code[binding.setOffset] = mapping.bindingInfos()[bindingId].set;
+        } else {
+          code[binding.bindingOffset] = bindingId;
+        }
+      }
+    }
+
     // For dual-source blending we need to re-map
     // location 1, index 0 to location 0, index 1
     if (info.fsDualSrcBlend && m_o1IdxOffset && m_o1LocOffset)
@@ -161,7 +268,7 @@ namespace dxvk {
     for (uint32_t u : bit::BitMask(info.undefinedInputs))
       eliminateInput(spirvCode, u);
 
-    return DxvkShaderModule(vkd, this, spirvCode);
+    return spirvCode;
   }
   
   
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <unordered_map>
 #include <vector>
 
 #include "dxvk_include.h"
@@ -10,6 +11,8 @@
 #include "../spirv/spirv_code_buffer.h"
 #include "../spirv/spirv_compression.h"
 
+#include "../util/thread.h"
+
 namespace dxvk {
   
   class DxvkShader;
@@ -81,6 +84,24 @@ namespace dxvk {
     bool      fsDualSrcBlend  = false;
     uint32_t  undefinedInputs = 0;
   };
+
+
+  /**
+   * \brief Shader module key
+   *
+   * Stores the binding indices that the resource slots
+   * of a shader get mapped to, as well as the module
+   * create info. Two shader modules created from the
+   * same shader with equal keys are identical.
+   */
+  struct DxvkShaderModuleKey {
+    std::vector<uint32_t>       bindings;
+    DxvkShaderModuleCreateInfo  info;
+
+    bool eq(const DxvkShaderModuleKey& other) const;
+
+    size_t hash() const;
+  };
   
   
   /**
@@ -109,6 +130,14 @@ namespace dxvk {
       return m_info;
     }
 
+    /**
+     * \brief Compressed SPIR-V code
+     * \returns Compressed code
+     */
+    const SpirvCompressedBuffer& getCompressedCode() const {
+      return m_code;
+    }
+
     /**
      * \brief Retrieves shader flags
      * \returns Shader flags
@@ -130,7 +159,11 @@ namespace dxvk {
     /**
      * \brief Creates a shader module
      * 
-     * Maps the binding slot numbers 
+     * Maps the binding slot numbers to the bindings of
+     * the given mapping. Modules are cached, so that the
+     * SPIR-V code only needs to be decompressed, patched
+     * and compiled once for each unique variant. Modules
+     * remain valid for the lifetime of the shader.
      * \param [in] vkd Vulkan device functions
      * \param [in] mapping Resource slot mapping
      * \param [in] info Module create info
@@ -199,6 +232,12 @@ namespace dxvk {
     }
     
   private:
+
+    struct BindingOffsets {
+      uint32_t varId;
+      uint32_t bindingOffset;
+      uint32_t setOffset;
+    };
     
     DxvkShaderCreateInfo          m_info;
     SpirvCompressedBuffer         m_code;
@@ -213,6 +252,24 @@ namespace dxvk {
     std::vector<DxvkResourceSlot> m_slots;
     std::vector<char>             m_uniformData;
     std::vector<size_t>           m_idOffsets;
+    std::vector<BindingOffsets>   m_bindingOffsets;
+    std::vector<uint32_t>         m_remappedSlots;
+
+    dxvk::mutex                   m_moduleMutex;
+    Rc<vk::DeviceFn>              m_moduleVkd;
+
+    std::unordered_map<
+      DxvkShaderModuleKey,
+      VkShaderModule,
+      DxvkHash, DxvkEq>           m_modules;
+
+    DxvkShaderModuleKey getModuleKey(
+      const DxvkDescriptorSlotMapping& mapping,
+      const DxvkShaderModuleCreateInfo& info) const;
+
+    SpirvCodeBuffer getModuleCode(
+      const DxvkDescriptorSlotMapping& mapping,
+      const DxvkShaderModuleCreateInfo& info) const;
 
     static void eliminateInput(SpirvCodeBuffer& code, uint32_t location);
 
@@ -222,10 +279,11 @@ namespace dxvk {
   /**
    * \brief Shader module object
    * 
-   * Manages a Vulkan shader module. This will not
+   * References a Vulkan shader module. This will not
    * perform any shader compilation. Instead, the
    * context will create pipeline objects on the
-   * fly when executing draw calls.
+   * fly when executing draw calls. The module itself
+   * is owned by the shader object it was created from.
    */
   class DxvkShaderModule {
     
@@ -233,16 +291,11 @@ namespace dxvk {
 
     DxvkShaderModule();
 
-    DxvkShaderModule(DxvkShaderModule&& other);
-    
     DxvkShaderModule(
-      const Rc<vk::DeviceFn>&     vkd,
-      const Rc<DxvkShader>&       shader,
-      const SpirvCodeBuffer&      code);
+            VkShaderStageFlagBits stage,
+            VkShaderModule        module);
     
     ~DxvkShaderModule();
-
-    DxvkShaderModule& operator = (DxvkShaderModule&& other);
     
     /**
      * \brief Shader stage creation info
@@ -267,7 +320,6 @@ namespace dxvk {
     
   private:
     
-    Rc<vk::DeviceFn>                m_vkd;
     VkPipelineShaderStageCreateInfo m_stage;
     
   };
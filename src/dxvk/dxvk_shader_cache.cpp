@@ -0,0 +1,352 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include <version.h>
+
+#include "dxvk_device.h"
+#include "dxvk_shader_cache.h"
+
+namespace dxvk {
+
+  DxvkShaderCache::DxvkShaderCache(const DxvkDevice* device) {
+    std::string useShaderCache = env::getEnvVar("DXVK_SHADER_CACHE");
+
+    m_enable = useShaderCache != "0"
+      && device->config().enableShaderCache;
+
+    if (!m_enable)
+      return;
+
+    m_fileName = getCacheFileName();
+    readCacheFile();
+  }
+
+
+  DxvkShaderCache::~DxvkShaderCache() {
+    if (m_writerThread.joinable()) {
+      { std::lock_guard<dxvk::mutex> lock(m_writerLock);
+        m_stopWriter = true;
+        m_writerCond.notify_one();
+      }
+
+      m_writerThread.join();
+    }
+  }
+
+
+  Rc<DxvkShader> DxvkShaderCache::lookupShader(
+    const DxvkShaderKey&          key,
+    const Sha1Hash&               options) {
+    if (!m_enable)
+      return nullptr;
+
+    auto entry = m_entries.find(getEntryKey(key, options));
+
+    if (entry == m_entries.end())
+      return nullptr;
+
+    const char* data = m_mapping.data() + entry->second.offset;
+
+    if (Sha1Hash::compute(data, entry->second.size) != entry->second.hash) {
+      Logger::warn(str::format("DXVK: Shader cache entry for ", key.toString(), " corrupted"));
+      return nullptr;
+    }
+
+    return readShader(key, data, entry->second.size);
+  }
+
+
+  void DxvkShaderCache::addShader(
+    const Rc<DxvkShader>&         shader,
+    const Sha1Hash&               options) {
+    if (!m_enable)
+      return;
+
+    // Shaders are only added after a failed lookup, so if the
+    // key is already in the file, the entry must be corrupted
+    // and we need to write a new one.
+    Sha1Hash entryKey = getEntryKey(shader->getShaderKey(), options);
+
+    { std::lock_guard<dxvk::mutex> lock(m_writerLock);
+
+      if (!m_writtenKeys.insert(entryKey).second)
+        return;
+    }
+
+    // Serialize the shader on the calling thread so that
+    // the writer thread does not need to keep it alive
+    std::vector<char> data = writeShader(shader, entryKey);
+
+    std::lock_guard<dxvk::mutex> lock(m_writerLock);
+    m_writerQueue.push(std::move(data));
+    m_writerCond.notify_one();
+
+    if (!m_writerThread.joinable())
+      m_writerThread = dxvk::thread([this] () { writerFunc(); });
+  }
+
+
+  void DxvkShaderCache::readCacheFile() {
+    m_mapping = MappedFile(m_fileName);
+
+    if (!m_mapping) {
+      Logger::warn("DXVK: No shader cache file found");
+      return;
+    }
+
+    DxvkShaderCacheHeader expected = getExpectedHeader();
+    DxvkShaderCacheHeader header;
+
+    if (m_mapping.size() < sizeof(header)) {
+      Logger::warn("DXVK: Failed to read shader cache header");
+      m_mapping = MappedFile();
+      return;
+    }
+
+    std::memcpy(&header, m_mapping.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, expected.magic, sizeof(header.magic))
+     || header.version != expected.version
+     || header.build   != expected.build) {
+      Logger::warn("DXVK: Shader cache created by different DXVK version, discarding");
+      m_mapping = MappedFile();
+      return;
+    }
+
+    // Only read the entry headers here. The actual shader data
+    // is verified when a shader is looked up, so that pages
+    // for unused shaders never need to be loaded from disk.
+    size_t offset = sizeof(header);
+
+    while (offset < m_mapping.size()) {
+      DxvkShaderCacheEntryHeader entryHeader;
+      size_t remaining = m_mapping.size() - offset;
+
+      bool valid = remaining >= sizeof(entryHeader);
+
+      if (valid) {
+        std::memcpy(&entryHeader, m_mapping.data() + offset, sizeof(entryHeader));
+        valid = entryHeader.dataSize <= remaining - sizeof(entryHeader);
+      }
+
+      if (!valid) {
+        // A truncated or corrupted entry means that we cannot know where
+        // the next entry starts, and anything appended to the file would
+        // be unreachable. The mapped file cannot be truncated, so discard
+        // it entirely and write a new cache file instead.
+        Logger::warn("DXVK: Shader cache file truncated or corrupted, discarding");
+        m_entries.clear();
+        m_mapping = MappedFile();
+        return;
+      }
+
+      // Later entries take precedence, since they
+      // may replace corrupted entries with the same key
+      Entry entry;
+      entry.offset = offset + sizeof(entryHeader);
+      entry.size   = entryHeader.dataSize;
+      entry.hash   = entryHeader.dataHash;
+
+      m_entries[entryHeader.key] = entry;
+      offset += sizeof(entryHeader) + entryHeader.dataSize;
+    }
+
+    m_rewrite = false;
+
+    Logger::info(str::format("DXVK: Read ", m_entries.size(), " shaders from shader cache"));
+  }
+
+
+  void DxvkShaderCache::writerFunc() {
+    env::setThreadName("dxvk-shader-writer");
+
+    std::ofstream file;
+
+    while (true) {
+      std::vector<char> data;
+
+      { std::unique_lock<dxvk::mutex> lock(m_writerLock);
+
+        m_writerCond.wait(lock, [this] () {
+          return m_writerQueue.size()
+              || m_stopWriter;
+        });
+
+        // Write out all pending entries before exiting
+        if (m_writerQueue.size() == 0)
+          break;
+
+        data = std::move(m_writerQueue.front());
+        m_writerQueue.pop();
+      }
+
+      if (!file.is_open()) {
+        std::ios_base::openmode mode = std::ios_base::binary
+          | (m_rewrite ? std::ios_base::trunc : std::ios_base::app);
+
+        file.open(m_fileName.c_str(), mode);
+
+        if (!file && env::createDirectory(getCacheDir()))
+          file.open(m_fileName.c_str(), mode);
+
+        if (!file) {
+          Logger::warn("DXVK: Failed to open shader cache file for writing");
+          return;
+        }
+
+        if (m_rewrite) {
+          DxvkShaderCacheHeader header = getExpectedHeader();
+          file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        }
+      }
+
+      file.write(data.data(), data.size());
+      file.flush();
+    }
+  }
+
+
+  Rc<DxvkShader> DxvkShaderCache::readShader(
+    const DxvkShaderKey&          key,
+    const char*                   data,
+          size_t                  size) const {
+    DxvkShaderCacheShaderInfo shaderInfo;
+
+    if (size < sizeof(shaderInfo))
+      return nullptr;
+
+    std::memcpy(&shaderInfo, data, sizeof(shaderInfo));
+
+    size_t slotOffset    = sizeof(shaderInfo);
+    size_t uniformOffset = slotOffset + shaderInfo.resourceSlotCount * sizeof(DxvkResourceSlot);
+    size_t codeOffset    = uniformOffset + align(shaderInfo.uniformSize, sizeof(uint32_t));
+    size_t endOffset     = codeOffset + shaderInfo.compressedDwords * sizeof(uint32_t);
+
+    if (endOffset != size || shaderInfo.stage != key.type())
+      return nullptr;
+
+    std::vector<DxvkResourceSlot> slots(shaderInfo.resourceSlotCount);
+    std::vector<char> uniformData(shaderInfo.uniformSize);
+    std::vector<uint32_t> compressed(shaderInfo.compressedDwords);
+
+    std::memcpy(slots.data(), data + slotOffset, slots.size() * sizeof(DxvkResourceSlot));
+    std::memcpy(uniformData.data(), data + uniformOffset, uniformData.size());
+    std::memcpy(compressed.data(), data + codeOffset, compressed.size() * sizeof(uint32_t));
+
+    DxvkShaderCreateInfo info;
+    info.stage               = VkShaderStageFlagBits(shaderInfo.stage);
+    info.resourceSlotCount   = shaderInfo.resourceSlotCount;
+    info.resourceSlots       = slots.data();
+    info.inputMask           = shaderInfo.inputMask;
+    info.outputMask          = shaderInfo.outputMask;
+    info.pushConstOffset     = shaderInfo.pushConstOffset;
+    info.pushConstSize       = shaderInfo.pushConstSize;
+    info.uniformSize         = shaderInfo.uniformSize;
+    info.uniformData         = uniformData.data();
+    info.xfbRasterizedStream = shaderInfo.xfbRasterizedStream;
+
+    for (uint32_t i = 0; i < MaxNumXfbBuffers; i++)
+      info.xfbStrides[i] = shaderInfo.xfbStrides[i];
+
+    SpirvCompressedBuffer code(shaderInfo.codeDwords, std::move(compressed));
+
+    Rc<DxvkShader> shader = new DxvkShader(info, code.decompress());
+    shader->setShaderKey(key);
+    return shader;
+  }
+
+
+  std::vector<char> DxvkShaderCache::writeShader(
+    const Rc<DxvkShader>&         shader,
+    const Sha1Hash&               key) const {
+    const DxvkShaderCreateInfo& info = shader->info();
+    const SpirvCompressedBuffer& code = shader->getCompressedCode();
+
+    DxvkShaderCacheShaderInfo shaderInfo = { };
+    shaderInfo.stage               = info.stage;
+    shaderInfo.resourceSlotCount   = info.resourceSlotCount;
+    shaderInfo.inputMask           = info.inputMask;
+    shaderInfo.outputMask          = info.outputMask;
+    shaderInfo.pushConstOffset     = info.pushConstOffset;
+    shaderInfo.pushConstSize       = info.pushConstSize;
+    shaderInfo.uniformSize         = info.uniformSize;
+    shaderInfo.xfbRasterizedStream = info.xfbRasterizedStream;
+    shaderInfo.codeDwords          = code.decompressedDwords();
+    shaderInfo.compressedDwords    = code.size() / sizeof(uint32_t);
+
+    for (uint32_t i = 0; i < MaxNumXfbBuffers; i++)
+      shaderInfo.xfbStrides[i] = info.xfbStrides[i];
+
+    size_t slotSize    = info.resourceSlotCount * sizeof(DxvkResourceSlot);
+    size_t uniformSize = align(info.uniformSize, sizeof(uint32_t));
+    size_t dataSize    = sizeof(shaderInfo) + slotSize + uniformSize + code.size();
+
+    std::vector<char> result(sizeof(DxvkShaderCacheEntryHeader) + dataSize);
+    char* data = result.data() + sizeof(DxvkShaderCacheEntryHeader);
+
+    std::memcpy(data, &shaderInfo, sizeof(shaderInfo));
+    data += sizeof(shaderInfo);
+
+    if (slotSize)
+      std::memcpy(data, info.resourceSlots, slotSize);
+    data += slotSize;
+
+    if (info.uniformSize)
+      std::memcpy(data, info.uniformData, info.uniformSize);
+    data += uniformSize;
+
+    std::memcpy(data, code.data(), code.size());
+
+    DxvkShaderCacheEntryHeader header;
+    header.key      = key;
+    header.dataSize = dataSize;
+    header.dataHash = Sha1Hash::compute(
+      result.data() + sizeof(header), dataSize);
+
+    std::memcpy(result.data(), &header, sizeof(header));
+    return result;
+  }
+
+
+  Sha1Hash DxvkShaderCache::getEntryKey(
+    const DxvkShaderKey&          key,
+    const Sha1Hash&               options) {
+    uint32_t stage = key.type();
+
+    std::array<Sha1Data, 3> chunks = {{
+      { &stage,       sizeof(stage)   },
+      { &key.sha1(),  sizeof(Sha1Hash) },
+      { &options,     sizeof(Sha1Hash) },
+    }};
+
+    return Sha1Hash::compute(chunks.size(), chunks.data());
+  }
+
+
+  DxvkShaderCacheHeader DxvkShaderCache::getExpectedHeader() {
+    const char* version = DXVK_VERSION;
+
+    DxvkShaderCacheHeader header;
+    header.build = Sha1Hash::compute(version, std::strlen(version));
+    return header;
+  }
+
+
+  std::wstring DxvkShaderCache::getCacheFileName() const {
+    std::string path = getCacheDir();
+
+    if (!path.empty() && *path.rbegin() != '/')
+      path += '/';
+
+    std::string exeName = env::getExeBaseName();
+    path += exeName + ".dxvk-shaders";
+    return str::tows(path.c_str());
+  }
+
+
+  std::string DxvkShaderCache::getCacheDir() const {
+    return env::getEnvVar("DXVK_STATE_CACHE_PATH");
+  }
+
+}
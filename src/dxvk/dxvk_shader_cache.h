@@ -0,0 +1,185 @@
+#pragma once
+
+#include <atomic>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "dxvk_shader.h"
+
+#include "../util/sha1/sha1_util.h"
+#include "../util/thread.h"
+#include "../util/util_mapped_file.h"
+
+namespace dxvk {
+
+  class DxvkDevice;
+
+  /**
+   * \brief Shader cache file header
+   *
+   * Stores the file format version as well as a hash
+   * of the DXVK version that wrote the file. Shader
+   * translation may change between versions, so a
+   * mismatching file will be discarded.
+   */
+  struct DxvkShaderCacheHeader {
+    char     magic[4]   = { 'D', 'X', 'S', 'C' };
+    uint32_t version    = 1;
+    Sha1Hash build;
+  };
+
+  static_assert(sizeof(DxvkShaderCacheHeader) == 28);
+
+
+  /**
+   * \brief Shader cache entry header
+   *
+   * Precedes the serialized shader data of each entry.
+   * The key is derived from the shader key as well as
+   * the options that the shader was compiled with, and
+   * the data hash is used to detect corrupted entries.
+   */
+  struct DxvkShaderCacheEntryHeader {
+    Sha1Hash key;
+    uint32_t dataSize;
+    Sha1Hash dataHash;
+  };
+
+  static_assert(sizeof(DxvkShaderCacheEntryHeader) == 44);
+
+
+  /**
+   * \brief Serialized shader info
+   *
+   * Fixed-size part of a shader cache entry. It is
+   * followed by the resource slots, the uniform data
+   * padded to a multiple of four bytes, and finally
+   * the compressed SPIR-V code.
+   */
+  struct DxvkShaderCacheShaderInfo {
+    uint32_t stage;
+    uint32_t resourceSlotCount;
+    uint32_t inputMask;
+    uint32_t outputMask;
+    uint32_t pushConstOffset;
+    uint32_t pushConstSize;
+    uint32_t uniformSize;
+    int32_t  xfbRasterizedStream;
+    uint32_t xfbStrides[MaxNumXfbBuffers];
+    uint32_t codeDwords;
+    uint32_t compressedDwords;
+  };
+
+
+  /**
+   * \brief Shader cache key hash
+   *
+   * Entry keys are SHA-1 hashes already, so
+   * any part of the digest works as a hash.
+   */
+  struct DxvkShaderCacheKeyHash {
+    size_t operator () (const Sha1Hash& key) const {
+      return key.dword(0);
+    }
+  };
+
+
+  /**
+   * \brief Shader cache
+   *
+   * Persistently stores translated shaders, so that
+   * shaders do not have to be recompiled from their
+   * original byte code on subsequent runs. The file
+   * is mapped into memory, so that only entries that
+   * are actually used need to be read, and new entries
+   * are appended to the file by a background thread.
+   *
+   * This class is thread-safe.
+   */
+  class DxvkShaderCache {
+
+  public:
+
+    DxvkShaderCache(const DxvkDevice* device);
+    ~DxvkShaderCache();
+
+    /**
+     * \brief Looks up a shader
+     *
+     * \param [in] key Shader key
+     * \param [in] options Hash of all compiler options
+     *    that affect the translated shader
+     * \returns Shader object, or \c nullptr if the
+     *    shader is not in the cache.
+     */
+    Rc<DxvkShader> lookupShader(
+      const DxvkShaderKey&          key,
+      const Sha1Hash&               options);
+
+    /**
+     * \brief Adds a shader to the cache
+     *
+     * The shader will be written to disk asynchronously.
+     * Adding the same shader multiple times has no effect.
+     * \param [in] shader Shader with a valid shader key
+     * \param [in] options Compiler options hash
+     */
+    void addShader(
+      const Rc<DxvkShader>&         shader,
+      const Sha1Hash&               options);
+
+  private:
+
+    struct Entry {
+      size_t   offset;
+      uint32_t size;
+      Sha1Hash hash;
+    };
+
+    bool                          m_enable = false;
+    bool                          m_rewrite = true;
+
+    std::wstring                  m_fileName;
+    MappedFile                    m_mapping;
+
+    std::unordered_map<
+      Sha1Hash, Entry,
+      DxvkShaderCacheKeyHash>     m_entries;
+
+    dxvk::mutex                   m_writerLock;
+    dxvk::condition_variable      m_writerCond;
+    std::queue<std::vector<char>> m_writerQueue;
+    std::unordered_set<
+      Sha1Hash,
+      DxvkShaderCacheKeyHash>     m_writtenKeys;
+    bool                          m_stopWriter = false;
+    dxvk::thread                  m_writerThread;
+
+    void readCacheFile();
+
+    void writerFunc();
+
+    Rc<DxvkShader> readShader(
+      const DxvkShaderKey&          key,
+      const char*                   data,
+            size_t                  size) const;
+
+    std::vector<char> writeShader(
+      const Rc<DxvkShader>&         shader,
+      const Sha1Hash&               key) const;
+
+    static Sha1Hash getEntryKey(
+      const DxvkShaderKey&          key,
+      const Sha1Hash&               options);
+
+    static DxvkShaderCacheHeader getExpectedHeader();
+
+    std::wstring getCacheFileName() const;
+
+    std::string getCacheDir() const;
+
+  };
+
+}
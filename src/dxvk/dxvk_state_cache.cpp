@@ -1,3 +1,9 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <numeric>
+#include <unordered_set>
+
 #include "dxvk_device.h"
 #include "dxvk_pipemanager.h"
 #include "dxvk_state_cache.h"
@@ -8,6 +14,27 @@ namespace dxvk {
   static const DxvkShaderKey  g_nullShaderKey = DxvkShaderKey();
 
 
+  /**
+   * \brief Hash function for SHA-1 hashes
+   */
+  struct DxvkSha1HashFn {
+    size_t operator () (const Sha1Hash& hash) const {
+      return hash.dword(0);
+    }
+  };
+
+
+  /**
+   * \brief Orders shader keys
+   *
+   * Only used to sort shader records in the index,
+   * so this only needs to be a consistent order.
+   */
+  static int compareShaderKeys(const DxvkShaderKey& a, const DxvkShaderKey& b) {
+    return std::memcmp(&a, &b, sizeof(DxvkShaderKey));
+  }
+
+
   /**
    * \brief Packed entry header
    */
@@ -94,6 +121,17 @@ namespace dxvk {
       return true;
     }
 
+    bool readFromMemory(const char* data, size_t size) {
+      if (size > MaxSize)
+        return false;
+
+      std::memcpy(m_data, data, size);
+
+      m_size = size;
+      m_read = 0;
+      return true;
+    }
+
   private:
 
     size_t m_size = 0;
@@ -149,6 +187,22 @@ namespace dxvk {
   }
 
 
+  bool DxvkStateCacheEntryRecord::eq(const DxvkStateCacheEntryRecord& other) const {
+    return !std::memcmp(this, &other, sizeof(*this));
+  }
+
+
+  size_t DxvkStateCacheEntryRecord::hash() const {
+    DxvkHashState hash;
+
+    for (uint32_t i = 0; i < 6; i++)
+      hash.add(this->shaders[i]);
+
+    hash.add(this->stateId);
+    return hash;
+  }
+
+
   DxvkStateCache::DxvkStateCache(
           DxvkDevice*           device,
           DxvkPipelineManager*  pipeManager,
@@ -156,34 +210,13 @@ namespace dxvk {
   : m_device      (device),
     m_pipeManager (pipeManager),
     m_passManager (passManager) {
-    bool newFile = !readCacheFile();
-
-    if (newFile) {
-      Logger::warn("DXVK: Creating new state cache file");
-
-      // Start with an empty file
-      std::ofstream file(getCacheFileName().c_str(),
-        std::ios_base::binary |
-        std::ios_base::trunc);
-
-      if (!file && env::createDirectory(getCacheDir())) {
-        file = std::ofstream(getCacheFileName().c_str(),
-          std::ios_base::binary |
-          std::ios_base::trunc);
-      }
-
-      // Write header with the current version number
-      DxvkStateCacheHeader header;
-
-      auto data = reinterpret_cast<const char*>(&header);
-      auto size = sizeof(header);
+    if (!readCacheFile()) {
+      Logger::info("DXVK: Updating state cache file");
 
-      file.write(data, size);
-
-      // Write all valid entries to the cache file in
-      // case we're recovering a corrupted cache file
-      for (auto& e : m_entries)
-        writeCacheEntry(file, e);
+      // Merge all valid entries into a new index. This also
+      // converts files written by older versions and drops
+      // entries from corrupted files.
+      writeCacheFile();
     }
   }
   
@@ -200,6 +233,10 @@ namespace dxvk {
     if (shaders.vs.eq(g_nullShaderKey))
       return;
     
+    WriterItem item = { shaders, state,
+      DxvkComputePipelineStateInfo(),
+      format, g_nullHash };
+
     // Do not add an entry that is already in the cache
     auto entries = m_entryMap.equal_range(shaders);
 
@@ -210,12 +247,13 @@ namespace dxvk {
         return;
     }
 
+    if (hasIndexedEntry(item))
+      return;
+
     // Queue a job to write this pipeline to the cache
     std::unique_lock<dxvk::mutex> lock(m_writerLock);
 
-    m_writerQueue.push({ shaders, state,
-      DxvkComputePipelineStateInfo(),
-      format, g_nullHash });
+    m_writerQueue.push(item);
     m_writerCond.notify_one();
 
     createWriter();
@@ -228,6 +266,10 @@ namespace dxvk {
     if (shaders.cs.eq(g_nullShaderKey))
       return;
 
+    WriterItem item = { shaders,
+      DxvkGraphicsPipelineStateInfo(), state,
+      DxvkRenderPassFormat(), g_nullHash };
+
     // Do not add an entry that is already in the cache
     auto entries = m_entryMap.equal_range(shaders);
 
@@ -236,12 +278,13 @@ namespace dxvk {
         return;
     }
 
+    if (hasIndexedEntry(item))
+      return;
+
     // Queue a job to write this pipeline to the cache
     std::unique_lock<dxvk::mutex> lock(m_writerLock);
 
-    m_writerQueue.push({ shaders,
-      DxvkGraphicsPipelineStateInfo(), state,
-      DxvkRenderPassFormat(), g_nullHash });
+    m_writerQueue.push(item);
     m_writerCond.notify_one();
 
     createWriter();
@@ -258,8 +301,7 @@ namespace dxvk {
     std::unique_lock<dxvk::mutex> entryLock(m_entryLock);
     m_shaderMap.insert({ key, shader });
 
-    // Deferred lock, don't stall workers unless we have to
-    std::unique_lock<dxvk::mutex> workerLock;
+    std::vector<WorkerItem> items;
 
     auto pipelines = m_pipelineMap.equal_range(key);
 
@@ -274,19 +316,65 @@ namespace dxvk {
        || !getShaderByKey(p->second.cs,  item.cp.cs))
         continue;
       
-      if (!workerLock)
-        workerLock = std::unique_lock<dxvk::mutex>(m_workerLock);
-      
-      m_workerQueue.push(item);
+      items.push_back(item);
+    }
+
+    // Indexed entries are decoded by the workers
+    // themselves, we only need to check shaders here
+    uint32_t shaderId = findIndexedShader(key);
+
+    if (shaderId != DxvkStateCacheEntryRecord::NoShader) {
+      const auto& shaderRecord = m_index.shaders[shaderId];
+
+      for (uint32_t i = 0; i < shaderRecord.refCount; i++) {
+        uint32_t entryId = m_index.refs[shaderRecord.refIndex + i];
+        const auto& entryRecord = m_index.entries[entryId];
+
+        WorkerItem item;
+        item.entryId = entryId;
+
+        if (!getIndexedShader(entryRecord.shaders[0], item.gp.vs)
+         || !getIndexedShader(entryRecord.shaders[1], item.gp.tcs)
+         || !getIndexedShader(entryRecord.shaders[2], item.gp.tes)
+         || !getIndexedShader(entryRecord.shaders[3], item.gp.gs)
+         || !getIndexedShader(entryRecord.shaders[4], item.gp.fs)
+         || !getIndexedShader(entryRecord.shaders[5], item.cp.cs))
+          continue;
+
+        items.push_back(item);
+      }
     }
 
-    if (workerLock) {
+    if (!items.empty()) {
+      // Pipelines for the most recently registered shaders are the
+      // most likely ones to be used soon, so queue them in front of
+      // older speculative entries that are still waiting.
+      std::unique_lock<dxvk::mutex> workerLock(m_workerLock);
+      m_workerQueueLow.insert(m_workerQueueLow.begin(), items.begin(), items.end());
       m_workerCond.notify_all();
+
       createWorkers();
     }
   }
 
 
+  void DxvkStateCache::compileInstanceAsync(
+          DxvkGraphicsPipeline*           pipeline,
+          DxvkGraphicsPipelineInstance*   instance) {
+    WorkerItem item;
+    item.gpPipeline = pipeline;
+    item.gpInstance = instance;
+
+    // Pipelines requested by the application are needed right
+    // now, so these take priority over any speculative work
+    std::unique_lock<dxvk::mutex> workerLock(m_workerLock);
+    m_workerQueueHigh.push(item);
+    m_workerCond.notify_all();
+
+    createWorkers();
+  }
+
+
   void DxvkStateCache::stopWorkerThreads() {
     { std::lock_guard<dxvk::mutex> workerLock(m_workerLock);
       std::lock_guard<dxvk::mutex> writerLock(m_writerLock);
@@ -341,7 +429,144 @@ namespace dxvk {
   }
 
 
-  void DxvkStateCache::compilePipelines(const WorkerItem& item) {
+  uint32_t DxvkStateCache::findIndexedShader(
+    const DxvkShaderKey&            key) const {
+    auto begin = m_index.shaders;
+    auto end   = m_index.shaders + m_index.header.shaderCount;
+
+    auto record = std::lower_bound(begin, end, key,
+      [] (const DxvkStateCacheShaderRecord& record, const DxvkShaderKey& key) {
+        return compareShaderKeys(record.key, key) < 0;
+      });
+
+    if (record == end || !record->key.eq(key))
+      return DxvkStateCacheEntryRecord::NoShader;
+
+    return uint32_t(record - begin);
+  }
+
+
+  bool DxvkStateCache::getIndexedShader(
+          uint32_t                  shaderId,
+          Rc<DxvkShader>&           shader) const {
+    if (shaderId == DxvkStateCacheEntryRecord::NoShader)
+      return true;
+
+    return getShaderByKey(m_index.shaders[shaderId].key, shader);
+  }
+
+
+  bool DxvkStateCache::readIndexedEntry(
+          uint32_t                  entryId,
+          DxvkStateCacheEntry&      entry) const {
+    const auto& entryRecord = m_index.entries[entryId];
+    const auto& stateRecord = m_index.states[entryRecord.stateId];
+
+    VkShaderStageFlags stageMask = 0;
+    auto keys = &entry.shaders.vs;
+
+    for (uint32_t i = 0; i < 6; i++) {
+      if (entryRecord.shaders[i] != DxvkStateCacheEntryRecord::NoShader) {
+        stageMask |= VkShaderStageFlagBits(1 << i);
+        keys[i] = m_index.shaders[entryRecord.shaders[i]].key;
+      } else {
+        keys[i] = g_nullShaderKey;
+      }
+    }
+
+    // State data is only verified when it is actually
+    // used, so that loading the index stays cheap
+    DxvkStateCacheEntryData data;
+
+    if (!data.readFromMemory(&m_index.data[stateRecord.dataOffset], stateRecord.dataSize)
+     || data.computeHash() != stateRecord.hash)
+      return false;
+
+    return readCacheState(DxvkStateCacheHeader().version, stageMask, data, entry);
+  }
+
+
+  bool DxvkStateCache::hasIndexedEntry(
+    const DxvkStateCacheEntry&      entry) const {
+    bool isCompute = !entry.shaders.cs.eq(g_nullShaderKey);
+
+    uint32_t shaderId = findIndexedShader(isCompute
+      ? entry.shaders.cs
+      : entry.shaders.vs);
+
+    if (shaderId == DxvkStateCacheEntryRecord::NoShader)
+      return false;
+
+    // State records store the hash of their encoded data,
+    // so we only need to encode and hash the new entry once
+    // rather than decoding every indexed entry for the shader.
+    DxvkStateCacheEntryData data;
+    VkShaderStageFlags stageMask = 0;
+
+    auto keys = &entry.shaders.vs;
+
+    for (uint32_t i = 0; i < 6; i++) {
+      if (!keys[i].eq(g_nullShaderKey))
+        stageMask |= VkShaderStageFlagBits(1 << i);
+    }
+
+    writeCacheState(stageMask, data, entry);
+
+    Sha1Hash hash = data.computeHash();
+
+    const auto& shaderRecord = m_index.shaders[shaderId];
+
+    for (uint32_t i = 0; i < shaderRecord.refCount; i++) {
+      uint32_t entryId = m_index.refs[shaderRecord.refIndex + i];
+      const auto& entryRecord = m_index.entries[entryId];
+
+      if (m_index.states[entryRecord.stateId].hash != hash)
+        continue;
+
+      bool match = true;
+
+      for (uint32_t j = 0; j < 6 && match; j++) {
+        match = entryRecord.shaders[j] != DxvkStateCacheEntryRecord::NoShader
+          ? m_index.shaders[entryRecord.shaders[j]].key.eq(keys[j])
+          : keys[j].eq(g_nullShaderKey);
+      }
+
+      if (match)
+        return true;
+    }
+
+    return false;
+  }
+
+
+  void DxvkStateCache::compilePipelines(
+    const WorkerItem&               item,
+          VkPipelineCache           cache) {
+    if (item.gpInstance != nullptr) {
+      item.gpPipeline->compileInstance(item.gpInstance, cache);
+      return;
+    }
+
+    if (item.entryId != ~0u) {
+      DxvkStateCacheEntry entry;
+
+      if (!readIndexedEntry(item.entryId, entry))
+        return;
+
+      if (item.cp.cs == nullptr) {
+        if (m_passManager->validateRenderPassFormat(entry.format)) {
+          auto pipeline = m_pipeManager->createGraphicsPipeline(item.gp);
+          auto rp = m_passManager->getRenderPass(entry.format);
+          pipeline->compilePipeline(entry.gpState, rp, cache);
+        }
+      } else {
+        auto pipeline = m_pipeManager->createComputePipeline(item.cp);
+        pipeline->compilePipeline(entry.cpState, cache);
+      }
+
+      return;
+    }
+
     DxvkStateCacheKey key;
     key.vs  = getShaderKey(item.gp.vs);
     key.tcs = getShaderKey(item.gp.tcs);
@@ -359,7 +584,7 @@ namespace dxvk {
 
         if (m_passManager->validateRenderPassFormat(entry.format)) {
           auto rp = m_passManager->getRenderPass(entry.format);
-          pipeline->compilePipeline(entry.gpState, rp);
+          pipeline->compilePipeline(entry.gpState, rp, cache);
         }
       }
     } else {
@@ -368,7 +593,7 @@ namespace dxvk {
 
       for (auto e = entries.first; e != entries.second; e++) {
         const auto& entry = m_entries[e->second];
-        pipeline->compilePipeline(entry.cpState);
+        pipeline->compilePipeline(entry.cpState, cache);
       }
     }
   }
@@ -420,15 +645,38 @@ namespace dxvk {
     if (curHeader.version != newHeader.version)
       Logger::warn(str::format("DXVK: Updating state cache version to v", newHeader.version));
 
+    // Map the index so that entries can be decoded on demand.
+    // Any entries after the index were added by previous runs.
+    if (curHeader.version >= 11) {
+      if (!readCacheIndex()) {
+        Logger::warn("DXVK: Failed to read state cache index");
+        return false;
+      }
+
+      ifile.seekg(m_index.size);
+    }
+
     // Read actual cache entries from the file.
     // If we encounter invalid entries, we should
     // regenerate the entire state cache file.
     uint32_t numInvalidEntries = 0;
+    uint32_t numOutdatedEntries = 0;
+
+    // Older versions stored graphics binding masks in the binding
+    // order of a single descriptor set. With split descriptor sets,
+    // bindings are ordered by set, so those masks no longer match.
+    bool dropGraphicsEntries = curHeader.version < 12
+      && m_device->config().splitDescriptorSets;
 
     while (ifile) {
       DxvkStateCacheEntry entry;
 
       if (readCacheEntry(curHeader.version, ifile, entry)) {
+        if (dropGraphicsEntries && entry.shaders.cs.eq(g_nullShaderKey)) {
+          numOutdatedEntries += 1;
+          continue;
+        }
+
         size_t entryId = m_entries.size();
         m_entries.push_back(entry);
 
@@ -446,9 +694,15 @@ namespace dxvk {
     }
 
     Logger::info(str::format(
-      "DXVK: Read ", m_entries.size(),
+      "DXVK: Read ", m_index.header.entryCount + m_entries.size(),
       " valid state cache entries"));
 
+    if (numOutdatedEntries) {
+      Logger::warn(str::format(
+        "DXVK: Dropped ", numOutdatedEntries,
+        " outdated graphics pipeline state cache entries"));
+    }
+
     if (numInvalidEntries) {
       Logger::warn(str::format(
         "DXVK: Skipped ", numInvalidEntries,
@@ -456,8 +710,320 @@ namespace dxvk {
       return false;
     }
     
-    // Rewrite entire state cache if it is outdated
-    return curHeader.version == newHeader.version;
+    // Rewrite entire state cache if it is outdated, or
+    // if there are new entries to merge into the index
+    return curHeader.version == newHeader.version
+        && m_entries.empty();
+  }
+
+
+  bool DxvkStateCache::readCacheIndex() {
+    m_mapping = MappedFile(getCacheFileName());
+    m_index   = DxvkStateCacheIndex();
+
+    DxvkStateCacheHeader expected;
+    DxvkStateCacheHeader header;
+    DxvkStateCacheIndexHeader index;
+
+    size_t offset = sizeof(header) + sizeof(index);
+
+    if (m_mapping.size() < offset)
+      return false;
+
+    std::memcpy(&header, m_mapping.data(), sizeof(header));
+    std::memcpy(&index, m_mapping.data() + sizeof(header), sizeof(index));
+
+    if (std::memcmp(header.magic, expected.magic, sizeof(header.magic))
+     || header.version != expected.version)
+      return false;
+
+    // Use 64-bit sizes so that corrupted
+    // counts cannot cause an overflow
+    uint64_t shaderSize = uint64_t(index.shaderCount) * sizeof(DxvkStateCacheShaderRecord);
+    uint64_t refSize    = uint64_t(index.refCount)    * sizeof(uint32_t);
+    uint64_t entrySize  = uint64_t(index.entryCount)  * sizeof(DxvkStateCacheEntryRecord);
+    uint64_t stateSize  = uint64_t(index.stateCount)  * sizeof(DxvkStateCacheStateRecord);
+
+    if (offset + shaderSize + refSize + entrySize + stateSize + index.stateDataSize > m_mapping.size())
+      return false;
+
+    const char* base = m_mapping.data();
+
+    DxvkStateCacheIndex result;
+    result.header  = index;
+    result.shaders = reinterpret_cast<const DxvkStateCacheShaderRecord*>(&base[offset]);
+    result.refs    = reinterpret_cast<const uint32_t*>(&base[offset += shaderSize]);
+    result.entries = reinterpret_cast<const DxvkStateCacheEntryRecord*>(&base[offset += refSize]);
+    result.states  = reinterpret_cast<const DxvkStateCacheStateRecord*>(&base[offset += entrySize]);
+    result.data    = &base[offset += stateSize];
+    result.size    = offset + index.stateDataSize;
+
+    // Only verify the index itself here, state data is verified
+    // whenever an entry is decoded so that it is not read yet
+    std::array<Sha1Data, 4> chunks = {{
+      { result.shaders, size_t(shaderSize) },
+      { result.refs,    size_t(refSize)    },
+      { result.entries, size_t(entrySize)  },
+      { result.states,  size_t(stateSize)  },
+    }};
+
+    if (Sha1Hash::compute(chunks.size(), chunks.data()) != index.hash)
+      return false;
+
+    // Validate all references so that we can
+    // skip bounds checks when using the index
+    bool valid = true;
+
+    for (uint32_t i = 0; i < index.shaderCount && valid; i++) {
+      valid &= uint64_t(result.shaders[i].refIndex)
+             + uint64_t(result.shaders[i].refCount) <= index.refCount;
+    }
+
+    for (uint32_t i = 0; i < index.refCount && valid; i++)
+      valid &= result.refs[i] < index.entryCount;
+
+    for (uint32_t i = 0; i < index.entryCount && valid; i++) {
+      for (uint32_t j = 0; j < 6; j++) {
+        valid &= result.entries[i].shaders[j] < index.shaderCount
+              || result.entries[i].shaders[j] == DxvkStateCacheEntryRecord::NoShader;
+      }
+
+      valid &= result.entries[i].stateId < index.stateCount;
+    }
+
+    for (uint32_t i = 0; i < index.stateCount && valid; i++) {
+      valid &= uint64_t(result.states[i].dataOffset)
+             + uint64_t(result.states[i].dataSize) <= index.stateDataSize;
+    }
+
+    if (!valid)
+      return false;
+
+    m_index = result;
+    return true;
+  }
+
+
+  bool DxvkStateCache::writeCacheFile() {
+    std::vector<char> data;
+    packCacheFile(data);
+
+    // Write to a temporary file first so that
+    // we never leave a truncated file behind
+    std::wstring fileName = getCacheFileName();
+    std::wstring tmpName  = fileName + L".tmp";
+
+    { std::ofstream file(tmpName.c_str(),
+        std::ios_base::binary |
+        std::ios_base::trunc);
+
+      if (!file && env::createDirectory(getCacheDir())) {
+        file = std::ofstream(tmpName.c_str(),
+          std::ios_base::binary |
+          std::ios_base::trunc);
+      }
+
+      file.write(data.data(), data.size());
+      file.flush();
+
+      if (!file) {
+        Logger::warn("DXVK: Failed to write state cache file");
+        return false;
+      }
+    }
+
+    // The old file cannot be replaced while it is mapped
+    m_mapping = MappedFile();
+    m_index   = DxvkStateCacheIndex();
+
+#ifdef _WIN32
+    bool renamed = ::MoveFileExW(tmpName.c_str(), fileName.c_str(),
+      MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+    bool renamed = !std::rename(str::fromws(tmpName.c_str()).c_str(),
+      str::fromws(fileName.c_str()).c_str());
+#endif
+
+    if (!renamed)
+      Logger::warn("DXVK: Failed to replace state cache file");
+
+    // Map the new file, or the old one if replacing it failed.
+    // Entries read from the end of the file have to be kept
+    // in memory unless they are part of the mapped index.
+    bool indexed = readCacheIndex();
+
+    if (!renamed || !indexed)
+      return false;
+
+    m_entries.clear();
+    m_entryMap.clear();
+    m_pipelineMap.clear();
+    return true;
+  }
+
+
+  void DxvkStateCache::packCacheFile(
+          std::vector<char>&        file) const {
+    std::vector<DxvkShaderKey> shaderKeys;
+    std::unordered_map<DxvkShaderKey, uint32_t, DxvkHash, DxvkEq> shaderIds;
+
+    std::vector<DxvkStateCacheStateRecord> states;
+    std::vector<char> stateData;
+    std::unordered_map<Sha1Hash, uint32_t, DxvkSha1HashFn> stateIds;
+
+    std::vector<DxvkStateCacheEntryRecord> entries;
+    std::unordered_set<DxvkStateCacheEntryRecord, DxvkHash, DxvkEq> entrySet;
+
+    auto addShader = [&] (const DxvkShaderKey& key) {
+      auto result = shaderIds.insert({ key, uint32_t(shaderKeys.size()) });
+
+      if (result.second)
+        shaderKeys.push_back(key);
+
+      return result.first->second;
+    };
+
+    auto addState = [&] (const char* data, uint32_t size, const Sha1Hash& hash) {
+      auto result = stateIds.insert({ hash, uint32_t(states.size()) });
+
+      if (result.second) {
+        DxvkStateCacheStateRecord record;
+        record.dataOffset = uint32_t(stateData.size());
+        record.dataSize   = size;
+        record.hash       = hash;
+
+        states.push_back(record);
+        stateData.insert(stateData.end(), data, data + size);
+      }
+
+      return result.first->second;
+    };
+
+    auto addEntry = [&] (const DxvkStateCacheEntryRecord& entry) {
+      if (entrySet.insert(entry).second)
+        entries.push_back(entry);
+    };
+
+    // Carry over indexed entries without decoding them
+    for (uint32_t i = 0; i < m_index.header.entryCount; i++) {
+      const auto& src = m_index.entries[i];
+      const auto& state = m_index.states[src.stateId];
+
+      DxvkStateCacheEntryRecord dst;
+
+      for (uint32_t j = 0; j < 6; j++) {
+        dst.shaders[j] = src.shaders[j] != DxvkStateCacheEntryRecord::NoShader
+          ? addShader(m_index.shaders[src.shaders[j]].key)
+          : DxvkStateCacheEntryRecord::NoShader;
+      }
+
+      dst.stateId = addState(&m_index.data[state.dataOffset], state.dataSize, state.hash);
+      addEntry(dst);
+    }
+
+    // Encode entries that were read from the end of the file,
+    // or from a file that was written by an older version
+    for (const auto& entry : m_entries) {
+      DxvkStateCacheEntryData data;
+      DxvkStateCacheEntryRecord dst;
+
+      VkShaderStageFlags stageMask = 0;
+      auto keys = &entry.shaders.vs;
+
+      for (uint32_t j = 0; j < 6; j++) {
+        if (!keys[j].eq(g_nullShaderKey)) {
+          stageMask |= VkShaderStageFlagBits(1 << j);
+          dst.shaders[j] = addShader(keys[j]);
+        } else {
+          dst.shaders[j] = DxvkStateCacheEntryRecord::NoShader;
+        }
+      }
+
+      writeCacheState(stageMask, data, entry);
+
+      dst.stateId = addState(data.data(), data.size(), data.computeHash());
+      addEntry(dst);
+    }
+
+    // Sort shader records so that they can be found with a binary search
+    std::vector<uint32_t> order(shaderKeys.size());
+    std::iota(order.begin(), order.end(), 0u);
+
+    std::sort(order.begin(), order.end(), [&shaderKeys] (uint32_t a, uint32_t b) {
+      return compareShaderKeys(shaderKeys[a], shaderKeys[b]) < 0;
+    });
+
+    std::vector<uint32_t> remap(shaderKeys.size());
+    std::vector<DxvkStateCacheShaderRecord> shaders(shaderKeys.size());
+
+    for (uint32_t i = 0; i < order.size(); i++) {
+      remap[order[i]] = i;
+
+      shaders[i].key      = shaderKeys[order[i]];
+      shaders[i].refIndex = 0;
+      shaders[i].refCount = 0;
+    }
+
+    for (auto& entry : entries) {
+      for (uint32_t j = 0; j < 6; j++) {
+        if (entry.shaders[j] != DxvkStateCacheEntryRecord::NoShader) {
+          entry.shaders[j] = remap[entry.shaders[j]];
+          shaders[entry.shaders[j]].refCount += 1;
+        }
+      }
+    }
+
+    // Store the IDs of all entries that use a given shader
+    uint32_t refCount = 0;
+
+    for (auto& shader : shaders) {
+      shader.refIndex = refCount;
+      refCount += shader.refCount;
+    }
+
+    std::vector<uint32_t> refs(refCount);
+    std::vector<uint32_t> refsWritten(shaders.size(), 0u);
+
+    for (uint32_t i = 0; i < entries.size(); i++) {
+      for (uint32_t j = 0; j < 6; j++) {
+        uint32_t shaderId = entries[i].shaders[j];
+
+        if (shaderId != DxvkStateCacheEntryRecord::NoShader)
+          refs[shaders[shaderId].refIndex + refsWritten[shaderId]++] = i;
+      }
+    }
+
+    DxvkStateCacheHeader header;
+    DxvkStateCacheIndexHeader index;
+    index.shaderCount   = uint32_t(shaders.size());
+    index.refCount      = uint32_t(refs.size());
+    index.entryCount    = uint32_t(entries.size());
+    index.stateCount    = uint32_t(states.size());
+    index.stateDataSize = uint32_t(stateData.size());
+
+    std::array<Sha1Data, 4> chunks = {{
+      { shaders.data(), shaders.size() * sizeof(DxvkStateCacheShaderRecord) },
+      { refs.data(),    refs.size()    * sizeof(uint32_t)                   },
+      { entries.data(), entries.size() * sizeof(DxvkStateCacheEntryRecord)  },
+      { states.data(),  states.size()  * sizeof(DxvkStateCacheStateRecord)  },
+    }};
+
+    index.hash = Sha1Hash::compute(chunks.size(), chunks.data());
+
+    file.clear();
+    file.insert(file.end(),
+      reinterpret_cast<const char*>(&header),
+      reinterpret_cast<const char*>(&header + 1));
+    file.insert(file.end(),
+      reinterpret_cast<const char*>(&index),
+      reinterpret_cast<const char*>(&index + 1));
+
+    for (const auto& chunk : chunks) {
+      auto data = reinterpret_cast<const char*>(chunk.data);
+      file.insert(file.end(), data, data + chunk.size);
+    }
+
+    file.insert(file.end(), stateData.begin(), stateData.end());
   }
 
 
@@ -551,6 +1117,15 @@ namespace dxvk {
         keys[i] = g_nullShaderKey;
     }
 
+    return readCacheState(version, stageMask, data, entry);
+  }
+
+
+  bool DxvkStateCache::readCacheState(
+          uint32_t                  version,
+          VkShaderStageFlags        stageMask,
+          DxvkStateCacheEntryData&  data,
+          DxvkStateCacheEntry&      entry) const {
     if (stageMask & VK_SHADER_STAGE_COMPUTE_BIT) {
       if (!data.read(entry.cpState.bsBindingMask, version))
         return false;
@@ -659,6 +1234,26 @@ namespace dxvk {
       }
     }
 
+    writeCacheState(stageMask, data, entry);
+
+    // General layout: header -> hash -> data
+    DxvkStateCacheEntryHeader header;
+    header.stageMask = uint8_t(stageMask);
+    header.entrySize = data.size();
+
+    Sha1Hash hash = data.computeHash();
+
+    stream.write(reinterpret_cast<char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<char*>(&hash), sizeof(hash));
+    stream.write(data.data(), data.size());
+    stream.flush();
+  }
+
+
+  void DxvkStateCache::writeCacheState(
+          VkShaderStageFlags        stageMask,
+          DxvkStateCacheEntryData&  data,
+    const DxvkStateCacheEntry&      entry) const {
     if (stageMask & VK_SHADER_STAGE_COMPUTE_BIT) {
       // Nothing else here to write out
       data.write(entry.cpState.bsBindingMask);
@@ -715,18 +1310,6 @@ namespace dxvk {
       if (specConstantMask & (1 << i))
         data.write(sc.specConstants[i]);
     }
-
-    // General layout: header -> hash -> data
-    DxvkStateCacheEntryHeader header;
-    header.stageMask = uint8_t(stageMask);
-    header.entrySize = data.size();
-
-    Sha1Hash hash = data.computeHash();
-
-    stream.write(reinterpret_cast<char*>(&header), sizeof(header));
-    stream.write(reinterpret_cast<char*>(&hash), sizeof(hash));
-    stream.write(data.data(), data.size());
-    stream.flush();
   }
 
 
@@ -909,33 +1492,115 @@ namespace dxvk {
   }
 
 
-  void DxvkStateCache::workerFunc() {
+  bool DxvkStateCache::hasWorkerItems(
+          uint32_t                  workerId) const {
+    // Workers beyond the current limit only
+    // help out with high-priority pipelines
+    return !m_workerQueueHigh.empty()
+        || (!m_workerQueueLow.empty() && workerId < m_workerLimit.load());
+  }
+
+
+  void DxvkStateCache::updateWorkerLimit() {
+#ifdef _WIN32
+    auto now = dxvk::high_resolution_clock::now();
+
+    if (now - m_loadTime < std::chrono::milliseconds(500))
+      return;
+
+    FILETIME idleTime, kernelTime, userTime;
+
+    if (!::GetSystemTimes(&idleTime, &kernelTime, &userTime))
+      return;
+
+    auto toTicks = [] (const FILETIME& ft) {
+      return uint64_t(ft.dwLowDateTime) | (uint64_t(ft.dwHighDateTime) << 32);
+    };
+
+    // Kernel time includes idle time
+    uint64_t idleTicks  = toTicks(idleTime);
+    uint64_t totalTicks = toTicks(kernelTime) + toTicks(userTime);
+
+    uint64_t idleDelta  = idleTicks  - std::exchange(m_loadIdleTicks,  idleTicks);
+    uint64_t totalDelta = totalTicks - std::exchange(m_loadTotalTicks, totalTicks);
+
+    if (std::exchange(m_loadTime, now) == dxvk::high_resolution_clock::time_point() || !totalDelta)
+      return;
+
+    // Back off if the CPU is saturated so that speculative compiles
+    // do not starve the application's own threads, and ramp back
+    // up once there is headroom again.
+    uint32_t load  = uint32_t((100 * (totalDelta - std::min(idleDelta, totalDelta))) / totalDelta);
+    uint32_t limit = m_workerLimit.load();
+
+    if (load > 90 && limit > 1) {
+      m_workerLimit.store(limit - 1);
+    } else if (load < 75 && limit < m_workerCount) {
+      std::lock_guard<dxvk::mutex> lock(m_workerLock);
+      m_workerLimit.store(limit + 1);
+      m_workerCond.notify_all();
+    }
+#endif
+  }
+
+
+  void DxvkStateCache::workerFunc(
+          uint32_t                  workerId) {
     env::setThreadName("dxvk-shader");
 
+    // Compile against the main pipeline cache, which holds the
+    // data loaded from disk. Pipeline creation is internally
+    // synchronized, so workers can share the cache safely.
+    VkPipelineCache pipeCache = m_pipeManager->m_cache->handle();
+
+    bool highPriority = false;
+
     while (!m_stopThreads.load()) {
       WorkerItem item;
+      bool isHighPriority = false;
 
       { std::unique_lock<dxvk::mutex> lock(m_workerLock);
 
-        if (m_workerQueue.empty()) {
+        if (!hasWorkerItems(workerId)) {
           m_workerBusy -= 1;
-          m_workerCond.wait(lock, [this] () {
-            return m_workerQueue.size()
+          m_workerCond.wait(lock, [this, workerId] () {
+            return hasWorkerItems(workerId)
                 || m_stopThreads.load();
           });
 
-          if (!m_workerQueue.empty())
+          if (hasWorkerItems(workerId))
             m_workerBusy += 1;
         }
 
-        if (m_workerQueue.empty())
+        if (!hasWorkerItems(workerId))
           break;
         
-        item = m_workerQueue.front();
-        m_workerQueue.pop();
+        isHighPriority = !m_workerQueueHigh.empty();
+
+        if (isHighPriority) {
+          item = m_workerQueueHigh.front();
+          m_workerQueueHigh.pop();
+        } else {
+          item = m_workerQueueLow.front();
+          m_workerQueueLow.pop_front();
+        }
       }
 
-      compilePipelines(item);
+      // Run application-requested pipelines at normal priority
+      // so that they finish as quickly as possible, but drain
+      // speculative work at the lowest priority.
+      if (highPriority != isHighPriority) {
+        highPriority = isHighPriority;
+
+        this_thread::set_priority(highPriority
+          ? ThreadPriority::Normal
+          : ThreadPriority::Lowest);
+      }
+
+      compilePipelines(item, pipeCache);
+
+      if (!workerId && m_device->config().numCompilerThreads <= 0)
+        updateWorkerLimit();
     }
   }
 
@@ -989,9 +1654,11 @@ namespace dxvk {
 
       // Start the worker threads and the file writer
       m_workerBusy.store(numWorkers);
+      m_workerLimit.store(numWorkers);
+      m_workerCount = numWorkers;
 
       for (uint32_t i = 0; i < numWorkers; i++) {
-        m_workerThreads.emplace_back([this] () { workerFunc(); });
+        m_workerThreads.emplace_back([this, i] () { workerFunc(i); });
         m_workerThreads[i].set_priority(ThreadPriority::Lowest);
       }
     }
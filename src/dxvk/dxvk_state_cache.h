@@ -2,6 +2,7 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <fstream>
 #include <mutex>
 #include <queue>
@@ -10,9 +11,13 @@
 
 #include "dxvk_state_cache_types.h"
 
+#include "../util/util_mapped_file.h"
+#include "../util/util_time.h"
+
 namespace dxvk {
 
   class DxvkDevice;
+  class DxvkStateCacheEntryData;
 
   /**
    * \brief State cache
@@ -71,6 +76,19 @@ namespace dxvk {
     void registerShader(
       const Rc<DxvkShader>&                 shader);
 
+    /**
+     * \brief Compiles a pipeline instance asynchronously
+     *
+     * Queues a pipeline instance that was created
+     * without a pipeline handle for compilation
+     * on the worker threads.
+     * \param [in] pipeline The graphics pipeline
+     * \param [in] instance The pending instance
+     */
+    void compileInstanceAsync(
+            DxvkGraphicsPipeline*           pipeline,
+            DxvkGraphicsPipelineInstance*   instance);
+
     /**
      * \brief Explicitly stops worker threads
      */
@@ -89,14 +107,20 @@ namespace dxvk {
     using WriterItem = DxvkStateCacheEntry;
 
     struct WorkerItem {
-      DxvkGraphicsPipelineShaders gp;
-      DxvkComputePipelineShaders  cp;
+      DxvkGraphicsPipelineShaders   gp;
+      DxvkComputePipelineShaders    cp;
+      DxvkGraphicsPipeline*         gpPipeline = nullptr;
+      DxvkGraphicsPipelineInstance* gpInstance = nullptr;
+      uint32_t                      entryId    = ~0u;
     };
 
     DxvkDevice*                       m_device;
     DxvkPipelineManager*              m_pipeManager;
     DxvkRenderPassPool*               m_passManager;
 
+    MappedFile                        m_mapping;
+    DxvkStateCacheIndex               m_index;
+
     std::vector<DxvkStateCacheEntry>  m_entries;
     std::atomic<bool>                 m_stopThreads = { false };
 
@@ -116,10 +140,17 @@ namespace dxvk {
 
     dxvk::mutex                       m_workerLock;
     dxvk::condition_variable          m_workerCond;
-    std::queue<WorkerItem>            m_workerQueue;
+    std::queue<WorkerItem>            m_workerQueueHigh;
+    std::deque<WorkerItem>            m_workerQueueLow;
     std::atomic<uint32_t>             m_workerBusy;
+    std::atomic<uint32_t>             m_workerLimit = { 0u };
+    uint32_t                          m_workerCount = 0u;
     std::vector<dxvk::thread>         m_workerThreads;
 
+    dxvk::high_resolution_clock::time_point m_loadTime;
+    uint64_t                          m_loadIdleTicks   = 0ull;
+    uint64_t                          m_loadTotalTicks  = 0ull;
+
     dxvk::mutex                       m_writerLock;
     dxvk::condition_variable          m_writerCond;
     std::queue<WriterItem>            m_writerQueue;
@@ -140,11 +171,33 @@ namespace dxvk {
       const DxvkShaderKey&            shader,
       const DxvkStateCacheKey&        key);
 
+    uint32_t findIndexedShader(
+      const DxvkShaderKey&            key) const;
+
+    bool getIndexedShader(
+            uint32_t                  shaderId,
+            Rc<DxvkShader>&           shader) const;
+
+    bool readIndexedEntry(
+            uint32_t                  entryId,
+            DxvkStateCacheEntry&      entry) const;
+
+    bool hasIndexedEntry(
+      const DxvkStateCacheEntry&      entry) const;
+
     void compilePipelines(
-      const WorkerItem&               item);
+      const WorkerItem&               item,
+            VkPipelineCache           cache);
 
     bool readCacheFile();
 
+    bool readCacheIndex();
+
+    bool writeCacheFile();
+
+    void packCacheFile(
+            std::vector<char>&        file) const;
+
     bool readCacheHeader(
             std::istream&             stream,
             DxvkStateCacheHeader&     header) const;
@@ -162,6 +215,17 @@ namespace dxvk {
     void writeCacheEntry(
             std::ostream&             stream, 
             DxvkStateCacheEntry&      entry) const;
+
+    bool readCacheState(
+            uint32_t                  version,
+            VkShaderStageFlags        stageMask,
+            DxvkStateCacheEntryData&  data,
+            DxvkStateCacheEntry&      entry) const;
+
+    void writeCacheState(
+            VkShaderStageFlags        stageMask,
+            DxvkStateCacheEntryData&  data,
+      const DxvkStateCacheEntry&      entry) const;
     
     bool convertEntryV2(
             DxvkStateCacheEntryV4&    entry) const;
@@ -178,7 +242,13 @@ namespace dxvk {
       const DxvkStateCacheEntryV6&    in,
             DxvkStateCacheEntry&      out) const;
     
-    void workerFunc();
+    bool hasWorkerItems(
+            uint32_t                  workerId) const;
+
+    void updateWorkerLimit();
+
+    void workerFunc(
+            uint32_t                  workerId);
 
     void writerFunc();
 
@@ -52,13 +52,112 @@ namespace dxvk {
    */
   struct DxvkStateCacheHeader {
     char     magic[4]   = { 'D', 'X', 'V', 'K' };
-    uint32_t version    = 10;
+    uint32_t version    = 12;
     uint32_t entrySize  = 0; /* no longer meaningful */
   };
 
   static_assert(sizeof(DxvkStateCacheHeader) == 12);
 
 
+  /**
+   * \brief State cache index header
+   *
+   * Since version 11, the file header is followed by
+   * an index that can be used directly from a memory
+   * mapping. The layout of the index is:
+   *  - Shader records, sorted by shader key
+   *  - Entry IDs referenced by each shader record
+   *  - Entry records
+   *  - State records
+   *  - Encoded pipeline state data
+   *
+   * Pipeline states are deduplicated, so that entries
+   * which only differ in their shaders share the same
+   * state data. Entries that were added after the index
+   * was written are appended to the end of the file in
+   * the regular entry format, and will be merged into
+   * the index on the next run.
+   */
+  struct DxvkStateCacheIndexHeader {
+    uint32_t shaderCount    = 0;
+    uint32_t refCount       = 0;
+    uint32_t entryCount     = 0;
+    uint32_t stateCount     = 0;
+    uint32_t stateDataSize  = 0;
+    Sha1Hash hash;
+  };
+
+  static_assert(sizeof(DxvkStateCacheIndexHeader) == 40);
+
+
+  /**
+   * \brief State cache shader record
+   *
+   * Stores a shader key as well as the range
+   * of entries that use the shader.
+   */
+  struct DxvkStateCacheShaderRecord {
+    DxvkShaderKey key;
+    uint32_t      refIndex;
+    uint32_t      refCount;
+  };
+
+  static_assert(sizeof(DxvkStateCacheShaderRecord) == 32);
+
+
+  /**
+   * \brief State cache entry record
+   *
+   * Stores the index of the shader record for
+   * each shader stage, as well as the index of
+   * the pipeline state record.
+   */
+  struct DxvkStateCacheEntryRecord {
+    constexpr static uint32_t NoShader = ~0u;
+
+    uint32_t shaders[6];
+    uint32_t stateId;
+
+    bool eq(const DxvkStateCacheEntryRecord& other) const;
+
+    size_t hash() const;
+  };
+
+  static_assert(sizeof(DxvkStateCacheEntryRecord) == 28);
+
+
+  /**
+   * \brief State cache state record
+   *
+   * Points to encoded pipeline state data. The hash
+   * is used to verify the data when it is decoded.
+   */
+  struct DxvkStateCacheStateRecord {
+    uint32_t dataOffset;
+    uint32_t dataSize;
+    Sha1Hash hash;
+  };
+
+  static_assert(sizeof(DxvkStateCacheStateRecord) == 28);
+
+
+  /**
+   * \brief State cache index
+   *
+   * Points into the memory-mapped index
+   * of the state cache file.
+   */
+  struct DxvkStateCacheIndex {
+    DxvkStateCacheIndexHeader         header;
+    const DxvkStateCacheShaderRecord* shaders = nullptr;
+    const uint32_t*                   refs    = nullptr;
+    const DxvkStateCacheEntryRecord*  entries = nullptr;
+    const DxvkStateCacheStateRecord*  states  = nullptr;
+    const char*                       data    = nullptr;
+    size_t                            size    = 0;
+  };
+
+
   class DxvkBindingMaskV8 : DxvkBindingSet<128> {
 
   public:
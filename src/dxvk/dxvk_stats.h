@@ -15,6 +15,13 @@ namespace dxvk {
     CmdDispatchCalls,         ///< Number of compute calls
     CmdRenderPassCount,       ///< Number of render passes
     CmdBarrierCount,          ///< Number of pipeline barriers
+    CmdSkippedDrawCalls,      ///< Draws skipped due to pending pipelines
+    DescriptorSetAllocated,   ///< Newly written descriptor sets
+    DescriptorSetReused,      ///< Descriptor sets reused from cache
+    DescriptorPoolCount,      ///< Number of descriptor pools
+    DescriptorPoolExhausted,  ///< Descriptor pools that ran full
+    FramebufferCacheHits,     ///< Framebuffers found in context cache
+    FramebufferCacheMisses,   ///< Framebuffers created on cache miss
     PipeCountGraphics,        ///< Number of graphics pipelines
     PipeCountCompute,         ///< Number of compute pipelines
     PipeCompilerBusy,         ///< Boolean indicating compiler activity
@@ -370,7 +370,7 @@ namespace dxvk::hud {
 
 
   HudDrawCallStatsItem::HudDrawCallStatsItem(const Rc<DxvkDevice>& device)
-  : m_device(device) {
+  : m_device(device), m_showSkipped(device->config().enableAsync) {
 
   }
 
@@ -391,6 +391,13 @@ namespace dxvk::hud {
       m_cpCount = diffCounters.getCtr(DxvkStatCounter::CmdDispatchCalls);
       m_rpCount = diffCounters.getCtr(DxvkStatCounter::CmdRenderPassCount);
       m_pbCount = diffCounters.getCtr(DxvkStatCounter::CmdBarrierCount);
+      m_skCount = diffCounters.getCtr(DxvkStatCounter::CmdSkippedDrawCalls);
+      m_dsCount = diffCounters.getCtr(DxvkStatCounter::DescriptorSetAllocated);
+      m_drCount = diffCounters.getCtr(DxvkStatCounter::DescriptorSetReused);
+      m_dpCount = counters.getCtr(DxvkStatCounter::DescriptorPoolCount);
+      m_dxCount = diffCounters.getCtr(DxvkStatCounter::DescriptorPoolExhausted);
+      m_fhCount = diffCounters.getCtr(DxvkStatCounter::FramebufferCacheHits);
+      m_fmCount = diffCounters.getCtr(DxvkStatCounter::FramebufferCacheMisses);
 
       m_lastUpdate = time;
     }
@@ -446,6 +453,58 @@ namespace dxvk::hud {
       { 1.0f, 1.0f, 1.0f, 1.0f },
       str::format(m_pbCount));
 
+    uint64_t dsTotal = m_dsCount + m_drCount;
+    uint64_t dsReuse = dsTotal ? (100 * m_drCount) / dsTotal : 0;
+
+    position.y += 20.0f;
+    renderer.drawText(16.0f,
+      { position.x, position.y },
+      { 0.25f, 0.5f, 1.0f, 1.0f },
+      "Descriptor sets:");
+
+    renderer.drawText(16.0f,
+      { position.x + 192.0f, position.y },
+      { 1.0f, 1.0f, 1.0f, 1.0f },
+      str::format(m_dsCount, " (", dsReuse, "% reused)"));
+
+    position.y += 20.0f;
+    renderer.drawText(16.0f,
+      { position.x, position.y },
+      { 0.25f, 0.5f, 1.0f, 1.0f },
+      "Descriptor pools:");
+
+    renderer.drawText(16.0f,
+      { position.x + 192.0f, position.y },
+      { 1.0f, 1.0f, 1.0f, 1.0f },
+      str::format(m_dpCount, " (", m_dxCount, " full)"));
+
+    uint64_t fbTotal = m_fhCount + m_fmCount;
+    uint64_t fbHits  = fbTotal ? (100 * m_fhCount) / fbTotal : 0;
+
+    position.y += 20.0f;
+    renderer.drawText(16.0f,
+      { position.x, position.y },
+      { 0.25f, 0.5f, 1.0f, 1.0f },
+      "Framebuffers:");
+
+    renderer.drawText(16.0f,
+      { position.x + 192.0f, position.y },
+      { 1.0f, 1.0f, 1.0f, 1.0f },
+      str::format(m_fmCount, " created (", fbHits, "% cached)"));
+
+    if (m_showSkipped) {
+      position.y += 20.0f;
+      renderer.drawText(16.0f,
+        { position.x, position.y },
+        { 0.25f, 0.5f, 1.0f, 1.0f },
+        "Skipped draws:");
+
+      renderer.drawText(16.0f,
+        { position.x + 192.0f, position.y },
+        { 1.0f, 1.0f, 1.0f, 1.0f },
+        str::format(m_skCount));
+    }
+
     position.y += 8.0f;
     return position;
   }
@@ -525,11 +584,13 @@ namespace dxvk::hud {
 
       uint64_t memUsedMib = m_heaps[i].memoryUsed >> 20;
       uint64_t memAllocatedMib = m_heaps[i].memoryAllocated >> 20;
+      uint64_t memFragmentedMib = m_heaps[i].memoryFragmented >> 20;
       uint64_t percentage = (100 * m_heaps[i].memoryAllocated) / m_memory.memoryHeaps[i].size;
 
       std::string label = str::format(isDeviceLocal ? "Vidmem" : "Sysmem", " heap ", i, ": ");
       std::string text  = str::format(std::setfill(' '), std::setw(5), memAllocatedMib, " MB (", percentage, "%) ",
-        std::setw(5 + (percentage < 10 ? 1 : 0) + (percentage < 100 ? 1 : 0)), memUsedMib, " MB used");
+        std::setw(5 + (percentage < 10 ? 1 : 0) + (percentage < 100 ? 1 : 0)), memUsedMib, " MB used ",
+        std::setw(5), memFragmentedMib, " MB fragmented");
 
       position.y += 16.0f;
       renderer.drawText(16.0f,
@@ -302,6 +302,15 @@ namespace dxvk::hud {
     uint64_t          m_cpCount = 0;
     uint64_t          m_rpCount = 0;
     uint64_t          m_pbCount = 0;
+    uint64_t          m_skCount = 0;
+    uint64_t          m_dsCount = 0;
+    uint64_t          m_drCount = 0;
+    uint64_t          m_dpCount = 0;
+    uint64_t          m_dxCount = 0;
+    uint64_t          m_fhCount = 0;
+    uint64_t          m_fmCount = 0;
+
+    bool              m_showSkipped = false;
 
     dxvk::high_resolution_clock::time_point m_lastUpdate
       = dxvk::high_resolution_clock::now();
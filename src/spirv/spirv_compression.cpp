@@ -80,6 +80,14 @@ namespace dxvk {
       m_code.shrink_to_fit();
   }
 
+
+  SpirvCompressedBuffer::SpirvCompressedBuffer(
+          size_t                  size,
+          std::vector<uint32_t>&& code)
+  : m_size(size), m_code(std::move(code)) {
+
+  }
+
     
   SpirvCompressedBuffer::~SpirvCompressedBuffer() {
 
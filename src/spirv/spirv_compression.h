@@ -19,11 +19,45 @@ namespace dxvk {
     SpirvCompressedBuffer();
 
     SpirvCompressedBuffer(SpirvCodeBuffer& code);
+
+    /**
+     * \brief Restores previously compressed code
+     *
+     * \param [in] size Decompressed size, in dwords
+     * \param [in] code Compressed code
+     */
+    SpirvCompressedBuffer(
+            size_t                  size,
+            std::vector<uint32_t>&& code);
     
     ~SpirvCompressedBuffer();
     
     SpirvCodeBuffer decompress() const;
 
+    /**
+     * \brief Compressed code size
+     * \returns Code size, in bytes
+     */
+    size_t size() const {
+      return m_code.size() * sizeof(uint32_t);
+    }
+
+    /**
+     * \brief Compressed code
+     * \returns Pointer to compressed code
+     */
+    const uint32_t* data() const {
+      return m_code.data();
+    }
+
+    /**
+     * \brief Decompressed code size
+     * \returns Code size, in dwords
+     */
+    size_t decompressedDwords() const {
+      return m_size;
+    }
+
   private:
 
     size_t                m_size;
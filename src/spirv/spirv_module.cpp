@@ -513,9 +513,12 @@ namespace dxvk {
       ? spv::OpSpecConstantTrue
       : spv::OpSpecConstantFalse;
     
+    size_t offset = m_typeConstDefs.dwords();
     m_typeConstDefs.putIns  (op, 3);
     m_typeConstDefs.putWord (typeId);
     m_typeConstDefs.putWord (resultId);
+
+    this->indexTypeConst(offset, 2);
     return resultId;
   }
     
@@ -525,10 +528,13 @@ namespace dxvk {
           uint32_t                value) {
     uint32_t resultId = this->allocateId();
     
+    size_t offset = m_typeConstDefs.dwords();
     m_typeConstDefs.putIns  (spv::OpSpecConstant, 4);
     m_typeConstDefs.putWord (typeId);
     m_typeConstDefs.putWord (resultId);
     m_typeConstDefs.putWord (value);
+
+    this->indexTypeConst(offset, 2);
     return resultId;
   }
   
@@ -768,10 +774,13 @@ namespace dxvk {
           uint32_t                length) {
     uint32_t resultId = this->allocateId();
     
+    size_t offset = m_typeConstDefs.dwords();
     m_typeConstDefs.putIns (spv::OpTypeArray, 4);
     m_typeConstDefs.putWord(resultId);
     m_typeConstDefs.putWord(typeId);
     m_typeConstDefs.putWord(length);
+
+    this->indexTypeConst(offset, 1);
     return resultId;
   }
   
@@ -789,9 +798,12 @@ namespace dxvk {
           uint32_t                typeId) {
     uint32_t resultId = this->allocateId();
     
+    size_t offset = m_typeConstDefs.dwords();
     m_typeConstDefs.putIns (spv::OpTypeRuntimeArray, 3);
     m_typeConstDefs.putWord(resultId);
     m_typeConstDefs.putWord(typeId);
+
+    this->indexTypeConst(offset, 1);
     return resultId;
   }
   
@@ -824,11 +836,14 @@ namespace dxvk {
     const uint32_t*               memberTypes) {
     uint32_t resultId = this->allocateId();
     
+    size_t offset = m_typeConstDefs.dwords();
     m_typeConstDefs.putIns (spv::OpTypeStruct, 2 + memberCount);
     m_typeConstDefs.putWord(resultId);
     
     for (uint32_t i = 0; i < memberCount; i++)
       m_typeConstDefs.putWord(memberTypes[i]);
+
+    this->indexTypeConst(offset, 1);
     return resultId;
   }
   
@@ -3619,27 +3634,27 @@ namespace dxvk {
           spv::Op                 op, 
           uint32_t                argCount,
     const uint32_t*               argIds) {
-    // Since the type info is stored in the code buffer,
-    // we can use the code buffer to look up type IDs as
-    // well. Result IDs are always stored as argument 1.
-    for (auto ins : m_typeConstDefs) {
-      bool match = ins.opCode() == op
-                && ins.length() == 2 + argCount;
-      
-      for (uint32_t i = 0; i < argCount && match; i++)
-        match &= ins.arg(2 + i) == argIds[i];
-      
-      if (match)
-        return ins.arg(1);
-    }
+    // Result IDs of types are always stored as argument 1,
+    // leave it empty until we know that we need a new type
+    small_vector<uint32_t, 16> words;
+    words.resize(2 + argCount);
+    words[0] = uint32_t(op) | ((2 + argCount) << spv::WordCountShift);
+    words[1] = 0;
+
+    for (uint32_t i = 0; i < argCount; i++)
+      words[2 + i] = argIds[i];
+
+    size_t hash = hashTypeConst(words.size(), words.data(), 1);
+    uint32_t resultId = this->findTypeConst(words.size(), words.data(), 1, hash);
+
+    if (resultId)
+      return resultId;
     
     // Type not yet declared, create a new one.
-    uint32_t resultId = this->allocateId();
-    m_typeConstDefs.putIns (op, 2 + argCount);
-    m_typeConstDefs.putWord(resultId);
-    
-    for (uint32_t i = 0; i < argCount; i++)
-      m_typeConstDefs.putWord(argIds[i]);
+    resultId = this->allocateId();
+    words[1] = resultId;
+
+    this->addTypeConst(words.size(), words.data(), hash);
     return resultId;
   }
   
@@ -3649,34 +3664,100 @@ namespace dxvk {
           uint32_t                typeId,
           uint32_t                argCount,
     const uint32_t*               argIds) {
-    // Avoid declaring constants multiple times
-    for (auto ins : m_typeConstDefs) {
-      bool match = ins.opCode() == op
-                && ins.length() == 3 + argCount
-                && ins.arg(1)   == typeId;
-      
-      for (uint32_t i = 0; i < argCount && match; i++)
-        match &= ins.arg(3 + i) == argIds[i];
-      
-      if (!match)
-        continue;
-      
-      uint32_t id = ins.arg(2);
+    // Result IDs of constants are stored as argument 2. Late
+    // constants are never indexed since their value may still
+    // change, so they will never be returned here.
+    small_vector<uint32_t, 16> words;
+    words.resize(3 + argCount);
+    words[0] = uint32_t(op) | ((3 + argCount) << spv::WordCountShift);
+    words[1] = typeId;
+    words[2] = 0;
 
-      if (m_lateConsts.find(id) == m_lateConsts.end())
-        return id;
-    }
+    for (uint32_t i = 0; i < argCount; i++)
+      words[3 + i] = argIds[i];
+
+    size_t hash = hashTypeConst(words.size(), words.data(), 2);
+    uint32_t resultId = this->findTypeConst(words.size(), words.data(), 2, hash);
+
+    if (resultId)
+      return resultId;
     
     // Constant not yet declared, make a new one
-    uint32_t resultId = this->allocateId();
-    m_typeConstDefs.putIns (op, 3 + argCount);
-    m_typeConstDefs.putWord(typeId);
-    m_typeConstDefs.putWord(resultId);
-    
-    for (uint32_t i = 0; i < argCount; i++)
-      m_typeConstDefs.putWord(argIds[i]);
+    resultId = this->allocateId();
+    words[2] = resultId;
+
+    this->addTypeConst(words.size(), words.data(), hash);
     return resultId;
   }
+
+
+  uint32_t SpirvModule::findTypeConst(
+          uint32_t                length,
+    const uint32_t*               words,
+          uint32_t                resultIndex,
+          size_t                  hash) const {
+    auto entries = m_typeConstIndex.equal_range(hash);
+
+    for (auto e = entries.first; e != entries.second; e++) {
+      const uint32_t* ins = m_typeConstDefs.data() + e->second;
+
+      // The first word encodes both the opcode and the length,
+      // and the opcode determines where the result ID is
+      bool match = ins[0] == words[0];
+
+      for (uint32_t i = 1; i < length && match; i++)
+        match = i == resultIndex || ins[i] == words[i];
+
+      if (match)
+        return ins[resultIndex];
+    }
+
+    return 0;
+  }
+
+
+  void SpirvModule::addTypeConst(
+          uint32_t                length,
+    const uint32_t*               words,
+          size_t                  hash) {
+    size_t offset = m_typeConstDefs.dwords();
+
+    for (uint32_t i = 0; i < length; i++)
+      m_typeConstDefs.putWord(words[i]);
+
+    m_typeConstIndex.emplace(hash, uint32_t(offset));
+  }
+
+
+  void SpirvModule::indexTypeConst(
+          size_t                  offset,
+          uint32_t                resultIndex) {
+    const uint32_t* words = m_typeConstDefs.data() + offset;
+    uint32_t length = words[0] >> spv::WordCountShift;
+
+    // Only index the first definition of any given type or
+    // constant in order to return the same result ID that
+    // a linear search over the code buffer would return
+    size_t hash = hashTypeConst(length, words, resultIndex);
+
+    if (!this->findTypeConst(length, words, resultIndex, hash))
+      m_typeConstIndex.emplace(hash, uint32_t(offset));
+  }
+
+
+  size_t SpirvModule::hashTypeConst(
+          uint32_t                length,
+    const uint32_t*               words,
+          uint32_t                resultIndex) {
+    size_t hash = 0;
+
+    for (uint32_t i = 0; i < length; i++) {
+      if (i != resultIndex)
+        hash ^= size_t(words[i]) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    }
+
+    return hash;
+  }
   
   
   void SpirvModule::instImportGlsl450() {
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <unordered_map>
 #include <unordered_set>
 
 #include "spirv_code_buffer.h"
 
+#include "../util/util_small_vector.h"
+
 namespace dxvk {
   
   struct SpirvPhiLabel {
@@ -1255,6 +1258,10 @@ namespace dxvk {
     SpirvCodeBuffer m_code;
 
     std::unordered_set<uint32_t> m_lateConsts;
+
+    // Maps hashes of type and constant declarations
+    // to their offset within the type buffer, in dwords
+    std::unordered_multimap<size_t, uint32_t> m_typeConstIndex;
     
     uint32_t defType(
             spv::Op                 op, 
@@ -1266,6 +1273,26 @@ namespace dxvk {
             uint32_t                typeId,
             uint32_t                argCount,
       const uint32_t*               argIds);
+
+    uint32_t findTypeConst(
+            uint32_t                length,
+      const uint32_t*               words,
+            uint32_t                resultIndex,
+            size_t                  hash) const;
+
+    void addTypeConst(
+            uint32_t                length,
+      const uint32_t*               words,
+            size_t                  hash);
+
+    void indexTypeConst(
+            size_t                  offset,
+            uint32_t                resultIndex);
+
+    static size_t hashTypeConst(
+            uint32_t                length,
+      const uint32_t*               words,
+            uint32_t                resultIndex);
     
     void instImportGlsl450();
     
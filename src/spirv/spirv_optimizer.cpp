@@ -0,0 +1,1014 @@
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+#include "spirv_optimizer.h"
+
+namespace dxvk {
+
+  SpirvOptimizer::SpirvOptimizer(const SpirvCodeBuffer& code) {
+    const uint32_t* data = code.data();
+    uint32_t size = code.dwords();
+
+    if (size < m_header.size() || data[0] != spv::MagicNumber) {
+      m_words.assign(data, data + size);
+      m_valid = false;
+      return;
+    }
+
+    std::copy(data, data + m_header.size(), m_header.begin());
+    m_words.assign(data + m_header.size(), data + size);
+
+    for (uint32_t offset = 0; offset < m_words.size(); ) {
+      uint32_t length = m_words[offset] >> spv::WordCountShift;
+
+      if (!length || offset + length > m_words.size()) {
+        m_words.assign(data, data + size);
+        m_instructions.clear();
+        m_valid = false;
+        return;
+      }
+
+      m_instructions.push_back({ offset, length });
+      offset += length;
+    }
+
+    allocateIds(m_header[3]);
+  }
+
+
+  SpirvOptimizer::~SpirvOptimizer() {
+
+  }
+
+
+  void SpirvOptimizer::run() {
+    if (!m_valid)
+      return;
+
+    // Each round may expose new opportunities for the
+    // next one, but most shaders converge very quickly
+    for (uint32_t i = 0; i < 4; i++) {
+      this->analyze();
+
+      bool progress = this->optimizeBlocks();
+      this->applyReplacements();
+
+      this->analyze();
+
+      progress |= this->eliminateDeadVariables();
+      progress |= this->eliminateDeadCode();
+
+      this->removeAnnotations();
+
+      if (!progress)
+        break;
+    }
+  }
+
+
+  SpirvCodeBuffer SpirvOptimizer::getCode() const {
+    if (!m_valid)
+      return SpirvCodeBuffer(m_words.size(), m_words.data());
+
+    std::vector<uint32_t> words;
+    words.reserve(m_header.size() + m_words.size());
+    words.insert(words.end(), m_header.begin(), m_header.end());
+
+    bool constantsWritten = false;
+
+    for (const auto& ins : m_instructions) {
+      if (!ins.length)
+        continue;
+
+      // New constants must be declared before any function
+      uint32_t op = m_words[ins.offset] & spv::OpCodeMask;
+
+      if (op == spv::OpFunction && !constantsWritten) {
+        for (const auto& c : m_newConstants)
+          words.insert(words.end(), &m_words[c.offset], &m_words[c.offset] + c.length);
+
+        constantsWritten = true;
+      }
+
+      words.insert(words.end(), &m_words[ins.offset], &m_words[ins.offset] + ins.length);
+    }
+
+    return SpirvCodeBuffer(words.size(), words.data());
+  }
+
+
+  void SpirvOptimizer::analyze() {
+    uint32_t bound = m_header[3];
+
+    m_defs.assign(bound, Definition());
+    m_uses.assign(bound, 0);
+    m_unknownUses.assign(bound, false);
+    m_vars.assign(bound, VarState::None);
+    m_constants.clear();
+
+    for (const auto& c : m_newConstants)
+      addDefinition(c.offset, c.length, ~0u);
+
+    // Gather definitions first since debug names and
+    // entry points may reference IDs declared later
+    for (uint32_t i = 0; i < m_instructions.size(); i++) {
+      if (!m_instructions[i].length)
+        continue;
+
+      const uint32_t* ins = getIns(i);
+      uint32_t op = ins[0] & spv::OpCodeMask;
+      uint32_t len = ins[0] >> spv::WordCountShift;
+
+      if (op == spv::OpExtInstImport && len > 2) {
+        if (!std::strncmp(reinterpret_cast<const char*>(&ins[2]), "GLSL.std.450", (len - 2) * sizeof(uint32_t)))
+          m_glslSet = ins[1];
+      }
+
+      if (getResultIndex(ins))
+        addDefinition(m_instructions[i].offset, len, i);
+
+      if (op == spv::OpVariable && len == 4
+       && (ins[3] == spv::StorageClassPrivate || ins[3] == spv::StorageClassFunction))
+        m_vars[ins[2]] = VarState::Simple;
+    }
+
+    // Count uses. For variables, only loads are counted as
+    // uses, and any use other than a plain load or a plain
+    // store prevents the variable from being optimized.
+    for (uint32_t i = 0; i < m_instructions.size(); i++) {
+      if (!m_instructions[i].length)
+        continue;
+
+      const uint32_t* ins = getIns(i);
+      uint32_t op = ins[0] & spv::OpCodeMask;
+      uint32_t len = ins[0] >> spv::WordCountShift;
+
+      if (op == spv::OpName       || op == spv::OpMemberName
+       || op == spv::OpDecorate   || op == spv::OpMemberDecorate)
+        continue;
+
+      uint32_t resultIndex = getResultIndex(ins);
+
+      bool known = forEachIdOperand(ins, [&] (uint32_t idx) {
+        uint32_t id = ins[idx];
+
+        if (idx == resultIndex || id >= bound)
+          return;
+
+        if (m_vars[id] != VarState::None) {
+          bool isLoad  = op == spv::OpLoad  && idx == 3 && len == 4;
+          bool isStore = op == spv::OpStore && idx == 1 && len == 3 && ins[2] != id;
+
+          if (!isLoad && !isStore)
+            m_vars[id] = VarState::Escaped;
+
+          if (isStore)
+            return;
+        }
+
+        m_uses[id] += 1;
+      });
+
+      if (!known) {
+        for (uint32_t idx = 1; idx < len; idx++) {
+          uint32_t id = ins[idx];
+
+          if (idx == resultIndex || id >= bound)
+            continue;
+
+          if (m_vars[id] != VarState::None)
+            m_vars[id] = VarState::Escaped;
+
+          m_uses[id] += 1;
+          m_unknownUses[id] = true;
+        }
+      }
+    }
+  }
+
+
+  bool SpirvOptimizer::optimizeBlocks() {
+    // Known variable values and the last store to
+    // each variable within the current block
+    std::unordered_map<uint32_t, uint32_t> values;
+    std::unordered_map<uint32_t, uint32_t> stores;
+
+    bool inFunction = false;
+    bool progress   = false;
+
+    for (uint32_t i = 0; i < m_instructions.size(); i++) {
+      if (!m_instructions[i].length)
+        continue;
+
+      const uint32_t* ins = getIns(i);
+      uint32_t op = ins[0] & spv::OpCodeMask;
+
+      switch (op) {
+        case spv::OpFunction:
+          inFunction = true;
+          break;
+
+        case spv::OpFunctionEnd:
+          inFunction = false;
+          break;
+
+        // Function calls may access any private variable,
+        // and block boundaries end the scope of our data
+        case spv::OpFunctionCall:
+        case spv::OpLabel:
+        case spv::OpBranch:
+        case spv::OpBranchConditional:
+        case spv::OpSwitch:
+        case spv::OpKill:
+        case spv::OpReturn:
+        case spv::OpReturnValue:
+        case spv::OpUnreachable:
+          values.clear();
+          stores.clear();
+          break;
+
+        case spv::OpStore: {
+          uint32_t varId = ins[1];
+
+          if (varId >= m_vars.size() || m_vars[varId] != VarState::Simple)
+            break;
+
+          // The previous store was never read
+          auto entry = stores.find(varId);
+
+          if (entry != stores.end()) {
+            removeInstruction(entry->second);
+            progress = true;
+          }
+
+          stores[varId] = i;
+          values[varId] = resolveId(ins[2]);
+        } break;
+
+        case spv::OpLoad: {
+          uint32_t varId = ins[3];
+
+          if (varId >= m_vars.size() || m_vars[varId] != VarState::Simple)
+            break;
+
+          auto entry = values.find(varId);
+
+          if (entry != values.end() && canReplace(ins[2])) {
+            replaceId(ins[2], entry->second);
+            removeInstruction(i);
+            progress = true;
+          } else {
+            stores.erase(varId);
+            values[varId] = ins[2];
+          }
+        } break;
+
+        default: {
+          if (!inFunction)
+            break;
+
+          uint32_t resultIndex = getResultIndex(ins);
+
+          if (resultIndex != 2 || !canReplace(ins[2]))
+            break;
+
+          // Folding may add constants and thus
+          // invalidate the instruction pointer
+          uint32_t resultId = ins[2];
+          uint32_t folded = foldInstruction(ins);
+
+          if (folded && folded != resultId) {
+            replaceId(resultId, folded);
+            removeInstruction(i);
+            progress = true;
+          }
+        }
+      }
+    }
+
+    return progress;
+  }
+
+
+  bool SpirvOptimizer::eliminateDeadVariables() {
+    bool progress = false;
+
+    for (uint32_t i = 0; i < m_instructions.size(); i++) {
+      if (!m_instructions[i].length)
+        continue;
+
+      const uint32_t* ins = getIns(i);
+      uint32_t op = ins[0] & spv::OpCodeMask;
+
+      uint32_t varId = 0;
+
+      if (op == spv::OpVariable)
+        varId = ins[2];
+      else if (op == spv::OpStore)
+        varId = ins[1];
+
+      if (varId && varId < m_vars.size()
+       && m_vars[varId] == VarState::Simple
+       && !m_uses[varId]) {
+        removeInstruction(i);
+        progress = true;
+      }
+    }
+
+    return progress;
+  }
+
+
+  bool SpirvOptimizer::eliminateDeadCode() {
+    std::vector<uint32_t> worklist;
+
+    for (uint32_t i = 0; i < m_instructions.size(); i++) {
+      if (!m_instructions[i].length)
+        continue;
+
+      const uint32_t* ins = getIns(i);
+
+      if (isRemovable(ins) && !m_uses[ins[2]])
+        worklist.push_back(i);
+    }
+
+    bool progress = !worklist.empty();
+
+    while (!worklist.empty()) {
+      uint32_t index = worklist.back();
+      worklist.pop_back();
+
+      if (!m_instructions[index].length)
+        continue;
+
+      // Words remain valid after the instruction is removed
+      const uint32_t* ins = getIns(index);
+      removeInstruction(index);
+
+      forEachIdOperand(ins, [&] (uint32_t idx) {
+        uint32_t id = ins[idx];
+
+        if (idx == 2 || id >= m_defs.size() || m_uses[id])
+          return;
+
+        uint32_t defIndex = m_defs[id].index;
+
+        if (defIndex != ~0u && m_instructions[defIndex].length
+         && isRemovable(getIns(defIndex)))
+          worklist.push_back(defIndex);
+      });
+    }
+
+    return progress;
+  }
+
+
+  void SpirvOptimizer::applyReplacements() {
+    for (uint32_t i = 0; i < m_instructions.size(); i++) {
+      if (!m_instructions[i].length)
+        continue;
+
+      uint32_t* ins = getIns(i);
+      uint32_t resultIndex = getResultIndex(ins);
+
+      forEachIdOperand(ins, [&] (uint32_t idx) {
+        if (idx != resultIndex)
+          ins[idx] = resolveId(ins[idx]);
+      });
+    }
+
+    std::fill(m_replacements.begin(), m_replacements.end(), 0u);
+  }
+
+
+  void SpirvOptimizer::removeInstruction(
+          uint32_t                index) {
+    const uint32_t* ins = getIns(index);
+    uint32_t resultIndex = getResultIndex(ins);
+
+    if (resultIndex)
+      m_removedIds[ins[resultIndex]] = true;
+
+    // Keep use counts up to date so that removing
+    // an instruction can make its operands dead
+    uint32_t op = ins[0] & spv::OpCodeMask;
+
+    forEachIdOperand(ins, [&] (uint32_t idx) {
+      uint32_t id = ins[idx];
+
+      if (idx == resultIndex || id >= m_uses.size() || !m_uses[id])
+        return;
+
+      if (op == spv::OpStore && idx == 1 && m_vars[id] != VarState::None)
+        return;
+
+      m_uses[id] -= 1;
+    });
+
+    m_instructions[index].length = 0;
+  }
+
+
+  void SpirvOptimizer::removeAnnotations() {
+    for (uint32_t i = 0; i < m_instructions.size(); i++) {
+      if (!m_instructions[i].length)
+        continue;
+
+      const uint32_t* ins = getIns(i);
+      uint32_t op = ins[0] & spv::OpCodeMask;
+
+      if (op == spv::OpName       || op == spv::OpMemberName
+       || op == spv::OpDecorate   || op == spv::OpMemberDecorate) {
+        if (ins[1] < m_removedIds.size() && m_removedIds[ins[1]])
+          m_instructions[i].length = 0;
+      }
+    }
+  }
+
+
+  void SpirvOptimizer::replaceId(
+          uint32_t                id,
+          uint32_t                replacement) {
+    m_replacements[id] = replacement;
+  }
+
+
+  uint32_t SpirvOptimizer::resolveId(
+          uint32_t                id) const {
+    while (id < m_replacements.size() && m_replacements[id])
+      id = m_replacements[id];
+
+    return id;
+  }
+
+
+  bool SpirvOptimizer::canReplace(
+          uint32_t                id) const {
+    return id < m_unknownUses.size() && !m_unknownUses[id];
+  }
+
+
+  uint32_t SpirvOptimizer::foldInstruction(
+    const uint32_t*               ins) {
+    switch (ins[0] & spv::OpCodeMask) {
+      case spv::OpCompositeExtract:
+        return foldCompositeExtract(ins);
+
+      case spv::OpVectorShuffle:
+        return foldVectorShuffle(ins);
+
+      case spv::OpCompositeConstruct:
+        return foldCompositeConstruct(ins);
+
+      case spv::OpBitcast:
+        return foldBitcast(ins[1], resolveId(ins[3]));
+
+      default:
+        return 0;
+    }
+  }
+
+
+  uint32_t SpirvOptimizer::foldCompositeExtract(
+    const uint32_t*               ins) {
+    uint32_t len = ins[0] >> spv::WordCountShift;
+    uint32_t id = resolveId(ins[3]);
+
+    for (uint32_t i = 4; i < len; i++) {
+      const uint32_t* def = getDef(id);
+
+      if (!def)
+        return 0;
+
+      uint32_t op = def[0] & spv::OpCodeMask;
+      uint32_t count = (def[0] >> spv::WordCountShift) - 3;
+
+      if (ins[i] >= count)
+        return 0;
+
+      // Vectors constructed from scalars are common
+      // when the compiler splits up vector operations
+      if (op == spv::OpConstantComposite)
+        id = def[3 + ins[i]];
+      else if (op == spv::OpCompositeConstruct && getVectorSize(def[1]) == count)
+        id = resolveId(def[3 + ins[i]]);
+      else
+        return 0;
+    }
+
+    return id;
+  }
+
+
+  uint32_t SpirvOptimizer::foldVectorShuffle(
+    const uint32_t*               ins) {
+    uint32_t len = ins[0] >> spv::WordCountShift;
+    uint32_t count = len - 5;
+
+    uint32_t typeId = ins[1];
+    uint32_t aId = resolveId(ins[3]);
+    uint32_t bId = resolveId(ins[4]);
+
+    uint32_t aSize = getVectorSize(getTypeOf(aId));
+    uint32_t bSize = getVectorSize(getTypeOf(bId));
+
+    if (!aSize || !bSize)
+      return 0;
+
+    // Identity swizzles of either operand
+    bool aIdentity = getTypeOf(aId) == typeId && count == aSize;
+    bool bIdentity = getTypeOf(bId) == typeId && count == bSize;
+
+    for (uint32_t i = 0; i < count; i++) {
+      aIdentity &= ins[5 + i] == i;
+      bIdentity &= ins[5 + i] == i + aSize;
+    }
+
+    if (aIdentity)
+      return aId;
+
+    if (bIdentity)
+      return bId;
+
+    // Swizzles of constant vectors
+    std::array<uint32_t, 4> scalars;
+
+    if (count > scalars.size())
+      return 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+      uint32_t index = ins[5 + i];
+
+      if (index >= aSize + bSize)
+        return 0;
+
+      const uint32_t* def = index < aSize
+        ? getDef(aId)
+        : getDef(bId);
+
+      if (!def || (def[0] & spv::OpCodeMask) != spv::OpConstantComposite)
+        return 0;
+
+      scalars[i] = def[3 + (index < aSize ? index : index - aSize)];
+    }
+
+    return getConstant(spv::OpConstantComposite, typeId, count, scalars.data());
+  }
+
+
+  uint32_t SpirvOptimizer::foldCompositeConstruct(
+    const uint32_t*               ins) {
+    uint32_t len = ins[0] >> spv::WordCountShift;
+    uint32_t count = len - 3;
+
+    uint32_t typeId = ins[1];
+
+    // Only fold vectors, each operand is a scalar in that case
+    std::array<uint32_t, 4> scalars;
+
+    if (getVectorSize(typeId) != count || count > scalars.size())
+      return 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+      scalars[i] = resolveId(ins[3 + i]);
+
+      if (!isConstant(scalars[i]))
+        return 0;
+    }
+
+    return getConstant(spv::OpConstantComposite, typeId, count, scalars.data());
+  }
+
+
+  uint32_t SpirvOptimizer::foldBitcast(
+          uint32_t                typeId,
+          uint32_t                valueId) {
+    if (getTypeOf(valueId) == typeId)
+      return valueId;
+
+    const uint32_t* def  = getDef(valueId);
+    const uint32_t* type = getDef(typeId);
+
+    if (!def || !type)
+      return 0;
+
+    uint32_t defOp  = def[0] & spv::OpCodeMask;
+    uint32_t typeOp = type[0] & spv::OpCodeMask;
+
+    if (defOp == spv::OpConstant) {
+      const uint32_t* srcType = getDef(def[1]);
+
+      if (!srcType || (def[0] >> spv::WordCountShift) != 4)
+        return 0;
+
+      uint32_t srcTypeOp = srcType[0] & spv::OpCodeMask;
+
+      bool srcIs32Bit = (srcTypeOp == spv::OpTypeInt || srcTypeOp == spv::OpTypeFloat) && srcType[2] == 32;
+      bool dstIs32Bit = (typeOp    == spv::OpTypeInt || typeOp    == spv::OpTypeFloat) && type[2]    == 32;
+
+      if (!srcIs32Bit || !dstIs32Bit)
+        return 0;
+
+      uint32_t value = def[3];
+      return getConstant(spv::OpConstant, typeId, 1, &value);
+    }
+
+    if (defOp == spv::OpConstantComposite && typeOp == spv::OpTypeVector) {
+      uint32_t count = (def[0] >> spv::WordCountShift) - 3;
+
+      std::array<uint32_t, 4> scalars;
+
+      if (type[3] != count || count > scalars.size())
+        return 0;
+
+      // Copy everything we need up front since creating
+      // constants invalidates the definition pointers
+      uint32_t scalarTypeId = type[2];
+
+      for (uint32_t i = 0; i < count; i++)
+        scalars[i] = def[3 + i];
+
+      for (uint32_t i = 0; i < count; i++) {
+        scalars[i] = foldBitcast(scalarTypeId, scalars[i]);
+
+        if (!scalars[i])
+          return 0;
+      }
+
+      return getConstant(spv::OpConstantComposite, typeId, count, scalars.data());
+    }
+
+    return 0;
+  }
+
+
+  uint32_t SpirvOptimizer::getVectorSize(
+          uint32_t                typeId) const {
+    const uint32_t* type = getDef(typeId);
+
+    return type && (type[0] & spv::OpCodeMask) == spv::OpTypeVector
+      ? type[3] : 0;
+  }
+
+
+  bool SpirvOptimizer::isConstant(
+          uint32_t                id) const {
+    const uint32_t* def = getDef(id);
+
+    if (!def)
+      return false;
+
+    uint32_t op = def[0] & spv::OpCodeMask;
+
+    return op == spv::OpConstant
+        || op == spv::OpConstantTrue
+        || op == spv::OpConstantFalse
+        || op == spv::OpConstantComposite;
+  }
+
+
+  uint32_t SpirvOptimizer::getConstant(
+          spv::Op                 op,
+          uint32_t                typeId,
+          uint32_t                argCount,
+    const uint32_t*               args) {
+    std::vector<uint32_t> key;
+    key.reserve(2 + argCount);
+    key.push_back(op);
+    key.push_back(typeId);
+    key.insert(key.end(), args, args + argCount);
+
+    auto entry = m_constants.find(key);
+
+    if (entry != m_constants.end())
+      return entry->second;
+
+    uint32_t id = m_header[3];
+    allocateIds(id + 1);
+
+    uint32_t offset = m_words.size();
+    m_words.push_back(op | ((3 + argCount) << spv::WordCountShift));
+    m_words.push_back(typeId);
+    m_words.push_back(id);
+    m_words.insert(m_words.end(), args, args + argCount);
+
+    m_newConstants.push_back({ offset, 3 + argCount });
+    addDefinition(offset, 3 + argCount, ~0u);
+    return id;
+  }
+
+
+  void SpirvOptimizer::addDefinition(
+          uint32_t                offset,
+          uint32_t                length,
+          uint32_t                index) {
+    const uint32_t* ins = &m_words[offset];
+    uint32_t resultIndex = getResultIndex(ins);
+    uint32_t resultId = ins[resultIndex];
+
+    if (resultId >= m_defs.size())
+      return;
+
+    Definition& def = m_defs[resultId];
+    def.offset = offset;
+    def.length = length;
+    def.index  = index;
+    def.type   = resultIndex == 2 ? ins[1] : 0;
+
+    uint32_t op = ins[0] & spv::OpCodeMask;
+
+    if (op == spv::OpConstant || op == spv::OpConstantComposite) {
+      std::vector<uint32_t> key;
+      key.reserve(length - 1);
+      key.push_back(op);
+      key.push_back(ins[1]);
+      key.insert(key.end(), ins + 3, ins + length);
+
+      m_constants.insert({ std::move(key), resultId });
+    }
+  }
+
+
+  void SpirvOptimizer::allocateIds(
+          uint32_t                bound) {
+    m_header[3] = bound;
+
+    m_defs.resize(bound);
+    m_replacements.resize(bound, 0u);
+    m_uses.resize(bound, 0u);
+    m_unknownUses.resize(bound, false);
+    m_removedIds.resize(bound, false);
+    m_vars.resize(bound, VarState::None);
+  }
+
+
+  bool SpirvOptimizer::isRemovable(
+    const uint32_t*               ins) const {
+    uint32_t op = ins[0] & spv::OpCodeMask;
+    uint32_t len = ins[0] >> spv::WordCountShift;
+
+    if ((op >= spv::OpConvertFToU && op <= spv::OpQuantizeToF16)
+     || (op >= spv::OpSNegate     && op <= spv::OpFwidthCoarse)
+     || (op >= spv::OpVectorExtractDynamic && op <= spv::OpTranspose)
+     || (op >= spv::OpImageQueryFormat     && op <= spv::OpImageQuerySamples))
+      return true;
+
+    switch (op) {
+      case spv::OpLoad:
+        return len == 4;
+
+      case spv::OpExtInst:
+        // Modf and Frexp write to a pointer operand
+        return ins[3] == m_glslSet
+            && ins[4] != GLSLstd450Modf
+            && ins[4] != GLSLstd450Frexp;
+
+      case spv::OpAccessChain:
+      case spv::OpInBoundsAccessChain:
+      case spv::OpSampledImage:
+      case spv::OpImage:
+      case spv::OpBitcast:
+      case spv::OpPhi:
+        return true;
+
+      default:
+        return false;
+    }
+  }
+
+
+  uint32_t SpirvOptimizer::getResultIndex(
+    const uint32_t*               ins) {
+    uint32_t op = ins[0] & spv::OpCodeMask;
+
+    if ((op >= spv::OpTypeVoid && op <= spv::OpTypeFunction))
+      return 1;
+
+    if ((op >= spv::OpConstantTrue         && op <= spv::OpSpecConstantOp)
+     || (op >= spv::OpVectorExtractDynamic && op <= spv::OpTranspose)
+     || (op >= spv::OpSampledImage         && op <= spv::OpImageSampleProjDrefExplicitLod)
+     || (op >= spv::OpImageFetch           && op <= spv::OpImageRead)
+     || (op >= spv::OpImage                && op <= spv::OpImageQuerySamples)
+     || (op >= spv::OpConvertFToU          && op <= spv::OpBitcast)
+     || (op >= spv::OpSNegate              && op <= spv::OpFwidthCoarse)
+     || (op >= spv::OpAtomicLoad           && op <= spv::OpAtomicXor && op != spv::OpAtomicStore))
+      return 2;
+
+    switch (op) {
+      case spv::OpExtInstImport:
+      case spv::OpString:
+      case spv::OpLabel:
+        return 1;
+
+      case spv::OpUndef:
+      case spv::OpExtInst:
+      case spv::OpFunction:
+      case spv::OpFunctionParameter:
+      case spv::OpFunctionCall:
+      case spv::OpVariable:
+      case spv::OpImageTexelPointer:
+      case spv::OpLoad:
+      case spv::OpAccessChain:
+      case spv::OpInBoundsAccessChain:
+      case spv::OpArrayLength:
+      case spv::OpPhi:
+        return 2;
+
+      default:
+        return 0;
+    }
+  }
+
+
+  template<typename Fn>
+  bool SpirvOptimizer::forEachIdOperand(
+    const uint32_t*               ins,
+    const Fn&                     fn) {
+    uint32_t op = ins[0] & spv::OpCodeMask;
+    uint32_t len = ins[0] >> spv::WordCountShift;
+
+    // Range of operands that are all IDs
+    uint32_t first = 1;
+    uint32_t last = len;
+
+    if ((op >= spv::OpConvertFToU && op <= spv::OpQuantizeToF16)
+     || (op >= spv::OpSNegate     && op <= spv::OpFwidthCoarse)
+     || (op >= spv::OpAtomicLoad  && op <= spv::OpAtomicXor)
+     || (op >= spv::OpImage       && op <= spv::OpImageQuerySamples)
+     || (op >= spv::OpVectorExtractDynamic && op <= spv::OpVectorInsertDynamic)
+     || (op >= spv::OpTypeVoid    && op <= spv::OpTypeBool)) {
+      for (uint32_t i = first; i < last; i++)
+        fn(i);
+      return true;
+    }
+
+    // Image instructions have a fixed number of ID operands,
+    // followed by an optional image operand mask and IDs
+    uint32_t imageOperandIndex = 0;
+
+    switch (op) {
+      case spv::OpImageSampleImplicitLod:
+      case spv::OpImageSampleExplicitLod:
+      case spv::OpImageSampleProjImplicitLod:
+      case spv::OpImageSampleProjExplicitLod:
+      case spv::OpImageFetch:
+      case spv::OpImageRead:
+        imageOperandIndex = 5;
+        break;
+
+      case spv::OpImageSampleDrefImplicitLod:
+      case spv::OpImageSampleDrefExplicitLod:
+      case spv::OpImageSampleProjDrefImplicitLod:
+      case spv::OpImageSampleProjDrefExplicitLod:
+      case spv::OpImageGather:
+      case spv::OpImageDrefGather:
+        imageOperandIndex = 6;
+        break;
+
+      case spv::OpImageWrite:
+        imageOperandIndex = 4;
+        break;
+
+      default:
+        break;
+    }
+
+    if (imageOperandIndex) {
+      for (uint32_t i = first; i < len; i++) {
+        if (i != imageOperandIndex)
+          fn(i);
+      }
+      return true;
+    }
+
+    switch (op) {
+      case spv::OpSource:
+      case spv::OpExtension:
+      case spv::OpMemoryModel:
+      case spv::OpCapability:
+        return true;
+
+      case spv::OpString:
+      case spv::OpExtInstImport:
+      case spv::OpExecutionMode:
+      case spv::OpTypeInt:
+      case spv::OpTypeFloat:
+      case spv::OpTypeSampler:
+      case spv::OpSelectionMerge:
+        last = std::min(len, 2u);
+        break;
+
+      case spv::OpTypeVector:
+      case spv::OpTypeMatrix:
+      case spv::OpTypeImage:
+      case spv::OpTypeSampledImage:
+      case spv::OpTypeRuntimeArray:
+      case spv::OpLoopMerge:
+        last = std::min(len, 3u);
+        break;
+
+      case spv::OpTypePointer:
+        fn(1);
+        first = 3;
+        break;
+
+      case spv::OpConstantTrue:
+      case spv::OpConstantFalse:
+      case spv::OpConstantNull:
+      case spv::OpSpecConstantTrue:
+      case spv::OpSpecConstantFalse:
+      case spv::OpConstant:
+      case spv::OpSpecConstant:
+      case spv::OpUndef:
+      case spv::OpFunctionParameter:
+        last = std::min(len, 3u);
+        break;
+
+      case spv::OpEntryPoint: {
+        // Skip the name string, which ends with the
+        // first word whose most significant byte is 0
+        first = 3;
+
+        while (first < len && (ins[first++] >> 24));
+
+        fn(2);
+      } break;
+
+      case spv::OpFunction:
+        fn(1);
+        fn(2);
+        first = 4;
+        break;
+
+      case spv::OpVariable:
+        fn(1);
+        fn(2);
+        first = 4;
+        break;
+
+      case spv::OpExtInst:
+        fn(1);
+        fn(2);
+        fn(3);
+        first = 5;
+        break;
+
+      case spv::OpLoad:
+      case spv::OpCompositeExtract:
+      case spv::OpArrayLength:
+      case spv::OpBranchConditional:
+        last = std::min(len, 4u);
+        break;
+
+      case spv::OpStore:
+        last = std::min(len, 3u);
+        break;
+
+      case spv::OpVectorShuffle:
+      case spv::OpCompositeInsert:
+        last = std::min(len, 5u);
+        break;
+
+      case spv::OpTypeArray:
+      case spv::OpTypeStruct:
+      case spv::OpTypeFunction:
+      case spv::OpConstantComposite:
+      case spv::OpSpecConstantComposite:
+      case spv::OpFunctionEnd:
+      case spv::OpFunctionCall:
+      case spv::OpImageTexelPointer:
+      case spv::OpAccessChain:
+      case spv::OpInBoundsAccessChain:
+      case spv::OpCompositeConstruct:
+      case spv::OpCopyObject:
+      case spv::OpTranspose:
+      case spv::OpSampledImage:
+      case spv::OpBitcast:
+      case spv::OpEmitVertex:
+      case spv::OpEndPrimitive:
+      case spv::OpEmitStreamVertex:
+      case spv::OpEndStreamPrimitive:
+      case spv::OpControlBarrier:
+      case spv::OpMemoryBarrier:
+      case spv::OpPhi:
+      case spv::OpLabel:
+      case spv::OpBranch:
+      case spv::OpKill:
+      case spv::OpReturn:
+      case spv::OpReturnValue:
+      case spv::OpUnreachable:
+      case spv::OpDemoteToHelperInvocationEXT:
+        break;
+
+      default:
+        return false;
+    }
+
+    for (uint32_t i = first; i < last; i++)
+      fn(i);
+
+    return true;
+  }
+
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <array>
+#include <map>
+#include <vector>
+
+#include "spirv_code_buffer.h"
+
+namespace dxvk {
+
+  /**
+   * \brief SPIR-V optimizer
+   *
+   * Implements a small set of cheap passes that clean up
+   * the code emitted by the shader compilers. Loads from
+   * private and function variables are forwarded within a
+   * block, dead stores and unused variables are removed,
+   * swizzles and bit casts of constants are folded, and
+   * instructions whose results are unused get eliminated.
+   *
+   * Only variables that are exclusively accessed through
+   * plain loads and stores are considered, and results are
+   * only replaced if all their uses are in instructions
+   * with a known operand layout. Anything else is left
+   * untouched, so that the output always remains valid.
+   */
+  class SpirvOptimizer {
+
+  public:
+
+    SpirvOptimizer(const SpirvCodeBuffer& code);
+    ~SpirvOptimizer();
+
+    /**
+     * \brief Runs all optimization passes
+     *
+     * Passes are repeated until they no
+     * longer make any progress.
+     */
+    void run();
+
+    /**
+     * \brief Retrieves optimized code
+     * \returns Optimized SPIR-V module
+     */
+    SpirvCodeBuffer getCode() const;
+
+  private:
+
+    struct Instruction {
+      uint32_t offset;
+      uint32_t length;
+    };
+
+    struct Definition {
+      uint32_t offset = 0;
+      uint32_t length = 0;
+      uint32_t index  = ~0u;
+      uint32_t type   = 0;
+    };
+
+    enum class VarState : uint8_t {
+      None,
+      Simple,
+      Escaped,
+    };
+
+    std::array<uint32_t, 5>   m_header = { };
+    std::vector<uint32_t>     m_words;
+
+    std::vector<Instruction>  m_instructions;
+    std::vector<Instruction>  m_newConstants;
+
+    std::vector<Definition>   m_defs;
+    std::vector<uint32_t>     m_replacements;
+    std::vector<uint32_t>     m_uses;
+    std::vector<bool>         m_unknownUses;
+    std::vector<bool>         m_removedIds;
+    std::vector<VarState>     m_vars;
+
+    std::map<std::vector<uint32_t>, uint32_t> m_constants;
+
+    uint32_t m_glslSet = 0;
+    bool     m_valid   = true;
+
+    const uint32_t* getIns(uint32_t index) const {
+      return &m_words[m_instructions[index].offset];
+    }
+
+    uint32_t* getIns(uint32_t index) {
+      return &m_words[m_instructions[index].offset];
+    }
+
+    const uint32_t* getDef(uint32_t id) const {
+      return id < m_defs.size() && m_defs[id].length
+        ? &m_words[m_defs[id].offset]
+        : nullptr;
+    }
+
+    uint32_t getTypeOf(uint32_t id) const {
+      return id < m_defs.size() ? m_defs[id].type : 0;
+    }
+
+    void analyze();
+
+    bool optimizeBlocks();
+
+    bool eliminateDeadVariables();
+
+    bool eliminateDeadCode();
+
+    void applyReplacements();
+
+    void removeInstruction(
+            uint32_t                index);
+
+    void removeAnnotations();
+
+    void replaceId(
+            uint32_t                id,
+            uint32_t                replacement);
+
+    uint32_t resolveId(
+            uint32_t                id) const;
+
+    bool canReplace(
+            uint32_t                id) const;
+
+    uint32_t foldInstruction(
+      const uint32_t*               ins);
+
+    uint32_t foldCompositeExtract(
+      const uint32_t*               ins);
+
+    uint32_t foldVectorShuffle(
+      const uint32_t*               ins);
+
+    uint32_t foldCompositeConstruct(
+      const uint32_t*               ins);
+
+    uint32_t foldBitcast(
+            uint32_t                typeId,
+            uint32_t                valueId);
+
+    uint32_t getVectorSize(
+            uint32_t                typeId) const;
+
+    bool isConstant(
+            uint32_t                id) const;
+
+    uint32_t getConstant(
+            spv::Op                 op,
+            uint32_t                typeId,
+            uint32_t                argCount,
+      const uint32_t*               args);
+
+    void addDefinition(
+            uint32_t                offset,
+            uint32_t                length,
+            uint32_t                index);
+
+    void allocateIds(
+            uint32_t                bound);
+
+    bool isRemovable(
+      const uint32_t*               ins) const;
+
+    static uint32_t getResultIndex(
+      const uint32_t*               ins);
+
+    template<typename Fn>
+    static bool forEachIdOperand(
+      const uint32_t*               ins,
+      const Fn&                     fn);
+
+  };
+
+}
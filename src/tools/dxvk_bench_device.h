@@ -0,0 +1,39 @@
+#pragma once
+
+#include "../dxvk/dxvk_adapter.h"
+#include "../dxvk/dxvk_device.h"
+#include "../dxvk/dxvk_instance.h"
+
+namespace dxvk {
+
+  /**
+   * \brief Creates a device for benchmarks
+   *
+   * Uses the first adapter and only enables the features
+   * that DXVK itself relies on, so that the results are
+   * not affected by any optional driver features.
+   * \returns The device
+   */
+  inline Rc<DxvkDevice> createBenchDevice() {
+    Rc<DxvkInstance> instance = new DxvkInstance();
+    Rc<DxvkAdapter>  adapter  = instance->enumAdapters(0);
+
+    if (adapter == nullptr)
+      throw DxvkError("No Vulkan adapter found");
+
+    DxvkDeviceFeatures supported = adapter->features();
+    DxvkDeviceFeatures enabled   = { };
+
+    // Required by meta shaders
+    enabled.core.features.geometryShader = VK_TRUE;
+    enabled.core.features.shaderStorageImageWriteWithoutFormat = VK_TRUE;
+    enabled.core.features.imageCubeArray = VK_TRUE;
+
+    enabled.extMemoryPriority.memoryPriority = supported.extMemoryPriority.memoryPriority;
+    enabled.khrTimelineSemaphore.timelineSemaphore = supported.khrTimelineSemaphore.timelineSemaphore;
+
+    Logger::info(str::format("Using adapter: ", adapter->deviceProperties().deviceName));
+    return adapter->createDevice(instance, enabled);
+  }
+
+}
@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "../dxvk/dxvk_context.h"
+
+#include "../util/util_time.h"
+
+#include "dxvk_bench_device.h"
+
+#include <dxvk_constant_bench_cs.h>
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-constant-bench.log");
+}
+
+using namespace dxvk;
+
+/**
+ * \brief Benchmark parameters
+ */
+struct BenchParams {
+  uint32_t frameCount = 100;
+  uint32_t drawCount  = 2000;
+  uint32_t constCount = 64;
+};
+
+/**
+ * \brief Constant upload method
+ */
+enum class BenchUploadMode : uint32_t {
+  /// Invalidate the whole buffer for every upload
+  Discard,
+  /// Sub-allocate uploads from a ring buffer
+  Ring,
+};
+
+/**
+ * \brief Application-side constant registers
+ */
+struct BenchConstants {
+  std::array<std::array<float, 4>, 256> c = { };
+};
+
+/**
+ * \brief Results of a single run
+ */
+struct BenchResult {
+  double ns            = 0.0;
+  double invalidations = 0.0;
+};
+
+// Must match D3D9ConstantRingSize
+constexpr VkDeviceSize BenchRingSize = 256ull << 10;
+
+
+static void printUsage() {
+  std::cerr
+    << "Usage: dxvk-constant-bench [options]" << std::endl
+    << std::endl
+    << "Replays the shader constant uploads of a draw-heavy D3D9 game, which" << std::endl
+    << "sets a transform with SetVertexShaderConstantF before every draw and" << std::endl
+    << "material constants before every few draws. Compares invalidating the" << std::endl
+    << "constant buffer for each draw against sub-allocating the constants" << std::endl
+    << "from a ring buffer, as done by D3D9DeviceEx::UploadConstantSet." << std::endl
+    << "Requires a Vulkan device." << std::endl
+    << std::endl
+    << "Options:" << std::endl
+    << "  -f <frames>       Number of frames to replay. Default: 100" << std::endl
+    << "  -d <draws>        Number of draws per frame. Default: 2000" << std::endl
+    << "  -c <registers>    Number of float registers read by the shader, at most 256. Default: 64" << std::endl;
+}
+
+
+static Rc<DxvkShader> createShader() {
+  const std::array<DxvkResourceSlot, 2> resourceSlots = {{
+    { 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_IMAGE_VIEW_TYPE_MAX_ENUM },
+    { 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_IMAGE_VIEW_TYPE_MAX_ENUM },
+  }};
+
+  DxvkShaderCreateInfo info;
+  info.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  info.resourceSlotCount = resourceSlots.size();
+  info.resourceSlots = resourceSlots.data();
+  info.pushConstOffset = 0;
+  info.pushConstSize = sizeof(uint32_t);
+
+  return new DxvkShader(info, SpirvCodeBuffer(dxvk_constant_bench_cs));
+}
+
+
+static Rc<DxvkBuffer> createBuffer(
+  const Rc<DxvkDevice>&           device,
+        VkBufferUsageFlags        usage,
+        VkDeviceSize              size) {
+  DxvkBufferCreateInfo info = { };
+  info.size   = size;
+  info.usage  = usage;
+  info.stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+  info.access = usage == VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT
+    ? VK_ACCESS_UNIFORM_READ_BIT
+    : VK_ACCESS_SHADER_WRITE_BIT;
+
+  return device->createBuffer(info,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+
+static BenchResult runReplay(
+  const Rc<DxvkDevice>&           device,
+  const BenchParams&              params,
+        BenchUploadMode           mode) {
+  Rc<DxvkContext> ctx = device->createContext();
+  ctx->beginRecording(device->createCommandList());
+
+  const VkDeviceSize dataSize  = params.constCount * sizeof(BenchConstants::c[0]);
+  const VkDeviceSize alignment = device->properties().core.properties.limits.minUniformBufferOffsetAlignment;
+
+  Rc<DxvkBuffer> constBuffer = createBuffer(device, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+    mode == BenchUploadMode::Ring ? BenchRingSize : dataSize);
+  Rc<DxvkBuffer> resultBuffer = createBuffer(device, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 16);
+
+  DxvkBufferSliceHandle constSlice  = constBuffer->getSliceHandle();
+  VkDeviceSize          constOffset = 0;
+
+  ctx->bindShader(VK_SHADER_STAGE_COMPUTE_BIT, createShader());
+  ctx->bindResourceBuffer(0, DxvkBufferSlice(constBuffer, 0, dataSize));
+  ctx->bindResourceBuffer(1, DxvkBufferSlice(resultBuffer));
+  ctx->pushConstants(0, sizeof(params.constCount), &params.constCount);
+
+  BenchConstants consts;
+  BenchResult    result;
+
+  for (uint32_t f = 0; f < params.frameCount; f++) {
+    auto t0 = dxvk::high_resolution_clock::now();
+
+    for (uint32_t d = 0; d < params.drawCount; d++) {
+      // World-view-projection matrix in c0-c3 for every draw,
+      // material constants in c4-c7 whenever the material changes
+      std::array<float, 16> data;
+      data.fill(float(d));
+
+      std::memcpy(&consts.c[0], data.data(), 4 * sizeof(consts.c[0]));
+
+      if (!(d % 8) && params.constCount >= 8)
+        std::memcpy(&consts.c[4], data.data(), 4 * sizeof(consts.c[0]));
+
+      // Mirrors D3D9DeviceEx::UploadConstantSet, without the CS thread
+      if (mode == BenchUploadMode::Ring) {
+        VkDeviceSize offset = align(constOffset, alignment);
+
+        if (offset + dataSize > constBuffer->info().size) {
+          constSlice = constBuffer->allocSlice();
+          offset = 0;
+
+          ctx->invalidateBuffer(constBuffer, constSlice);
+          result.invalidations += 1.0;
+        }
+
+        constOffset = offset + dataSize;
+
+        ctx->bindResourceBuffer(0, DxvkBufferSlice(constBuffer, offset, dataSize));
+        std::memcpy(reinterpret_cast<char*>(constSlice.mapPtr) + offset, consts.c.data(), dataSize);
+      } else {
+        constSlice = constBuffer->allocSlice();
+
+        ctx->invalidateBuffer(constBuffer, constSlice);
+        result.invalidations += 1.0;
+
+        std::memcpy(constSlice.mapPtr, consts.c.data(), dataSize);
+      }
+
+      ctx->dispatch(1, 1, 1);
+    }
+
+    ctx->flushCommandList();
+
+    auto t1 = dxvk::high_resolution_clock::now();
+    result.ns += std::chrono::duration<double, std::nano>(t1 - t0).count();
+
+    // Keep at most one frame in flight so that both
+    // methods can reuse buffer slices in the same way
+    device->waitForIdle();
+  }
+
+  double drawCount = double(params.frameCount) * double(params.drawCount);
+
+  result.ns            /= drawCount;
+  result.invalidations /= double(params.frameCount);
+  return result;
+}
+
+
+int main(int argc, char** argv) {
+  BenchParams params;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+
+    if ((arg == "-f" || arg == "-d" || arg == "-c") && i + 1 == argc) {
+      printUsage();
+      return 1;
+    }
+
+    if (arg == "-f") {
+      params.frameCount = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "-d") {
+      params.drawCount = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "-c") {
+      params.constCount = std::clamp(std::atoi(argv[++i]), 1, 256);
+    } else {
+      printUsage();
+      return arg == "-h" || arg == "--help" ? 0 : 1;
+    }
+  }
+
+  try {
+    Rc<DxvkDevice> device = createBenchDevice();
+
+    BenchResult discard = runReplay(device, params, BenchUploadMode::Discard);
+    BenchResult ring    = runReplay(device, params, BenchUploadMode::Ring);
+
+    std::cout
+      << "Replayed " << params.frameCount << " frames of " << params.drawCount
+      << " draws reading " << params.constCount << " registers" << std::endl
+      << std::setw(10) << "Method"          << " "
+      << std::setw(14) << "Draw (ns)"       << " "
+      << std::setw(20) << "Invalidates/frame" << std::endl
+      << std::fixed << std::setprecision(1)
+      << std::setw(10) << "Discard"         << " "
+      << std::setw(14) << discard.ns        << " "
+      << std::setw(20) << discard.invalidations << std::endl
+      << std::setw(10) << "Ring"            << " "
+      << std::setw(14) << ring.ns           << " "
+      << std::setw(20) << ring.invalidations << std::endl;
+  } catch (const DxvkError& e) {
+    std::cerr << e.message() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../dxvk/dxvk_cs.h"
+
+#include "../util/thread.h"
+#include "../util/util_time.h"
+
+#include "dxvk_bench_device.h"
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-cs-bench.log");
+}
+
+using namespace dxvk;
+
+using BenchTime = dxvk::high_resolution_clock::time_point;
+
+/**
+ * \brief Benchmark parameters
+ */
+struct BenchParams {
+  uint32_t chunkCount   = 100000;
+  uint32_t commandCount = 16;
+  uint32_t threadCount  = 1;
+  uint32_t syncCount    = 10000;
+};
+
+
+static void printUsage() {
+  std::cerr
+    << "Usage: dxvk-cs-bench [options]" << std::endl
+    << std::endl
+    << "Measures how quickly chunks are handed off to the CS thread. Chunks" << std::endl
+    << "contain empty commands, so that the worker is never the bottleneck" << std::endl
+    << "and the results reflect the cost of the dispatch queue itself." << std::endl
+    << "Requires a Vulkan device." << std::endl
+    << std::endl
+    << "Options:" << std::endl
+    << "  -n <chunks>       Number of chunks to dispatch. Default: 100000" << std::endl
+    << "  -c <commands>     Number of commands per chunk, at most 256. Default: 16" << std::endl
+    << "  -t <threads>      Number of threads dispatching chunks. Default: 1" << std::endl
+    << "  -s <count>        Number of dispatch and synchronize round trips. Default: 10000" << std::endl;
+}
+
+
+static double toNs(BenchTime t0, BenchTime t1) {
+  return std::chrono::duration<double, std::nano>(t1 - t0).count();
+}
+
+
+static void printLatencies(
+  const char*                     name,
+        std::vector<double>&      values) {
+  std::sort(values.begin(), values.end());
+
+  double sum = 0.0;
+
+  for (double value : values)
+    sum += value;
+
+  auto percentile = [&values] (double p) {
+    return values[std::min(values.size() - 1, size_t(double(values.size()) * p))];
+  };
+
+  std::cout << std::left << std::setw(24) << name << std::right
+    << std::fixed << std::setprecision(0)
+    << " avg " << std::setw(8) << (sum / double(values.size())) << " ns"
+    << "   p50 " << std::setw(8) << percentile(0.50) << " ns"
+    << "   p99 " << std::setw(8) << percentile(0.99) << " ns" << std::endl;
+}
+
+
+static DxvkCsChunkRef allocChunk(DxvkCsChunkPool& pool) {
+  DxvkCsChunk* chunk = pool.allocChunk(DxvkCsChunkFlag::SingleUse);
+  return DxvkCsChunkRef(chunk, &pool);
+}
+
+
+static void runDispatch(
+  const Rc<DxvkDevice>&           device,
+  const BenchParams&              params) {
+  DxvkCsChunkPool pool;
+  DxvkCsThread    csThread(device, device->createContext());
+
+  std::vector<BenchTime> dispatchTimes(params.chunkCount);
+  std::vector<BenchTime> executeTimes(params.chunkCount);
+  std::vector<double>    dispatchCosts(params.chunkCount);
+
+  std::vector<dxvk::thread> threads;
+
+  auto t0 = dxvk::high_resolution_clock::now();
+
+  for (uint32_t i = 0; i < params.threadCount; i++) {
+    threads.emplace_back([&, i] {
+      for (uint32_t j = i; j < params.chunkCount; j += params.threadCount) {
+        DxvkCsChunkRef chunk = allocChunk(pool);
+
+        // The first command records when the worker reached the
+        // chunk, the remaining ones stand in for draw calls
+        auto timestampCmd = [time = &executeTimes[j]] (DxvkContext*) {
+          *time = dxvk::high_resolution_clock::now();
+        };
+
+        auto emptyCmd = [] (DxvkContext*) { };
+
+        chunk->push(timestampCmd);
+
+        for (uint32_t k = 1; k < params.commandCount; k++)
+          chunk->push(emptyCmd);
+
+        dispatchTimes[j] = dxvk::high_resolution_clock::now();
+        csThread.dispatchChunk(std::move(chunk));
+        dispatchCosts[j] = toNs(dispatchTimes[j], dxvk::high_resolution_clock::now());
+      }
+    });
+  }
+
+  for (auto& thread : threads)
+    thread.join();
+
+  csThread.synchronize(DxvkCsThread::SynchronizeAll);
+
+  auto t1 = dxvk::high_resolution_clock::now();
+
+  std::vector<double> latencies(params.chunkCount);
+
+  for (uint32_t i = 0; i < params.chunkCount; i++)
+    latencies[i] = toNs(dispatchTimes[i], executeTimes[i]);
+
+  double seconds = std::chrono::duration<double>(t1 - t0).count();
+
+  std::cout
+    << "Dispatched " << params.chunkCount << " chunks with " << params.commandCount
+    << " commands on " << params.threadCount << " threads" << std::endl
+    << "Throughput:              " << std::fixed << std::setprecision(0)
+    << (double(params.chunkCount) / seconds) << " chunks/s, "
+    << (double(params.chunkCount) * double(params.commandCount) / seconds) << " commands/s" << std::endl;
+
+  printLatencies("dispatchChunk:", dispatchCosts);
+  printLatencies("Dispatch to execution:", latencies);
+}
+
+
+static void runSynchronize(
+  const Rc<DxvkDevice>&           device,
+  const BenchParams&              params) {
+  DxvkCsChunkPool pool;
+  DxvkCsThread    csThread(device, device->createContext());
+
+  std::vector<double> roundTrips(params.syncCount);
+
+  // Mirrors a map of a resource that was just written on the
+  // immediate context, which has to wait for the worker
+  for (uint32_t i = 0; i < params.syncCount; i++) {
+    DxvkCsChunkRef chunk = allocChunk(pool);
+
+    auto emptyCmd = [] (DxvkContext*) { };
+
+    for (uint32_t k = 0; k < params.commandCount; k++)
+      chunk->push(emptyCmd);
+
+    auto t0 = dxvk::high_resolution_clock::now();
+    csThread.synchronize(csThread.dispatchChunk(std::move(chunk)));
+    auto t1 = dxvk::high_resolution_clock::now();
+
+    roundTrips[i] = toNs(t0, t1);
+  }
+
+  printLatencies("Dispatch + synchronize:", roundTrips);
+}
+
+
+int main(int argc, char** argv) {
+  BenchParams params;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+
+    if ((arg == "-n" || arg == "-c" || arg == "-t" || arg == "-s") && i + 1 == argc) {
+      printUsage();
+      return 1;
+    }
+
+    if (arg == "-n") {
+      params.chunkCount = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "-c") {
+      params.commandCount = std::clamp(std::atoi(argv[++i]), 1, 256);
+    } else if (arg == "-t") {
+      params.threadCount = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "-s") {
+      params.syncCount = std::max(1, std::atoi(argv[++i]));
+    } else {
+      printUsage();
+      return arg == "-h" || arg == "--help" ? 0 : 1;
+    }
+  }
+
+  try {
+    Rc<DxvkDevice> device = createBenchDevice();
+
+    runDispatch(device, params);
+    runSynchronize(device, params);
+  } catch (const DxvkError& e) {
+    std::cerr << e.message() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,306 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../dxvk/dxvk_lifetime.h"
+
+#include "../util/util_time.h"
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-lifetime-bench.log");
+}
+
+using namespace dxvk;
+
+/**
+ * \brief Resource that only exists to be tracked
+ */
+class BenchResource : public DxvkResource { };
+
+/**
+ * \brief Lifetime tracker as used previously
+ *
+ * Takes a new reference and acquires the resource on
+ * every call, and releases both again when the command
+ * list is reset, even if the resource is already tracked.
+ */
+class BenchLegacyTracker {
+
+public:
+
+  template<DxvkAccess Access>
+  void trackResource(Rc<DxvkResource> rc) {
+    rc->acquire(Access);
+    m_resources.emplace_back(std::move(rc), Access);
+  }
+
+  size_t count() const {
+    return m_resources.size();
+  }
+
+  void notify() {
+    for (const auto& resource : m_resources)
+      resource.first->release(resource.second);
+  }
+
+  void reset() {
+    m_resources.clear();
+  }
+
+private:
+
+  std::vector<std::pair<Rc<DxvkResource>, DxvkAccess>> m_resources;
+
+};
+
+/**
+ * \brief Resources bound by a draw
+ */
+struct BenchDraw {
+  Rc<BenchResource> vertexBuffer;
+  Rc<BenchResource> indexBuffer;
+  Rc<BenchResource> textureViews[2];
+  Rc<BenchResource> textures[2];
+};
+
+/**
+ * \brief Resources used by every draw of a frame
+ */
+struct BenchFrame {
+  Rc<BenchResource> constantBuffers[2];
+  Rc<BenchResource> renderTargetView;
+  Rc<BenchResource> renderTarget;
+};
+
+/**
+ * \brief Benchmark parameters
+ */
+struct BenchParams {
+  uint32_t cmdListCount = 1000;
+  uint32_t drawCount    = 500;
+  uint32_t meshCount    = 64;
+  uint32_t textureCount = 256;
+};
+
+/**
+ * \brief Results for one tracker
+ */
+struct BenchResult {
+  double ns             = 0.0;
+  double tracks         = 0.0;
+  double atomicEstimate = 0.0;
+};
+
+
+static void printUsage() {
+  std::cerr
+    << "Usage: dxvk-lifetime-bench [options]" << std::endl
+    << std::endl
+    << "Replays the resource tracking done by DxvkContext for a sequence of" << std::endl
+    << "draws, each of which binds a vertex and index buffer, two constant" << std::endl
+    << "buffers, two textures and a render target. Compares the previous" << std::endl
+    << "tracker, which tracked every binding, with DxvkLifetimeTracker, which" << std::endl
+    << "tracks each resource once per command list." << std::endl
+    << std::endl
+    << "Atomic read-modify-write operations are not counted directly. They are" << std::endl
+    << "estimated from the number of tracked views and resources, since each" << std::endl
+    << "tracked view costs two and each tracked resource four such operations." << std::endl
+    << std::endl
+    << "Options:" << std::endl
+    << "  -c <count>        Number of command lists. Default: 1000" << std::endl
+    << "  -d <draws>        Number of draws per command list. Default: 500" << std::endl
+    << "  -m <count>        Number of distinct meshes. Default: 64" << std::endl
+    << "  -t <count>        Number of distinct textures. Default: 256" << std::endl;
+}
+
+
+template<typename Tracker>
+static void trackDraw(
+        Tracker&                  tracker,
+  const BenchFrame&               frame,
+  const BenchDraw&                draw,
+        bool                      views,
+        bool                      resources) {
+  // Same calls that DxvkContext makes when committing
+  // graphics state and shader resources for a draw
+  if (resources) {
+    tracker.template trackResource<DxvkAccess::Read>(draw.vertexBuffer);
+    tracker.template trackResource<DxvkAccess::Read>(draw.indexBuffer);
+
+    for (const auto& buffer : frame.constantBuffers)
+      tracker.template trackResource<DxvkAccess::Read>(buffer);
+  }
+
+  for (uint32_t i = 0; i < 2; i++) {
+    if (views)
+      tracker.template trackResource<DxvkAccess::None>(draw.textureViews[i]);
+    if (resources)
+      tracker.template trackResource<DxvkAccess::Read>(draw.textures[i]);
+  }
+
+  if (views)
+    tracker.template trackResource<DxvkAccess::None>(frame.renderTargetView);
+  if (resources)
+    tracker.template trackResource<DxvkAccess::Write>(frame.renderTarget);
+}
+
+
+template<typename Tracker>
+static double replayDraws(
+  const BenchParams&              params,
+  const BenchFrame&               frame,
+  const std::vector<BenchDraw>&   draws,
+        bool                      views,
+        bool                      resources) {
+  Tracker tracker;
+
+  double trackCount = 0.0;
+
+  for (uint32_t i = 0; i < params.cmdListCount; i++) {
+    for (uint32_t j = 0; j < params.drawCount; j++)
+      trackDraw(tracker, frame, draws[(i * params.drawCount + j) % draws.size()], views, resources);
+
+    // Mirrors what the device does once the command list completes
+    trackCount += double(tracker.count());
+    tracker.notify();
+    tracker.reset();
+  }
+
+  return trackCount;
+}
+
+
+template<typename Tracker>
+static BenchResult runReplay(
+  const BenchParams&              params,
+  const BenchFrame&               frame,
+  const std::vector<BenchDraw>&   draws,
+        uint32_t                  resetAtomics) {
+  BenchResult result;
+
+  double drawCount = double(params.cmdListCount) * double(params.drawCount);
+
+  auto t0 = dxvk::high_resolution_clock::now();
+  double trackCount = replayDraws<Tracker>(params, frame, draws, true, true);
+  auto t1 = dxvk::high_resolution_clock::now();
+
+  // The resource methods are not virtual, so atomic operations cannot
+  // be intercepted and are estimated instead. Tracking is done per
+  // access type, so views and resources can be counted separately.
+  // Every tracked object has its reference count incremented and
+  // decremented once, resources also have their use count incremented
+  // and decremented once. Views are tracked without an access type
+  // and have no use count.
+  double viewCount     = replayDraws<Tracker>(params, frame, draws, true, false);
+  double resourceCount = replayDraws<Tracker>(params, frame, draws, false, true);
+
+  result.ns             = std::chrono::duration<double, std::nano>(t1 - t0).count() / drawCount;
+  result.tracks         = trackCount / drawCount;
+  result.atomicEstimate = (2.0 * viewCount + 4.0 * resourceCount
+    + double(resetAtomics) * double(params.cmdListCount)) / drawCount;
+  return result;
+}
+
+
+static void printResult(const char* name, const BenchResult& result) {
+  std::cout
+    << std::setw(10) << name                  << " "
+    << std::fixed    << std::setprecision(2)
+    << std::setw(14) << result.tracks         << " "
+    << std::setw(14) << result.atomicEstimate << " "
+    << std::setw(14) << result.ns             << std::endl;
+}
+
+
+int main(int argc, char** argv) {
+  BenchParams params;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+
+    if ((arg == "-c" || arg == "-d" || arg == "-m" || arg == "-t") && i + 1 == argc) {
+      printUsage();
+      return 1;
+    }
+
+    if (arg == "-c") {
+      params.cmdListCount = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "-d") {
+      params.drawCount = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "-m") {
+      params.meshCount = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "-t") {
+      params.textureCount = std::max(1, std::atoi(argv[++i]));
+    } else {
+      printUsage();
+      return arg == "-h" || arg == "--help" ? 0 : 1;
+    }
+  }
+
+  std::vector<Rc<BenchResource>> vertexBuffers(params.meshCount);
+  std::vector<Rc<BenchResource>> indexBuffers(params.meshCount);
+  std::vector<Rc<BenchResource>> textureViews(params.textureCount);
+  std::vector<Rc<BenchResource>> textures(params.textureCount);
+
+  for (uint32_t i = 0; i < params.meshCount; i++) {
+    vertexBuffers[i] = new BenchResource();
+    indexBuffers[i]  = new BenchResource();
+  }
+
+  for (uint32_t i = 0; i < params.textureCount; i++) {
+    textureViews[i] = new BenchResource();
+    textures[i]     = new BenchResource();
+  }
+
+  BenchFrame frame;
+
+  for (auto& buffer : frame.constantBuffers)
+    buffer = new BenchResource();
+
+  frame.renderTargetView = new BenchResource();
+  frame.renderTarget     = new BenchResource();
+
+  // Draws pick meshes and textures at random, the same
+  // sequence is used for both trackers for a fair comparison
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<uint32_t> meshDist(0, params.meshCount - 1);
+  std::uniform_int_distribution<uint32_t> textureDist(0, params.textureCount - 1);
+
+  std::vector<BenchDraw> draws(params.drawCount * 16);
+
+  for (auto& draw : draws) {
+    uint32_t mesh = meshDist(rng);
+    draw.vertexBuffer = vertexBuffers[mesh];
+    draw.indexBuffer  = indexBuffers[mesh];
+
+    for (uint32_t i = 0; i < 2; i++) {
+      uint32_t texture = textureDist(rng);
+      draw.textureViews[i] = textureViews[texture];
+      draw.textures[i]     = textures[texture];
+    }
+  }
+
+  // The previous tracker did no atomic operations on reset,
+  // the current one takes a new tracking ID from a counter
+  BenchResult legacy  = runReplay<BenchLegacyTracker> (params, frame, draws, 0);
+  BenchResult tracker = runReplay<DxvkLifetimeTracker>(params, frame, draws, 1);
+
+  std::cout
+    << params.drawCount << " draws per command list, "
+    << params.meshCount << " meshes, "
+    << params.textureCount << " textures" << std::endl
+    << std::setw(10) << "Tracker"       << " "
+    << std::setw(14) << "Tracked/draw"  << " "
+    << std::setw(14) << "Est. atomics"  << " "
+    << std::setw(14) << "Time (ns)"     << std::endl;
+
+  printResult("Legacy",  legacy);
+  printResult("Current", tracker);
+  return 0;
+}
@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../dxvk/dxvk_memory.h"
+
+#include "../util/util_time.h"
+
+#include "dxvk_bench_device.h"
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-memory-bench.log");
+}
+
+using namespace dxvk;
+
+/**
+ * \brief Single operation of an allocation trace
+ */
+struct BenchOp {
+  bool          alloc;
+  uint32_t      slot;
+  VkDeviceSize  size;
+  VkDeviceSize  align;
+};
+
+/**
+ * \brief Benchmark parameters
+ */
+struct BenchParams {
+  uint32_t      opCount   = 1000000;
+  uint32_t      liveCount = 4000;
+  VkDeviceSize  minSize   = 16  << 10;
+  VkDeviceSize  maxSize   = 256 << 10;
+  uint32_t      seed      = 1;
+};
+
+
+static void printUsage() {
+  std::cerr
+    << "Usage: dxvk-memory-bench [options]" << std::endl
+    << std::endl
+    << "Replays a synthetic trace of device memory allocations and frees," << std::endl
+    << "similar to a game streaming in textures and buffers, through the" << std::endl
+    << "DXVK memory allocator. Reports the time per operation as well as" << std::endl
+    << "how much of the allocated device memory is actually in use." << std::endl
+    << "Requires a Vulkan device." << std::endl
+    << std::endl
+    << "Options:" << std::endl
+    << "  -n <ops>          Number of operations in the trace. Default: 1000000" << std::endl
+    << "  -l <count>        Maximum number of live allocations. Default: 4000" << std::endl
+    << "  -s <min> <max>    Allocation size range, in KiB. Default: 16 256" << std::endl
+    << "  -r <seed>         Random seed for the trace. Default: 1" << std::endl;
+}
+
+
+static std::vector<BenchOp> generateTrace(const BenchParams& params) {
+  std::mt19937 rng(params.seed);
+  std::uniform_real_distribution<double> dist(0.0, 1.0);
+
+  std::vector<BenchOp>  trace;
+  std::vector<uint32_t> liveSlots;
+  std::vector<uint32_t> freeSlots;
+
+  trace.reserve(params.opCount);
+
+  uint32_t slotCount = 0;
+
+  double logMin = std::log(double(params.minSize));
+  double logMax = std::log(double(params.maxSize));
+
+  for (uint32_t i = 0; i < params.opCount; i++) {
+    // Fill up to half the live count first, then randomly
+    // allocate and free resources so that chunks fragment
+    bool alloc = liveSlots.size() < params.liveCount / 2
+      || (liveSlots.size() < params.liveCount && dist(rng) < 0.5);
+
+    if (alloc) {
+      uint32_t slot = slotCount;
+
+      if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+      } else {
+        slotCount += 1;
+      }
+
+      // Sizes are log-uniform, alignments are picked to
+      // resemble a mix of buffers, small and large images
+      BenchOp op;
+      op.alloc = true;
+      op.slot  = slot;
+      op.size  = align(VkDeviceSize(std::exp(logMin + dist(rng) * (logMax - logMin))), 256);
+
+      double alignType = dist(rng);
+      op.align = alignType < 0.5 ? 256 : (alignType < 0.7 ? 4096 : 65536);
+
+      trace.push_back(op);
+      liveSlots.push_back(slot);
+    } else {
+      size_t index = std::min(liveSlots.size() - 1, size_t(dist(rng) * double(liveSlots.size())));
+
+      BenchOp op;
+      op.alloc = false;
+      op.slot  = liveSlots[index];
+      op.size  = 0;
+      op.align = 0;
+
+      trace.push_back(op);
+      freeSlots.push_back(op.slot);
+
+      liveSlots[index] = liveSlots.back();
+      liveSlots.pop_back();
+    }
+  }
+
+  return trace;
+}
+
+
+static uint32_t findDeviceLocalHeap(const Rc<DxvkDevice>& device) {
+  VkPhysicalDeviceMemoryProperties memProps = device->adapter()->memoryProperties();
+
+  for (uint32_t i = 0; i < memProps.memoryTypeCount; i++) {
+    if (memProps.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+      return memProps.memoryTypes[i].heapIndex;
+  }
+
+  return 0;
+}
+
+
+int main(int argc, char** argv) {
+  BenchParams params;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+
+    if ((arg == "-n" || arg == "-l" || arg == "-r") && i + 1 == argc) {
+      printUsage();
+      return 1;
+    }
+
+    if (arg == "-s" && i + 2 >= argc) {
+      printUsage();
+      return 1;
+    }
+
+    if (arg == "-n") {
+      params.opCount = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "-l") {
+      params.liveCount = std::max(2, std::atoi(argv[++i]));
+    } else if (arg == "-s") {
+      params.minSize = VkDeviceSize(std::max(1, std::atoi(argv[++i]))) << 10;
+      params.maxSize = VkDeviceSize(std::max(1, std::atoi(argv[++i]))) << 10;
+      params.maxSize = std::max(params.minSize, params.maxSize);
+    } else if (arg == "-r") {
+      params.seed = uint32_t(std::atoi(argv[++i]));
+    } else {
+      printUsage();
+      return arg == "-h" || arg == "--help" ? 0 : 1;
+    }
+  }
+
+  try {
+    Rc<DxvkDevice> device = createBenchDevice();
+
+    std::vector<BenchOp> trace = generateTrace(params);
+
+    // Use a separate allocator so that the stats
+    // only include the allocations of the trace
+    DxvkMemoryAllocator allocator(device.ptr());
+    uint32_t heap = findDeviceLocalHeap(device);
+
+    std::vector<DxvkMemory> slots(params.liveCount);
+
+    VkMemoryRequirements memReq = { };
+    memReq.memoryTypeBits = ~0u;
+
+    VkMemoryDedicatedRequirements dedicatedReq = { };
+    dedicatedReq.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+    VkMemoryDedicatedAllocateInfo dedicatedInfo = { };
+    dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+
+    double allocNs = 0.0;
+    double freeNs  = 0.0;
+
+    uint32_t allocCount = 0;
+    uint32_t freeCount  = 0;
+
+    VkDeviceSize peakAllocated = 0;
+    VkDeviceSize peakUsed      = 0;
+    double       unusedSum     = 0.0;
+    uint32_t     unusedSamples = 0;
+
+    for (size_t i = 0; i < trace.size(); i++) {
+      const BenchOp& op = trace[i];
+
+      auto t0 = dxvk::high_resolution_clock::now();
+
+      if (op.alloc) {
+        memReq.size      = op.size;
+        memReq.alignment = op.align;
+
+        slots[op.slot] = allocator.alloc(&memReq, dedicatedReq, dedicatedInfo,
+          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, DxvkMemoryFlag::GpuReadable);
+      } else {
+        slots[op.slot] = DxvkMemory();
+      }
+
+      auto t1 = dxvk::high_resolution_clock::now();
+      double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+
+      if (op.alloc) {
+        allocNs    += ns;
+        allocCount += 1;
+      } else {
+        freeNs    += ns;
+        freeCount += 1;
+      }
+
+      // Sample fragmentation periodically, querying
+      // stats takes the lock of every memory type
+      if (i % 1000 == 999) {
+        DxvkMemoryStats stats = allocator.getMemoryStats(heap);
+
+        peakAllocated = std::max(peakAllocated, stats.memoryAllocated);
+        peakUsed      = std::max(peakUsed,      stats.memoryUsed);
+
+        if (stats.memoryAllocated) {
+          unusedSum     += double(stats.memoryFragmented) / double(stats.memoryAllocated);
+          unusedSamples += 1;
+        }
+      }
+    }
+
+    std::cout
+      << "Replayed " << trace.size() << " operations, up to " << params.liveCount
+      << " live allocations of " << (params.minSize >> 10) << " to " << (params.maxSize >> 10) << " KiB" << std::endl
+      << std::fixed << std::setprecision(1)
+      << "Alloc:                   " << (allocNs / double(std::max(allocCount, 1u))) << " ns" << std::endl
+      << "Free:                    " << (freeNs  / double(std::max(freeCount,  1u))) << " ns" << std::endl
+      << "Peak allocated:          " << (peakAllocated >> 20) << " MiB" << std::endl
+      << "Peak used:               " << (peakUsed      >> 20) << " MiB" << std::endl
+      << "Average unused:          " << (unusedSamples ? 100.0 * unusedSum / double(unusedSamples) : 0.0) << " %" << std::endl;
+  } catch (const DxvkError& e) {
+    std::cerr << e.message() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
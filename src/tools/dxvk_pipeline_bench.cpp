@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../dxvk/dxvk_graphics.h"
+#include "../dxvk/dxvk_hash.h"
+
+#include "../util/util_time.h"
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-pipeline-bench.log");
+}
+
+using namespace dxvk;
+
+/**
+ * \brief Pipeline instances for a single shader combination
+ *
+ * Mirrors the way DxvkGraphicsPipeline stores its instances,
+ * so that both the old linear search and the hash index can
+ * be measured on the same set of state vectors.
+ */
+struct BenchPipeline {
+  sync::List<DxvkGraphicsPipelineInstance>      instances;
+  sync::HashIndex<DxvkGraphicsPipelineInstance> index;
+};
+
+
+static void printUsage() {
+  std::cerr
+    << "Usage: dxvk-pipeline-bench [options]" << std::endl
+    << std::endl
+    << "Measures the cost of looking up a graphics pipeline instance by state" << std::endl
+    << "vector with the linear search used previously and with the lookup used" << std::endl
+    << "by DxvkGraphicsPipeline::findInstance, which falls back to a hash index" << std::endl
+    << "for pipelines with more than a few instances." << std::endl
+    << std::endl
+    << "Options:" << std::endl
+    << "  -m <count>        Maximum number of instances per pipeline. Default: 1024" << std::endl
+    << "  -n <lookups>      Number of lookups per measurement. Default: 1000000" << std::endl;
+}
+
+
+static size_t getInstanceHash(
+  const DxvkGraphicsPipelineStateInfo& state,
+  const DxvkRenderPass*                renderPass) {
+  // Must match DxvkGraphicsPipeline::getInstanceHash
+  DxvkHashState hash;
+  hash.add(state.hash());
+  hash.add(reinterpret_cast<uintptr_t>(renderPass));
+  return hash;
+}
+
+
+static DxvkGraphicsPipelineStateInfo getStateVector(uint32_t index) {
+  // Vary the parts of the state that typically differ between draws
+  // of d3d9 games, i.e. the vertex layout and the blend state, while
+  // keeping the remaining bytes identical so that every comparison
+  // has to look at most of the state vector.
+  DxvkGraphicsPipelineStateInfo state;
+  state.il = DxvkIlInfo(1 + (index % 8), 1);
+
+  for (uint32_t i = 0; i < state.il.attributeCount(); i++) {
+    state.ilAttributes[i] = DxvkIlAttribute(i, 0,
+      VK_FORMAT_R32G32B32A32_SFLOAT, 16 * i);
+  }
+
+  state.ilBindings[0] = DxvkIlBinding(0, 16 * state.il.attributeCount(),
+    VK_VERTEX_INPUT_RATE_VERTEX, 0);
+
+  state.omBlend[0] = DxvkOmAttachmentBlend((index / 8) % 2,
+    VkBlendFactor(VK_BLEND_FACTOR_ONE + (index / 16) % 8),
+    VkBlendFactor(VK_BLEND_FACTOR_ZERO + (index / 128) % 8),
+    VK_BLEND_OP_ADD, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO,
+    VK_BLEND_OP_ADD, 0xF);
+
+  state.sc.specConstants[DxvkLimits::MaxNumSpecConstants - 1] = index / 1024;
+  return state;
+}
+
+
+static DxvkGraphicsPipelineInstance* findLinear(
+  const BenchPipeline&                 pipeline,
+  const DxvkGraphicsPipelineStateInfo& state,
+  const DxvkRenderPass*                renderPass) {
+  for (auto& instance : pipeline.instances) {
+    if (instance.isCompatible(state, renderPass))
+      return &instance;
+  }
+
+  return nullptr;
+}
+
+
+static DxvkGraphicsPipelineInstance* findIndexed(
+  const BenchPipeline&                 pipeline,
+  const DxvkGraphicsPipelineStateInfo& state,
+  const DxvkRenderPass*                renderPass) {
+  // Must match DxvkGraphicsPipeline::findInstance
+  constexpr uint32_t MaxLinearSearchCount = 4;
+
+  uint32_t count = 0;
+
+  for (auto& instance : pipeline.instances) {
+    if (instance.isCompatible(state, renderPass))
+      return &instance;
+
+    if (++count == MaxLinearSearchCount)
+      break;
+  }
+
+  if (count < MaxLinearSearchCount)
+    return nullptr;
+
+  return pipeline.index.find(getInstanceHash(state, renderPass),
+    [&state, renderPass] (const DxvkGraphicsPipelineInstance& instance) {
+      return instance.isCompatible(state, renderPass);
+    });
+}
+
+
+template<typename Fn>
+static double measureLookups(
+  const BenchPipeline&                              pipeline,
+  const std::vector<DxvkGraphicsPipelineStateInfo>& states,
+  const std::vector<uint32_t>&                      lookups,
+  const DxvkRenderPass*                             renderPass,
+  const Fn&                                         fn) {
+  size_t found = 0;
+
+  auto t0 = dxvk::high_resolution_clock::now();
+
+  for (uint32_t index : lookups)
+    found += fn(pipeline, states[index], renderPass) != nullptr;
+
+  auto t1 = dxvk::high_resolution_clock::now();
+
+  if (found != lookups.size())
+    std::cerr << "Lookup failed for " << (lookups.size() - found) << " states" << std::endl;
+
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / double(lookups.size());
+}
+
+
+int main(int argc, char** argv) {
+  uint32_t maxCount    = 1024;
+  uint32_t lookupCount = 1000000;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+
+    if ((arg == "-m" || arg == "-n") && i + 1 == argc) {
+      printUsage();
+      return 1;
+    }
+
+    if (arg == "-m") {
+      maxCount = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "-n") {
+      lookupCount = std::max(1, std::atoi(argv[++i]));
+    } else {
+      printUsage();
+      return arg == "-h" || arg == "--help" ? 0 : 1;
+    }
+  }
+
+  // The render pass is only compared by address
+  auto renderPass = reinterpret_cast<const DxvkRenderPass*>(uintptr_t(0x1000));
+
+  std::vector<DxvkGraphicsPipelineStateInfo> states;
+  states.reserve(maxCount);
+
+  for (uint32_t i = 0; i < maxCount; i++)
+    states.push_back(getStateVector(i));
+
+  std::cout
+    << std::setw(10) << "Instances"   << " "
+    << std::setw(14) << "Linear (ns)" << " "
+    << std::setw(14) << "Index (ns)"  << " "
+    << std::setw(10) << "Speedup"     << std::endl;
+
+  for (uint32_t count = 1; count <= maxCount; count *= 4) {
+    BenchPipeline pipeline;
+
+    for (uint32_t i = 0; i < count; i++) {
+      auto instance = &(*pipeline.instances.emplace(states[i], renderPass, VkPipeline(VK_NULL_HANDLE)));
+      pipeline.index.insert(getInstanceHash(states[i], renderPass), instance);
+    }
+
+    // Look up existing instances in random order, the same
+    // sequence is used for both methods for a fair comparison
+    std::mt19937 rng(count);
+    std::uniform_int_distribution<uint32_t> dist(0, count - 1);
+
+    std::vector<uint32_t> lookups(lookupCount);
+
+    for (auto& index : lookups)
+      index = dist(rng);
+
+    double linear  = measureLookups(pipeline, states, lookups, renderPass, &findLinear);
+    double indexed = measureLookups(pipeline, states, lookups, renderPass, &findIndexed);
+
+    std::cout
+      << std::setw(10) << count   << " "
+      << std::fixed    << std::setprecision(1)
+      << std::setw(14) << linear  << " "
+      << std::setw(14) << indexed << " "
+      << std::setw(9)  << (linear / indexed) << "x" << std::endl;
+  }
+
+  return 0;
+}
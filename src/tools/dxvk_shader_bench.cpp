@@ -0,0 +1,427 @@
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "../dxbc/dxbc_module.h"
+#include "../dxbc/dxbc_reader.h"
+
+#include "../dxso/dxso_modinfo.h"
+#include "../dxso/dxso_module.h"
+#include "../dxso/dxso_reader.h"
+
+#include "../spirv/spirv_compression.h"
+
+#include "../util/config/config.h"
+#include "../util/thread.h"
+#include "../util/util_time.h"
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-shader-bench.log");
+}
+
+using namespace dxvk;
+
+namespace fs = std::filesystem;
+
+/**
+ * \brief Shader file type
+ */
+enum class BenchShaderType {
+  Dxbc,
+  Dxso,
+};
+
+/**
+ * \brief Shader file loaded from disk
+ */
+struct BenchShader {
+  std::string       name;
+  BenchShaderType   type;
+  std::vector<char> data;
+};
+
+/**
+ * \brief Compilation result for a single shader
+ */
+struct BenchResult {
+  bool      success        = false;
+  double    compileTimeUs  = 0.0;
+  size_t    spirvSize      = 0;
+  size_t    compressedSize = 0;
+  std::string error;
+};
+
+/**
+ * \brief Compiler options used for all shaders
+ */
+struct BenchOptions {
+  DxbcModuleInfo      dxbcInfo  = { };
+  DxsoModuleInfo      dxsoInfo  = { };
+  D3D9ConstantLayout  vsLayout  = { };
+  D3D9ConstantLayout  psLayout  = { };
+};
+
+
+static void printUsage() {
+  std::cerr
+    << "Usage: dxvk-shader-bench [options] <file or directory>..." << std::endl
+    << std::endl
+    << "Compiles .dxbc and .dxso files, e.g. as written by DXVK_SHADER_DUMP_PATH," << std::endl
+    << "and reports compile time, SPIR-V size and compressed size per shader." << std::endl
+    << std::endl
+    << "Options:" << std::endl
+    << "  -o <key>=<value>  Sets a compiler option, e.g. dxbc.useSdivForBufferIndex=True" << std::endl
+    << "                    or dxso.floatEmulation=Strict. Options are named after the" << std::endl
+    << "                    fields of DxbcOptions and DxsoOptions." << std::endl
+    << "  -t <threads>      Runs a throughput benchmark with the given number of worker" << std::endl
+    << "                    threads instead of reporting individual shaders. Use 0 to" << std::endl
+    << "                    use one thread per CPU core." << std::endl
+    << "  -n <iterations>   Compiles each shader the given number of times." << std::endl;
+}
+
+
+static BenchOptions getBenchOptions(const Config& config) {
+  BenchOptions result;
+
+  // Default to what a reasonably modern driver would support
+  DxbcOptions& dxbc = result.dxbcInfo.options;
+  dxbc.useDepthClipWorkaround             = config.getOption<bool>("dxbc.useDepthClipWorkaround",             false);
+  dxbc.useStorageImageReadWithoutFormat   = config.getOption<bool>("dxbc.useStorageImageReadWithoutFormat",   true);
+  dxbc.useSubgroupOpsForAtomicCounters    = config.getOption<bool>("dxbc.useSubgroupOpsForAtomicCounters",    true);
+  dxbc.useDemoteToHelperInvocation        = config.getOption<bool>("dxbc.useDemoteToHelperInvocation",        true);
+  dxbc.useSubgroupOpsForEarlyDiscard      = config.getOption<bool>("dxbc.useSubgroupOpsForEarlyDiscard",      true);
+  dxbc.useSdivForBufferIndex              = config.getOption<bool>("dxbc.useSdivForBufferIndex",              false);
+  dxbc.enableRtOutputNanFixup             = config.getOption<bool>("dxbc.enableRtOutputNanFixup",             false);
+  dxbc.dynamicIndexedConstantBufferAsSsbo = config.getOption<bool>("dxbc.dynamicIndexedConstantBufferAsSsbo", false);
+  dxbc.zeroInitWorkgroupMemory            = config.getOption<bool>("dxbc.zeroInitWorkgroupMemory",            false);
+  dxbc.invariantPosition                  = config.getOption<bool>("dxbc.invariantPosition",                  true);
+  dxbc.forceTgsmBarriers                  = config.getOption<bool>("dxbc.forceTgsmBarriers",                  false);
+  dxbc.disableMsaa                        = config.getOption<bool>("dxbc.disableMsaa",                        false);
+  dxbc.optimizeSpirv                      = config.getOption<bool>("dxbc.optimizeSpirv",                      false);
+  dxbc.minSsboAlignment                   = config.getOption<int32_t>("dxbc.minSsboAlignment",                16);
+
+  if (config.getOption<bool>("dxbc.preserveNan32", false))
+    dxbc.floatControl.set(DxbcFloatControlFlag::PreserveNan32);
+  if (config.getOption<bool>("dxbc.preserveNan64", false))
+    dxbc.floatControl.set(DxbcFloatControlFlag::PreserveNan64);
+  if (config.getOption<bool>("dxbc.denormFlushToZero32", false))
+    dxbc.floatControl.set(DxbcFloatControlFlag::DenormFlushToZero32);
+  if (config.getOption<bool>("dxbc.denormPreserve64", false))
+    dxbc.floatControl.set(DxbcFloatControlFlag::DenormPreserve64);
+
+  result.dxbcInfo.tess = nullptr;
+  result.dxbcInfo.xfb  = nullptr;
+
+  DxsoOptions& dxso = result.dxsoInfo.options;
+  dxso.useDemoteToHelperInvocation        = config.getOption<bool>("dxso.useDemoteToHelperInvocation",        true);
+  dxso.useSubgroupOpsForEarlyDiscard      = config.getOption<bool>("dxso.useSubgroupOpsForEarlyDiscard",      true);
+  dxso.strictConstantCopies               = config.getOption<bool>("dxso.strictConstantCopies",               false);
+  dxso.strictPow                          = config.getOption<bool>("dxso.strictPow",                          true);
+  dxso.shaderModel                        = config.getOption<int32_t>("dxso.shaderModel",                     3);
+  dxso.invariantPosition                  = config.getOption<bool>("dxso.invariantPosition",                  true);
+  dxso.forceSamplerTypeSpecConstants      = config.getOption<bool>("dxso.forceSamplerTypeSpecConstants",      false);
+  dxso.vertexFloatConstantBufferAsSSBO    = config.getOption<bool>("dxso.vertexFloatConstantBufferAsSSBO",    false);
+  dxso.longMad                            = config.getOption<bool>("dxso.longMad",                            false);
+  dxso.alphaTestWiggleRoom                = config.getOption<bool>("dxso.alphaTestWiggleRoom",                false);
+  dxso.robustness2Supported               = config.getOption<bool>("dxso.robustness2Supported",               true);
+
+  std::string floatEmulation = Config::toLower(config.getOption<std::string>("dxso.floatEmulation", "true"));
+
+  if (floatEmulation == "strict")
+    dxso.d3d9FloatEmulation = D3D9FloatEmulation::Strict;
+  else if (floatEmulation == "false")
+    dxso.d3d9FloatEmulation = D3D9FloatEmulation::Disabled;
+  else
+    dxso.d3d9FloatEmulation = D3D9FloatEmulation::Enabled;
+
+  // Matches D3D9DeviceEx::DetermineConstantLayouts
+  bool swvp = config.getOption<bool>("dxso.softwareVertexProcessing", false);
+
+  result.vsLayout.floatCount    = swvp ? caps::MaxFloatConstantsSoftware : caps::MaxFloatConstantsVS;
+  result.vsLayout.intCount      = swvp ? caps::MaxOtherConstantsSoftware : caps::MaxOtherConstants;
+  result.vsLayout.boolCount     = swvp ? caps::MaxOtherConstantsSoftware : caps::MaxOtherConstants;
+  result.vsLayout.bitmaskCount  = align(result.vsLayout.boolCount, 32) / 32;
+
+  result.psLayout.floatCount    = caps::MaxFloatConstantsPS;
+  result.psLayout.intCount      = caps::MaxOtherConstants;
+  result.psLayout.boolCount     = caps::MaxOtherConstants;
+  result.psLayout.bitmaskCount  = align(result.psLayout.boolCount, 32) / 32;
+  return result;
+}
+
+
+static bool loadShader(
+  const fs::path&                 path,
+        std::vector<BenchShader>& shaders) {
+  std::string ext = Config::toLower(path.extension().string());
+
+  BenchShader shader;
+  shader.name = path.stem().string();
+
+  if (ext == ".dxbc")
+    shader.type = BenchShaderType::Dxbc;
+  else if (ext == ".dxso")
+    shader.type = BenchShaderType::Dxso;
+  else
+    return false;
+
+  std::ifstream file(path, std::ios_base::binary);
+  shader.data.assign(
+    std::istreambuf_iterator<char>(file),
+    std::istreambuf_iterator<char>());
+
+  if (!file.eof() || shader.data.empty()) {
+    std::cerr << "Failed to read " << path.string() << std::endl;
+    return false;
+  }
+
+  shaders.push_back(std::move(shader));
+  return true;
+}
+
+
+static void collectShaders(
+  const fs::path&                 path,
+        std::vector<BenchShader>& shaders) {
+  std::error_code ec;
+
+  if (!fs::is_directory(path, ec)) {
+    if (!loadShader(path, shaders))
+      std::cerr << "Ignoring " << path.string() << std::endl;
+    return;
+  }
+
+  std::vector<fs::path> files;
+
+  for (const auto& entry : fs::recursive_directory_iterator(path, ec)) {
+    if (entry.is_regular_file(ec))
+      files.push_back(entry.path());
+  }
+
+  // Keep the output order stable across runs
+  std::sort(files.begin(), files.end());
+
+  for (const auto& file : files)
+    loadShader(file, shaders);
+}
+
+
+static void measureShader(
+  const Rc<DxvkShader>&           shader,
+        BenchResult&              result) {
+  if (shader == nullptr)
+    return;
+
+  std::stringstream stream;
+  shader->dump(stream);
+
+  SpirvCodeBuffer code(stream);
+  SpirvCompressedBuffer compressed(code);
+
+  result.spirvSize      += code.size();
+  result.compressedSize += compressed.size();
+}
+
+
+static BenchResult compileShader(
+  const BenchShader&              shader,
+  const BenchOptions&             options) {
+  BenchResult result;
+
+  try {
+    auto t0 = dxvk::high_resolution_clock::now();
+
+    if (shader.type == BenchShaderType::Dxbc) {
+      DxbcReader reader(shader.data.data(), shader.data.size());
+      DxbcModule module(reader);
+
+      Rc<DxvkShader> spirv = module.compile(options.dxbcInfo, shader.name);
+
+      auto t1 = dxvk::high_resolution_clock::now();
+      result.compileTimeUs = std::chrono::duration<double, std::micro>(t1 - t0).count();
+
+      measureShader(spirv, result);
+    } else {
+      DxsoReader reader(shader.data.data());
+      DxsoModule module(reader);
+
+      const D3D9ConstantLayout& layout = module.info().type() == DxsoProgramTypes::VertexShader
+        ? options.vsLayout
+        : options.psLayout;
+
+      DxsoAnalysisInfo analysis = module.analyze();
+      DxsoPermutations spirv = module.compile(options.dxsoInfo, shader.name, analysis, layout);
+
+      auto t1 = dxvk::high_resolution_clock::now();
+      result.compileTimeUs = std::chrono::duration<double, std::micro>(t1 - t0).count();
+
+      for (const auto& permutation : spirv)
+        measureShader(permutation, result);
+    }
+
+    result.success = true;
+  } catch (const DxvkError& e) {
+    result.error = e.message();
+  }
+
+  return result;
+}
+
+
+static int runPerShader(
+  const std::vector<BenchShader>& shaders,
+  const BenchOptions&             options,
+        uint32_t                  iterations) {
+  uint32_t failures = 0;
+
+  double totalTime  = 0.0;
+  size_t totalSpirv = 0;
+  size_t totalComp  = 0;
+
+  std::cout << std::left
+    << std::setw(48) << "Shader"       << " "
+    << std::right
+    << std::setw(12) << "Time (us)"    << " "
+    << std::setw(12) << "SPIR-V"       << " "
+    << std::setw(12) << "Compressed"   << std::endl;
+
+  for (const auto& shader : shaders) {
+    BenchResult result;
+    double time = 0.0;
+
+    for (uint32_t i = 0; i < iterations; i++) {
+      result = compileShader(shader, options);
+      time += result.compileTimeUs;
+    }
+
+    if (!result.success) {
+      std::cout << std::left << std::setw(48) << shader.name
+        << " failed: " << result.error << std::endl;
+      failures += 1;
+      continue;
+    }
+
+    time /= double(iterations);
+
+    std::cout << std::left
+      << std::setw(48) << shader.name             << " "
+      << std::right    << std::fixed << std::setprecision(1)
+      << std::setw(12) << time                    << " "
+      << std::setw(12) << result.spirvSize        << " "
+      << std::setw(12) << result.compressedSize   << std::endl;
+
+    totalTime  += time;
+    totalSpirv += result.spirvSize;
+    totalComp  += result.compressedSize;
+  }
+
+  std::cout << std::endl
+    << "Compiled " << (shaders.size() - failures) << " shaders"
+    << " (" << failures << " failed)" << std::endl
+    << "Total time:      " << std::fixed << std::setprecision(1) << (totalTime / 1000.0) << " ms" << std::endl
+    << "Total SPIR-V:    " << totalSpirv << " bytes" << std::endl
+    << "Total compressed: " << totalComp << " bytes" << std::endl;
+
+  return failures ? 1 : 0;
+}
+
+
+static int runThroughput(
+  const std::vector<BenchShader>& shaders,
+  const BenchOptions&             options,
+        uint32_t                  iterations,
+        uint32_t                  threadCount) {
+  if (!threadCount)
+    threadCount = dxvk::thread::hardware_concurrency();
+
+  size_t jobCount = shaders.size() * iterations;
+
+  std::atomic<size_t>   nextJob  = { 0u };
+  std::atomic<uint32_t> failures = { 0u };
+
+  std::vector<dxvk::thread> threads;
+  threads.reserve(threadCount);
+
+  auto t0 = dxvk::high_resolution_clock::now();
+
+  for (uint32_t i = 0; i < threadCount; i++) {
+    threads.emplace_back([&] {
+      size_t job;
+
+      while ((job = nextJob++) < jobCount) {
+        if (!compileShader(shaders[job % shaders.size()], options).success)
+          failures += 1;
+      }
+    });
+  }
+
+  for (auto& thread : threads)
+    thread.join();
+
+  auto t1 = dxvk::high_resolution_clock::now();
+  double seconds = std::chrono::duration<double>(t1 - t0).count();
+
+  std::cout
+    << "Compiled " << jobCount << " shaders on " << threadCount << " threads"
+    << " (" << failures.load() << " failed)" << std::endl
+    << "Total time:      " << std::fixed << std::setprecision(1) << (seconds * 1000.0) << " ms" << std::endl
+    << "Throughput:      " << std::fixed << std::setprecision(1) << (double(jobCount) / seconds) << " shaders/s" << std::endl;
+
+  return failures.load() ? 1 : 0;
+}
+
+
+int main(int argc, char** argv) {
+  Config config;
+
+  std::vector<BenchShader> shaders;
+
+  uint32_t iterations   = 1;
+  int32_t  threadCount  = -1;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+
+    if ((arg == "-o" || arg == "-t" || arg == "-n") && i + 1 == argc) {
+      printUsage();
+      return 1;
+    }
+
+    if (arg == "-o") {
+      std::string option = argv[++i];
+      size_t pos = option.find('=');
+
+      if (pos == std::string::npos) {
+        std::cerr << "Invalid option: " << option << std::endl;
+        return 1;
+      }
+
+      config.setOption(option.substr(0, pos), option.substr(pos + 1));
+    } else if (arg == "-t") {
+      threadCount = std::max(0, std::atoi(argv[++i]));
+    } else if (arg == "-n") {
+      iterations = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "-h" || arg == "--help") {
+      printUsage();
+      return 0;
+    } else {
+      collectShaders(fs::path(arg), shaders);
+    }
+  }
+
+  if (shaders.empty()) {
+    printUsage();
+    return 1;
+  }
+
+  BenchOptions options = getBenchOptions(config);
+
+  return threadCount < 0
+    ? runPerShader(shaders, options, iterations)
+    : runThroughput(shaders, options, iterations, uint32_t(threadCount));
+}
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../spirv/spirv_module.h"
+
+#include "../util/util_time.h"
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-spirv-bench.log");
+}
+
+using namespace dxvk;
+
+using BenchTime = dxvk::high_resolution_clock::time_point;
+
+
+static void printUsage() {
+  std::cerr
+    << "Usage: dxvk-spirv-bench [options]" << std::endl
+    << std::endl
+    << "Measures the cost of declaring SPIR-V constants for growing numbers of" << std::endl
+    << "unique constants in a module, similar to large shaders with many" << std::endl
+    << "immediate values. Compares the lookup of existing constants done by" << std::endl
+    << "SpirvModule with a linear search over all type and constant" << std::endl
+    << "declarations, which was used previously." << std::endl
+    << std::endl
+    << "Options:" << std::endl
+    << "  -m <count>        Maximum number of unique constants. Default: 16384" << std::endl
+    << "  -n <lookups>      Number of lookups per measurement. Default: 20000" << std::endl;
+}
+
+
+static double toNs(BenchTime t0, BenchTime t1) {
+  return std::chrono::duration<double, std::nano>(t1 - t0).count();
+}
+
+
+static uint32_t findLinear(
+        SpirvCodeBuffer&          code,
+        uint32_t                  typeId,
+        uint32_t                  value) {
+  // Mirrors the linear search previously done by SpirvModule::defConst.
+  // The compiled module only adds a few header instructions on top of
+  // the type and constant declarations, since there are no functions.
+  for (auto ins : code) {
+    bool match = ins.opCode() == spv::OpConstant
+              && ins.length() == 4
+              && ins.arg(1)   == typeId
+              && ins.arg(3)   == value;
+
+    if (match)
+      return ins.arg(2);
+  }
+
+  return 0;
+}
+
+
+int main(int argc, char** argv) {
+  uint32_t maxCount    = 16384;
+  uint32_t lookupCount = 20000;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+
+    if ((arg == "-m" || arg == "-n") && i + 1 == argc) {
+      printUsage();
+      return 1;
+    }
+
+    if (arg == "-m") {
+      maxCount = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "-n") {
+      lookupCount = std::max(1, std::atoi(argv[++i]));
+    } else {
+      printUsage();
+      return arg == "-h" || arg == "--help" ? 0 : 1;
+    }
+  }
+
+  std::cout
+    << std::setw(10) << "Constants"    << " "
+    << std::setw(14) << "Declare (ns)" << " "
+    << std::setw(14) << "Lookup (ns)"  << " "
+    << std::setw(14) << "Linear (ns)"  << " "
+    << std::setw(10) << "Speedup"      << std::endl;
+
+  for (uint32_t count = 256; count <= maxCount; count *= 4) {
+    SpirvModule module(spvVersion(1, 3));
+
+    // Declaring a unique constant has to look for an existing
+    // declaration first, so this measures failed lookups
+    auto t0 = dxvk::high_resolution_clock::now();
+
+    for (uint32_t i = 0; i < count; i++)
+      module.constu32(i);
+
+    auto t1 = dxvk::high_resolution_clock::now();
+
+    // Look up existing constants in random order, the same
+    // sequence is used for both methods for a fair comparison
+    std::mt19937 rng(count);
+    std::uniform_int_distribution<uint32_t> dist(0, count - 1);
+
+    std::vector<uint32_t> lookups(lookupCount);
+
+    for (auto& value : lookups)
+      value = dist(rng);
+
+    uint32_t typeId = module.defIntType(32, 0);
+    uint32_t idSum  = 0;
+
+    auto t2 = dxvk::high_resolution_clock::now();
+
+    for (uint32_t value : lookups)
+      idSum += module.constu32(value);
+
+    auto t3 = dxvk::high_resolution_clock::now();
+
+    SpirvCodeBuffer code = module.compile();
+
+    auto t4 = dxvk::high_resolution_clock::now();
+
+    for (uint32_t value : lookups)
+      idSum -= findLinear(code, typeId, value);
+
+    auto t5 = dxvk::high_resolution_clock::now();
+
+    if (idSum)
+      std::cerr << "Lookups returned different constant IDs" << std::endl;
+
+    double declare = toNs(t0, t1) / double(count);
+    double indexed = toNs(t2, t3) / double(lookupCount);
+    double linear  = toNs(t4, t5) / double(lookupCount);
+
+    std::cout
+      << std::setw(10) << count   << " "
+      << std::fixed    << std::setprecision(1)
+      << std::setw(14) << declare << " "
+      << std::setw(14) << indexed << " "
+      << std::setw(14) << linear  << " "
+      << std::setw(9)  << (linear / indexed) << "x" << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace dxvk::sync {
+
+  /**
+   * \brief Lock-free hash index
+   *
+   * Maps hashes to objects that are owned elsewhere and
+   * must outlive the index. Lookups are lock-free and may
+   * run concurrently with insertions, but insertions must
+   * be serialized externally.
+   *
+   * Uses open addressing with linear probing. Tables that
+   * are replaced when the index grows are kept alive until
+   * the index gets destroyed since readers may still be
+   * accessing them, which at most doubles memory usage.
+   */
+  template<typename T>
+  class HashIndex {
+
+    struct Entry {
+      std::atomic<size_t> hash    = { 0 };
+      std::atomic<T*>     object  = { nullptr };
+    };
+
+    struct Table {
+      Table(size_t size)
+      : mask(size - 1), entries(new Entry[size]) { }
+
+      size_t                    mask;
+      std::unique_ptr<Entry[]>  entries;
+    };
+
+  public:
+
+    HashIndex() { }
+
+    HashIndex             (const HashIndex&) = delete;
+    HashIndex& operator = (const HashIndex&) = delete;
+
+    /**
+     * \brief Looks up an object
+     *
+     * \param [in] hash Hash of the object to look up
+     * \param [in] pred Predicate that checks whether
+     *    a given object with matching hash is a match
+     * \returns Pointer to the object, or \c nullptr
+     */
+    template<typename Pred>
+    T* find(size_t hash, const Pred& pred) const {
+      const Table* table = m_table.load(std::memory_order_acquire);
+
+      if (!table)
+        return nullptr;
+
+      for (size_t i = hash & table->mask; ; i = (i + 1) & table->mask) {
+        T* object = table->entries[i].object.load(std::memory_order_acquire);
+
+        if (!object)
+          return nullptr;
+
+        if (table->entries[i].hash.load(std::memory_order_relaxed) == hash && pred(*object))
+          return object;
+      }
+    }
+
+    /**
+     * \brief Inserts an object
+     *
+     * Must not be called concurrently with other
+     * insertions. The object must not already be
+     * present in the index.
+     * \param [in] hash Hash of the object
+     * \param [in] object The object
+     */
+    void insert(size_t hash, T* object) {
+      Table* table = m_table.load(std::memory_order_relaxed);
+
+      // Keep the load factor at or below 0.5 so
+      // that probe sequences remain short
+      if (!table || 2 * (m_count + 1) > table->mask + 1)
+        table = grow(table);
+
+      insertEntry(table, hash, object);
+      m_count += 1;
+    }
+
+  private:
+
+    std::atomic<Table*>                 m_table = { nullptr };
+    size_t                              m_count = 0;
+    std::vector<std::unique_ptr<Table>> m_tables;
+
+    Table* grow(const Table* oldTable) {
+      size_t size = oldTable ? 2 * (oldTable->mask + 1) : 16;
+
+      m_tables.push_back(std::make_unique<Table>(size));
+      Table* newTable = m_tables.back().get();
+
+      if (oldTable) {
+        for (size_t i = 0; i <= oldTable->mask; i++) {
+          T* object = oldTable->entries[i].object.load(std::memory_order_relaxed);
+
+          if (object)
+            insertEntry(newTable, oldTable->entries[i].hash.load(std::memory_order_relaxed), object);
+        }
+      }
+
+      m_table.store(newTable, std::memory_order_release);
+      return newTable;
+    }
+
+    static void insertEntry(Table* table, size_t hash, T* object) {
+      size_t i = hash & table->mask;
+
+      while (table->entries[i].object.load(std::memory_order_relaxed))
+        i = (i + 1) & table->mask;
+
+      // Readers check the object pointer first,
+      // so the hash must become visible before it
+      table->entries[i].hash.store(hash, std::memory_order_relaxed);
+      table->entries[i].object.store(object, std::memory_order_release);
+    }
+
+  };
+
+}
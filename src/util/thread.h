@@ -154,6 +154,10 @@ namespace dxvk {
       return uint32_t(GetCurrentThreadId());
     }
 
+    inline void set_priority(ThreadPriority priority) {
+      ::SetThreadPriority(::GetCurrentThread(), int32_t(priority));
+    }
+
     bool isInModuleDetachment();
   }
 
@@ -187,6 +187,47 @@ namespace dxvk::bit {
     #endif
   }
 
+  /**
+   * \brief Hashes an aligned struct bit by bit
+   *
+   * \param [in] data The struct
+   * \returns Hash of the struct's raw memory
+   */
+  template<typename T>
+  size_t bhash(const T* data) {
+    static_assert(alignof(T) >= 32);
+    auto bytes = reinterpret_cast<const char*>(data);
+
+    // Hash four interleaved streams of qwords so that the
+    // multiplications do not form a single dependency chain
+    uint64_t h0 = 0xcbf29ce484222325ull;
+    uint64_t h1 = 0x84222325cbf29ce4ull;
+    uint64_t h2 = 0x9e3779b97f4a7c15ull;
+    uint64_t h3 = 0x7f4a7c159e3779b9ull;
+
+    for (size_t i = 0; i < sizeof(T); i += 4 * sizeof(uint64_t)) {
+      uint64_t qwords[4];
+      std::memcpy(qwords, &bytes[i], sizeof(qwords));
+
+      h0 = (h0 ^ qwords[0]) * 0x100000001b3ull;
+      h1 = (h1 ^ qwords[1]) * 0x100000001b3ull;
+      h2 = (h2 ^ qwords[2]) * 0x100000001b3ull;
+      h3 = (h3 ^ qwords[3]) * 0x100000001b3ull;
+    }
+
+    uint64_t hash = h0
+      ^ ((h1 >> 1) | (h1 << 63))
+      ^ ((h2 >> 2) | (h2 << 62))
+      ^ ((h3 >> 3) | (h3 << 61));
+
+    // Multiplication only propagates bits upwards, fold
+    // high bits back so that the low bits are usable
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    return size_t(hash);
+  }
+
   template <size_t Bits>
   class bitset {
     static constexpr size_t Dwords = align(Bits, 32) / 32;
@@ -0,0 +1,102 @@
+#include <utility>
+
+#include "util_mapped_file.h"
+#include "util_string.h"
+
+#include "./com/com_include.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dxvk {
+
+  MappedFile::MappedFile(const std::wstring& path) {
+#ifdef _WIN32
+    HANDLE file = ::CreateFileW(path.c_str(), GENERIC_READ,
+      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+      nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+      return;
+
+    LARGE_INTEGER size;
+
+    if (::GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+      // The mapping object keeps its own reference to the
+      // file, so the file handle can be closed right away
+      HANDLE mapping = ::CreateFileMappingW(file,
+        nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+      if (mapping) {
+        m_data = reinterpret_cast<const char*>(
+          ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        m_size = m_data ? size_t(size.QuadPart) : 0;
+
+        ::CloseHandle(mapping);
+      }
+    }
+
+    ::CloseHandle(file);
+#else
+    int fd = ::open(str::fromws(path.c_str()).c_str(), O_RDONLY);
+
+    if (fd < 0)
+      return;
+
+    struct stat st;
+
+    if (!::fstat(fd, &st) && st.st_size > 0) {
+      void* data = ::mmap(nullptr, size_t(st.st_size),
+        PROT_READ, MAP_PRIVATE, fd, 0);
+
+      if (data != MAP_FAILED) {
+        m_data = reinterpret_cast<const char*>(data);
+        m_size = size_t(st.st_size);
+      }
+    }
+
+    ::close(fd);
+#endif
+  }
+
+
+  MappedFile::MappedFile(MappedFile&& other)
+  : m_data(std::exchange(other.m_data, nullptr)),
+    m_size(std::exchange(other.m_size, 0)) {
+
+  }
+
+
+  MappedFile& MappedFile::operator = (MappedFile&& other) {
+    unmap();
+
+    m_data = std::exchange(other.m_data, nullptr);
+    m_size = std::exchange(other.m_size, 0);
+    return *this;
+  }
+
+
+  MappedFile::~MappedFile() {
+    unmap();
+  }
+
+
+  void MappedFile::unmap() {
+    if (!m_data)
+      return;
+
+#ifdef _WIN32
+    ::UnmapViewOfFile(m_data);
+#else
+    ::munmap(const_cast<char*>(m_data), m_size);
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+  }
+
+}
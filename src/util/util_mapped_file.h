@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace dxvk {
+
+  /**
+   * \brief Read-only file mapping
+   *
+   * Maps an entire file into the address space of
+   * the process. Pages are only loaded from disk
+   * once they are accessed, so this can be used to
+   * read parts of large files without loading the
+   * whole file into memory.
+   */
+  class MappedFile {
+
+  public:
+
+    MappedFile() { }
+
+    /**
+     * \brief Maps a file
+     *
+     * If the file does not exist or cannot be
+     * mapped, the mapping will be empty.
+     * \param [in] path File path
+     */
+    explicit MappedFile(const std::wstring& path);
+
+    MappedFile(MappedFile&& other);
+
+    MappedFile& operator = (MappedFile&& other);
+
+    ~MappedFile();
+
+    /**
+     * \brief Mapped data
+     * \returns Pointer to file contents
+     */
+    const char* data() const {
+      return m_data;
+    }
+
+    /**
+     * \brief File size
+     * \returns File size, in bytes
+     */
+    size_t size() const {
+      return m_size;
+    }
+
+    /**
+     * \brief Checks whether the file is mapped
+     * \returns \c true if the mapping is valid
+     */
+    explicit operator bool () const {
+      return m_data != nullptr;
+    }
+
+  private:
+
+    const char* m_data = nullptr;
+    size_t      m_size = 0;
+
+    void unmap();
+
+  };
+
+}